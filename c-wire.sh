@@ -1,78 +1,182 @@
 #!/bin/bash
 
 # Shell script for the C-Wire Project
-# Usage: ./c-wire.sh csv_file_path station_type consumer_type [plant_id]
-
-# Check for help option
-for arg in "$@"; do
+# Usage: ./c-wire.sh csv_file_path... station_type consumer_type [plant_id] [-j threads] [--cache] [--snapshot] [--stats file] [--chart format] [--gnuplot] [--binary] [--debug]
+#        ./c-wire.sh csv_file_path... --batch [--per-plant] [-j threads] [--cache] [--snapshot] [--stats file] [--chart format] [--gnuplot] [--binary]
+#        ./c-wire.sh csv_file_path lv all [plant_id] --follow [--refresh-ms ms] [--refresh-lines lines]
+#        ./c-wire.sh csv_file_path lv all [plant_id] --top-budget stations [--verify]
+#        ./c-wire.sh csv_file_path --serve [--socket path] [-j threads] [--cache] [--snapshot]
+
+# Check for help, thread, batch, server, cache, snapshot, follow, bounded ranking, statistics, chart and debug options
+debug=0
+cache=0
+snapshot=0
+follow_options=()
+budget_options=()
+batch=0
+per_plant=0
+threads=1
+stats_file=""
+chart_options=()
+binary=0
+serve_options=()
+args=()
+while [ "$#" -gt 0 ]; do
+    arg="$1"
+    shift
     if [ "$arg" = "-h" ] || [ "$arg" = "--help" ]; then
-        echo "Usage: $0 csv_file_path station_type consumer_type [plant_id]"
+        echo "Usage: $0 csv_file_path... station_type consumer_type [plant_id] [-j threads] [--cache] [--snapshot] [--stats file] [--chart format] [--gnuplot] [--binary] [--debug]"
+        echo "       $0 csv_file_path... --batch [--per-plant] [-j threads] [--cache] [--snapshot] [--stats file] [--chart format] [--gnuplot] [--binary]"
+        echo "       $0 csv_file_path lv all [plant_id] --follow [--refresh-ms ms] [--refresh-lines lines]"
+        echo "       $0 csv_file_path lv all [plant_id] --top-budget stations [--verify]"
+        echo "       $0 csv_file_path --serve [--socket path] [-j threads] [--cache] [--snapshot]"
         echo
         echo "Parameters:"
-        echo "  csv_file_path : Path to the CSV input file"
+        echo "  csv_file_path : Path to the CSV input file, or to a directory of input files; several may be given"
+        echo "                  and are read as their concatenation would be, in parallel with -j"
         echo "  station_type  : hvb | hva | lv"
         echo "  consumer_type : comp | indiv | all"
         echo "  plant_id      : Optional, defaults to -1 if not provided"
+        echo "  -j threads    : Number of threads used to parse the input (default 1)"
+        echo "  --cache       : Keep a parsed copy of the input in csv_file_path.cache and reuse it while the input is unchanged"
+        echo "  --snapshot    : Save the aggregate next to the input and, when lines were only appended since, read just the new lines"
+        echo "  --follow      : With lv all, keep reading lines appended to the input and rewrite the top/bottom 10 and min/max files until Ctrl-C"
+        echo "  --refresh-ms ms, --refresh-lines lines : With --follow, publish at most every ms milliseconds, or as soon as lines new lines are pending"
+        echo "  --top-budget stations : With lv all, keep only that many candidate stations (64 to 1048576) and print how far the top/bottom 10 may be from exact"
+        echo "  --verify      : With --top-budget, read the input again to make the differences of the candidates exact"
+        echo "  --stats file  : Write the line counters, phase timings and tree statistics to file as JSON (- for stdout)"
+        echo "  --chart format: Charts drawn for lv all: svg, png, both (default) or none"
+        echo "  --gnuplot     : Also write the Gnuplot script of the chart (output/plot_lv_all.gp), to restyle it with gnuplot"
+        echo "  --binary      : Also write each sorted file as a binary result file (output/sorted_*.cwr), read with codeC/bin/cwresult"
+        echo "  --debug       : Keep the filtered lines in tmp/"
+        echo "  --batch       : Produce every report (hvb comp, hva comp, lv comp, lv indiv, lv all) in one pass"
+        echo "  --per-plant   : With --batch, also produce every report for each plant (files suffixed _<plant_id>)"
+        echo "  --serve       : Load the input once and answer queries such as \"lv all plant 3 top 10\" on standard input, one per line"
+        echo "  --socket path : With --serve, answer the queries on the Unix domain socket path instead"
         echo
         echo "Examples:"
         echo "  $0 data.csv lv all"
         echo "  $0 data.csv hvb comp 1234"
+        echo "  $0 data.csv lv all -j 8"
+        echo "  $0 data.csv --batch --per-plant"
+        echo "  $0 shards/ lv all -j 4"
+        echo "  $0 data.csv --serve --socket /tmp/c-wire.sock"
         exit 0
+    elif [ "$arg" = "-j" ]; then
+        threads="$1"
+        shift
+    elif [ "$arg" = "--follow" ]; then
+        follow_options+=("--follow")
+    elif [ "$arg" = "--refresh-ms" ] || [ "$arg" = "--refresh-lines" ]; then
+        follow_options+=("$arg" "$1")
+        shift
+    elif [ "$arg" = "--top-budget" ]; then
+        budget_options+=("--top-budget" "$1")
+        shift
+    elif [ "$arg" = "--verify" ]; then
+        budget_options+=("--verify")
+    elif [ "$arg" = "--serve" ]; then
+        serve_options+=("--serve")
+    elif [ "$arg" = "--socket" ]; then
+        serve_options+=("--socket" "$1")
+        shift
+    elif [ "$arg" = "--chart" ]; then
+        chart_options+=("--chart" "$1")
+        shift
+    elif [ "$arg" = "--gnuplot" ]; then
+        chart_options+=("--gnuplot")
+    elif [ "$arg" = "--binary" ]; then
+        binary=1
+    elif [ "$arg" = "--snapshot" ]; then
+        snapshot=1
+    elif [ "$arg" = "--stats" ]; then
+        stats_file="$1"
+        shift
+    elif [ "$arg" = "--debug" ]; then
+        debug=1
+    elif [ "$arg" = "--cache" ]; then
+        cache=1
+    elif [ "$arg" = "--batch" ]; then
+        batch=1
+    elif [ "$arg" = "--per-plant" ]; then
+        per_plant=1
+    else
+        args+=("$arg")
     fi
 done
+set -- "${args[@]}"
 
 start=$(date +%s)
 
+# With --stats -, the JSON of the C program is the only output on stdout: every message goes to stderr
+exec 3>&1
+if [ "$stats_file" = "-" ]; then
+    exec 1>&2
+fi
+
+# The server answers every query, so like the batch mode it only needs the input file
+if [ "${#serve_options[@]}" -gt 0 ]; then
+    batch=1
+fi
+
 # Parameter count check
-if [ "$#" -lt 3 ]; then
+if [[ "$#" -lt 3 && ! ( "$batch" -eq 1 && "$#" -ge 1 ) ]]; then
     echo "Error: Insufficient number of parameters."
     echo "Use -h for help."
     exit 1
 fi
 
-# Retrieving parameters
-csv_file="$1"
-station_type="$2"
-consumer_type="$3"
-plant_id="${4:--1}"
-
-# Input file validation
-if [ ! -f "$csv_file" ]; then
-    echo "Error: The file $csv_file does not exist."
-    exit 1
+# Retrieving parameters: every path before the station type is an input file or a directory of input files
+csv_files=()
+if [ "$batch" -eq 1 ]; then
+    csv_files=("$@")
+    set --
+else
+    csv_files+=("$1")
+    shift
+    while [ "$#" -gt 2 ] && [[ "$1" != "hvb" && "$1" != "hva" && "$1" != "lv" ]]; do
+        csv_files+=("$1")
+        shift
+    done
 fi
+station_type="${1:-}"
+consumer_type="${2:-}"
+plant_id="${3:--1}"
 
-# Station type validation
-if [[ "$station_type" != "hvb" && "$station_type" != "hva" && "$station_type" != "lv" ]]; then
-    echo "Error: Invalid station type. Valid options: hvb, hva, lv."
-    exit 1
-fi
+# Input file validation
+for csv_file in "${csv_files[@]}"; do
+    if [ ! -f "$csv_file" ] && [ ! -d "$csv_file" ]; then
+        echo "Error: The file $csv_file does not exist."
+        exit 1
+    fi
+done
 
-# Consumer type validation
-if [[ "$consumer_type" != "comp" && "$consumer_type" != "indiv" && "$consumer_type" != "all" ]]; then
-    echo "Error: Invalid consumer type. Valid options: comp, indiv, all."
-    exit 1
-fi
+# Query validation (the batch mode runs every query)
+if [ "$batch" -eq 0 ]; then
+    # Station type validation
+    if [[ "$station_type" != "hvb" && "$station_type" != "hva" && "$station_type" != "lv" ]]; then
+        echo "Error: Invalid station type. Valid options: hvb, hva, lv."
+        exit 1
+    fi
 
-# Plant ID validation if provided
-if [ "$plant_id" != "-1" ]; then
-    echo "Checking plant ID: $plant_id"
-    valid_id=$(awk -F';' -v id="$plant_id" '$1 == id {print $1; exit}' "$csv_file")
-    if [ -z "$valid_id" ]; then
-        echo "Error: The plant ID $plant_id does not exist in the file."
+    # Consumer type validation
+    if [[ "$consumer_type" != "comp" && "$consumer_type" != "indiv" && "$consumer_type" != "all" ]]; then
+        echo "Error: Invalid consumer type. Valid options: comp, indiv, all."
         exit 1
     fi
-fi
 
-# Prohibited options
-if [[ "$station_type" == "hvb" && ( "$consumer_type" == "all" || "$consumer_type" == "indiv" ) ]]; then
-    echo "Error: hvb all or hvb indiv options are not allowed."
-    exit 1
-fi
+    # The plant ID is checked by the C program while it reads the input
 
-if [[ "$station_type" == "hva" && ( "$consumer_type" == "all" || "$consumer_type" == "indiv" ) ]]; then
-    echo "Error: hva all or hva indiv options are not allowed."
-    exit 1
+    # Prohibited options
+    if [[ "$station_type" == "hvb" && ( "$consumer_type" == "all" || "$consumer_type" == "indiv" ) ]]; then
+        echo "Error: hvb all or hvb indiv options are not allowed."
+        exit 1
+    fi
+
+    if [[ "$station_type" == "hva" && ( "$consumer_type" == "all" || "$consumer_type" == "indiv" ) ]]; then
+        echo "Error: hva all or hva indiv options are not allowed."
+        exit 1
+    fi
 fi
 
 # Create necessary directories
@@ -82,40 +186,6 @@ mkdir -p tmp output
 rm -f tmp/*
 rm -f output/*
 
-if [ "$plant_id" == "-1" ]; then
-    filtered_file="tmp/filter_${station_type}_${consumer_type}.csv"
-else
-    filtered_file="tmp/filter_${station_type}_${consumer_type}_${plant_id}.csv"
-fi
-
-# Filtering data
-awk -F';' -v station="$station_type" -v consumer="$consumer_type" -v plant="$plant_id" '
-BEGIN { OFS=";" }
-{
-    if (station == "hvb" && $2 != "-" && $6 == "-") {
-        if (plant == "-1" || $1 == plant) print $0;
-    }
-    else if (station == "hva" && $3 != "-" && $6 == "-") {
-        if (plant == "-1" || $1 == plant) print $0;
-    }
-    else if (station == "lv" && $4 != "-" && $1 != "Power plant" && consumer == "indiv" && $5 == "-") {
-        if (plant == "-1" || $1 == plant) print $0;
-    }
-    else if (station == "lv" && $4 != "-" && $1 != "Power plant" && consumer == "comp" && $6 == "-") {
-        if (plant == "-1" || $1 == plant) print $0;
-    }
-    else if (station == "lv" && $4 != "-" && $1 != "Power plant" && consumer == "all") {
-        if (plant == "-1" || $1 == plant) print $0;
-    }
-}' "$csv_file" > "$filtered_file"
-
-if [ ! -s "$filtered_file" ]; then
-    echo "Error: No data found for the specified parameters."
-    exit 1
-fi
-
-echo "Filtered data saved to $filtered_file"
-
 echo "Cleaning previous builds..."
 make -C codeC clean
 
@@ -127,34 +197,47 @@ if [ ! -f "codeC/bin/main" ]; then
 fi
 
 echo "Executing the C program..."
-./codeC/bin/main "$station_type" "$consumer_type" "$plant_id"
+main_options=(-j "$threads")
+if [ "$cache" -eq 1 ]; then
+    main_options+=("--cache")
+fi
+if [ "$snapshot" -eq 1 ]; then
+    main_options+=("--snapshot")
+fi
+main_options+=("${follow_options[@]}")
+main_options+=("${budget_options[@]}")
+main_options+=("${chart_options[@]}")
+if [ "$binary" -eq 1 ]; then
+    main_options+=("--binary")
+fi
+main_options+=("${serve_options[@]}")
+if [ -n "$stats_file" ]; then
+    main_options+=(--stats "$stats_file")
+fi
+if [ "$debug" -eq 1 ]; then
+    main_options+=("--debug-filter")
+fi
+
+if [ "$batch" -eq 1 ]; then
+    main_options+=("--batch")
+    if [ "$per_plant" -eq 1 ]; then
+        main_options+=("--per-plant")
+    fi
+    ./codeC/bin/main "${csv_files[@]}" "${main_options[@]}" >&3
+else
+    ./codeC/bin/main "${csv_files[@]}" "$station_type" "$consumer_type" "$plant_id" "${main_options[@]}" >&3
+fi
 if [ $? -ne 0 ]; then
     echo "Error: Failed to execute the C program."
     exit 1
 fi
 
-# If station_type=lv and consumer_type=all, generate graphs
-if [[ "$station_type" == "lv" && "$consumer_type" == "all" ]]; then
-    echo "Generating graphs for LV all..."
-    
-    top10_data="output/top10_lv_all.csv"
-    bottom10_data="output/bottom10_lv_all.csv"
-    script_path="output/plot_lv_all.gp"
-    chart_output="output/chart_lv_all.png"
-
-    if [[ -f "$top10_data" && -f "$bottom10_data" ]]; then
-        echo "Executing Gnuplot..."
-        gnuplot "$script_path"
-
-        if [ $? -eq 0 ]; then
-            echo "Graph successfully generated: $chart_output"
-        else
-            echo "Error: Failed to generate the graph."
-        fi
-    else
-        echo "Error: Data files for Gnuplot not found."
+# For lv all, the C program draws the charts itself
+for chart_output in output/chart_lv_all*.svg output/chart_lv_all*.png; do
+    if [ -f "$chart_output" ]; then
+        echo "Graph successfully generated: $chart_output"
     fi
-fi
+done
 
 echo "Processing complete."
 
@@ -0,0 +1,399 @@
+#include <limits.h>
+#include <string.h>
+#include "bptree.h"
+
+void initBPTree(BPTree* tree) {
+/**
+ * @brief Initializes an empty B+tree; the arenas are allocated on the first insertion.
+ *
+ * @param tree The tree to initialize.
+ */
+
+    memset(tree, 0, sizeof(*tree));
+    tree->root = NIL_BLOCK;
+    tree->first = NIL_BLOCK;
+}
+
+static void* growArena(void* arena, uint32_t count, uint32_t* size, size_t blockSize) {
+/**
+ * @brief Doubles an arena of cache-line aligned blocks.
+ *
+ * realloc() only guarantees 16-byte alignment, so the blocks are copied
+ * into a new aligned allocation instead.
+ *
+ * @param arena The current arena, or NULL.
+ * @param count The number of blocks in use, copied to the new arena.
+ * @param size The number of blocks of the arena; receives the new size.
+ * @param blockSize The size of one block, a multiple of CACHE_LINE.
+ * @return The new arena.
+ */
+
+    uint32_t grown = *size ? *size * 2 : 64;
+    void* blocks = aligned_alloc(CACHE_LINE, (size_t)grown * blockSize);
+    if (!blocks) {
+        fprintf(stderr, "Memory allocation error.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (count > 0) memcpy(blocks, arena, (size_t)count * blockSize);
+    free(arena);
+    *size = grown;
+    return blocks;
+}
+
+static uint32_t createLeaf(BPTree* tree) {
+/**
+ * @brief Takes an empty leaf from the end of the leaf arena.
+ *
+ * Unused keys hold INT_MAX so that searches can scan whole leaves.
+ * Pointers to leaves are invalidated when the arena grows; indices are not.
+ *
+ * @param tree The tree owning the arena.
+ * @return The index of the new leaf.
+ */
+
+    if (tree->leafCount == tree->leafSize) {
+        tree->leaves = growArena(tree->leaves, tree->leafCount, &tree->leafSize, sizeof(BPLeaf));
+        if (tree->leafCount == 0) tree->leafCount = 1;
+    }
+
+    uint32_t index = tree->leafCount++;
+    BPLeaf* leaf = &tree->leaves[index];
+    for (int i = 0; i < BPTREE_LEAF_KEYS; i++) leaf->keys[i] = INT_MAX;
+    leaf->next = NIL_BLOCK;
+    leaf->count = 0;
+    return index;
+}
+
+static uint32_t createInner(BPTree* tree) {
+/**
+ * @brief Takes an empty inner node from the end of the inner arena.
+ *
+ * @param tree The tree owning the arena.
+ * @return The index of the new inner node.
+ */
+
+    if (tree->innerCount == tree->innerSize) {
+        tree->inners = growArena(tree->inners, tree->innerCount, &tree->innerSize, sizeof(BPInner));
+        if (tree->innerCount == 0) tree->innerCount = 1;
+    }
+
+    uint32_t index = tree->innerCount++;
+    BPInner* inner = &tree->inners[index];
+    for (int i = 0; i < BPTREE_FANOUT; i++) inner->keys[i] = INT_MAX;
+    inner->count = 0;
+    return index;
+}
+
+static inline int countBelow(const int* keys, int size, int key) {
+/**
+ * @brief Counts the keys of a node lower than a key.
+ *
+ * The keys are sorted and padded with INT_MAX, so the count is the position
+ * of the key. The whole node is always scanned without branches, which the
+ * compiler turns into a few vector compares; size must be a multiple of 4.
+ *
+ * @param keys The keys of the node.
+ * @param size The number of key slots of the node.
+ * @param key The key to place.
+ * @return The number of keys lower than key.
+ */
+
+    int below = 0;
+    for (int i = 0; i < size; i++) {
+        below += keys[i] < key;
+    }
+    return below;
+}
+
+static inline int childIndex(const BPInner* inner, int key) {
+/**
+ * @brief Picks the child of an inner node whose range holds a key.
+ *
+ * Separator i is the lowest key of child i + 1, so the child is the number
+ * of separators not above the key. The padding is never below a key, and
+ * the bound on count keeps it from matching a key of INT_MAX.
+ *
+ * @param inner The inner node.
+ * @param key The key to find.
+ * @return The index of the child.
+ */
+
+    int child = countBelow(inner->keys, BPTREE_FANOUT, key);
+    if (child < inner->count && inner->keys[child] == key) child++;
+    return child;
+}
+
+static void insertIntoLeaf(BPLeaf* leaf, int position, int key, long capacity, long consumption) {
+/**
+ * @brief Inserts a key into a leaf that is not full.
+ *
+ * @param leaf The leaf.
+ * @param position The position of the key.
+ * @param key The new key.
+ * @param capacity The capacity of the key.
+ * @param consumption The consumption of the key.
+ */
+
+    int moved = leaf->count - position;
+    memmove(&leaf->keys[position + 1], &leaf->keys[position], moved * sizeof(int));
+    memmove(&leaf->entries[position + 1], &leaf->entries[position], moved * sizeof(BPEntry));
+    leaf->keys[position] = key;
+    leaf->entries[position].capacity = capacity;
+    leaf->entries[position].consumption = consumption;
+    leaf->count++;
+}
+
+static uint32_t splitLeaf(BPTree* tree, uint32_t index, int position, int rightmost) {
+/**
+ * @brief Splits a full leaf in two and links the new leaf after it.
+ *
+ * A leaf is normally split in halves. When the new key goes past the end of
+ * the last leaf, the full leaf is kept as is and the new leaf starts empty,
+ * so keys inserted in ascending order fill the leaves completely.
+ *
+ * @param tree The tree owning the leaf.
+ * @param index The index of the full leaf.
+ * @param position The position of the key to insert.
+ * @param rightmost 1 if the leaf is the last one.
+ * @return The index of the new leaf.
+ */
+
+    uint32_t right = createLeaf(tree);
+    BPLeaf* leaf = &tree->leaves[index];
+    BPLeaf* sibling = &tree->leaves[right];
+    int split = rightmost && position == BPTREE_LEAF_KEYS ? BPTREE_LEAF_KEYS : BPTREE_LEAF_KEYS / 2;
+    int moved = BPTREE_LEAF_KEYS - split;
+
+    memcpy(sibling->keys, &leaf->keys[split], moved * sizeof(int));
+    memcpy(sibling->entries, &leaf->entries[split], moved * sizeof(BPEntry));
+    for (int i = split; i < BPTREE_LEAF_KEYS; i++) leaf->keys[i] = INT_MAX;
+    sibling->count = moved;
+    leaf->count = split;
+
+    sibling->next = leaf->next;
+    leaf->next = right;
+    tree->splits++;
+    return right;
+}
+
+static uint32_t splitInner(BPTree* tree, uint32_t index, int position, int rightmost, int* separator, uint32_t child) {
+/**
+ * @brief Inserts a separator and its child into a full inner node by splitting it.
+ *
+ * The middle separator moves up to the parent. As for leaves, a node on the
+ * right edge of the tree that receives its last child keeps its children
+ * and the new node starts with only the new child.
+ *
+ * @param tree The tree owning the node.
+ * @param index The index of the full inner node.
+ * @param position The position of the separator in the node.
+ * @param rightmost 1 if the node is on the right edge of the tree.
+ * @param separator The separator to insert; receives the separator moving up.
+ * @param child The child to insert after the separator.
+ * @return The index of the new inner node.
+ */
+
+    int keys[BPTREE_FANOUT];
+    uint32_t children[BPTREE_FANOUT + 1];
+    const BPInner* full = &tree->inners[index];
+
+    memcpy(keys, full->keys, position * sizeof(int));
+    keys[position] = *separator;
+    memcpy(&keys[position + 1], &full->keys[position], (BPTREE_FANOUT - 1 - position) * sizeof(int));
+    memcpy(children, full->children, (position + 1) * sizeof(uint32_t));
+    children[position + 1] = child;
+    memcpy(&children[position + 2], &full->children[position + 1], (BPTREE_FANOUT - 1 - position) * sizeof(uint32_t));
+
+    uint32_t right = createInner(tree);
+    BPInner* inner = &tree->inners[index];
+    BPInner* sibling = &tree->inners[right];
+    int middle = rightmost && position == BPTREE_FANOUT - 1 ? BPTREE_FANOUT - 1 : BPTREE_FANOUT / 2;
+
+    for (int i = 0; i < BPTREE_FANOUT - 1; i++) inner->keys[i] = i < middle ? keys[i] : INT_MAX;
+    memcpy(inner->children, children, (middle + 1) * sizeof(uint32_t));
+    inner->count = middle;
+
+    sibling->count = BPTREE_FANOUT - 1 - middle;
+    memcpy(sibling->keys, &keys[middle + 1], sibling->count * sizeof(int));
+    memcpy(sibling->children, &children[middle + 1], (sibling->count + 1) * sizeof(uint32_t));
+
+    tree->splits++;
+    *separator = keys[middle];
+    return right;
+}
+
+void insertBPTree(BPTree* tree, int key, long capacity, long consumption) {
+/**
+ * @brief Inserts a key with its capacity and consumption into the B+tree.
+ *
+ * A key already present keeps its capacity and adds the consumption, as
+ * insertNode() does. The descent remembers its path; a full leaf is split
+ * and the split moves up the path as long as the parents are full too.
+ *
+ * @param tree The tree receiving the key.
+ * @param key The key to insert.
+ * @param capacity The capacity of the key.
+ * @param consumption The consumption of the key.
+ */
+
+    if (tree->height == 0) {
+        tree->root = tree->first = createLeaf(tree);
+        tree->height = 1;
+    }
+
+    uint32_t path[MAX_BPTREE_HEIGHT];
+    int slots[MAX_BPTREE_HEIGHT];
+    int edges[MAX_BPTREE_HEIGHT];
+    int rightmost = 1;
+    uint32_t current = tree->root;
+
+    for (int level = 0; level < tree->height - 1; level++) {
+        const BPInner* inner = &tree->inners[current];
+        int child = childIndex(inner, key);
+        rightmost = rightmost && child == inner->count;
+        path[level] = current;
+        slots[level] = child;
+        edges[level] = rightmost;
+        current = inner->children[child];
+    }
+
+    BPLeaf* leaf = &tree->leaves[current];
+    int position = countBelow(leaf->keys, BPTREE_LEAF_KEYS, key);
+    if (position < leaf->count && leaf->keys[position] == key) {
+        // If the key already exists, just update the consumption
+        leaf->entries[position].consumption += consumption;
+        return;
+    }
+
+    tree->size++;
+    if (leaf->count < BPTREE_LEAF_KEYS) {
+        insertIntoLeaf(leaf, position, key, capacity, consumption);
+        return;
+    }
+
+    uint32_t child = splitLeaf(tree, current, position, rightmost);
+    int split = tree->leaves[current].count;
+    if (position < split) {
+        insertIntoLeaf(&tree->leaves[current], position, key, capacity, consumption);
+    } else {
+        insertIntoLeaf(&tree->leaves[child], position - split, key, capacity, consumption);
+    }
+    int separator = tree->leaves[child].keys[0];
+
+    for (int level = tree->height - 2; level >= 0; level--) {
+        BPInner* inner = &tree->inners[path[level]];
+        int at = slots[level];
+        if (inner->count < BPTREE_FANOUT - 1) {
+            int moved = inner->count - at;
+            memmove(&inner->keys[at + 1], &inner->keys[at], moved * sizeof(int));
+            memmove(&inner->children[at + 2], &inner->children[at + 1], moved * sizeof(uint32_t));
+            inner->keys[at] = separator;
+            inner->children[at + 1] = child;
+            inner->count++;
+            return;
+        }
+        child = splitInner(tree, path[level], at, edges[level], &separator, child);
+    }
+
+    // The root was split: a new root holds the two halves
+    uint32_t root = createInner(tree);
+    BPInner* inner = &tree->inners[root];
+    inner->keys[0] = separator;
+    inner->children[0] = tree->root;
+    inner->children[1] = child;
+    inner->count = 1;
+    tree->root = root;
+    tree->height++;
+}
+
+const BPEntry* findBPTree(const BPTree* tree, int key) {
+/**
+ * @brief Looks up the aggregate of a key.
+ *
+ * @param tree The tree to search.
+ * @param key The key to find.
+ * @return The aggregate of the key, or NULL if the key is not in the tree.
+ *         The pointer is valid until the next insertion.
+ */
+
+    if (tree->height == 0) return NULL;
+
+    uint32_t current = tree->root;
+    for (int level = 0; level < tree->height - 1; level++) {
+        const BPInner* inner = &tree->inners[current];
+        current = inner->children[childIndex(inner, key)];
+    }
+
+    const BPLeaf* leaf = &tree->leaves[current];
+    int position = countBelow(leaf->keys, BPTREE_LEAF_KEYS, key);
+    if (position < leaf->count && leaf->keys[position] == key) return &leaf->entries[position];
+    return NULL;
+}
+
+void freeBPTree(BPTree* tree) {
+/**
+ * @brief Frees the two arenas of the B+tree.
+ *
+ * @param tree The tree to free; it is left empty.
+ */
+
+    free(tree->leaves);
+    free(tree->inners);
+    initBPTree(tree);
+}
+
+void mergeBPTree(BPTree* tree, BPTree* other) {
+/**
+ * @brief Merges every key of another B+tree into the tree, then frees the other tree.
+ *
+ * Keys already present in tree keep their capacity and add the consumption
+ * of the other tree, as mergeTree() does. The other tree is read leaf by
+ * leaf in key order.
+ *
+ * @param tree The B+tree receiving the keys.
+ * @param other The B+tree to merge; it is freed.
+ */
+
+    for (uint32_t index = other->first; index != NIL_BLOCK; index = other->leaves[index].next) {
+        const BPLeaf* leaf = &other->leaves[index];
+        for (int i = 0; i < leaf->count; i++) {
+            insertBPTree(tree, leaf->keys[i], leaf->entries[i].capacity, leaf->entries[i].consumption);
+        }
+    }
+
+    tree->splits += other->splits;
+    freeBPTree(other);
+}
+
+uint32_t bptreeSize(const BPTree* tree) {
+/**
+ * @brief Returns the number of keys of the B+tree.
+ *
+ * @param tree The tree to measure.
+ * @return The number of distinct keys.
+ */
+
+    return tree->size;
+}
+
+int bptreeHeight(const BPTree* tree) {
+/**
+ * @brief Returns the number of levels of the B+tree, leaves included.
+ *
+ * @param tree The tree to measure.
+ * @return The height, or 0 for an empty tree.
+ */
+
+    return tree->height;
+}
+
+size_t bptreeMemory(const BPTree* tree) {
+/**
+ * @brief Returns the memory used by the nodes of the B+tree.
+ *
+ * @param tree The tree to measure.
+ * @return The size in bytes of the leaves and inner nodes in use.
+ */
+
+    return (size_t)tree->leafCount * sizeof(BPLeaf) + (size_t)tree->innerCount * sizeof(BPInner);
+}
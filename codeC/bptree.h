@@ -0,0 +1,69 @@
+#ifndef BPTREE_H
+#define BPTREE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Keys per leaf; the keys of a leaf fill two cache lines and are searched before its values are touched
+#define BPTREE_LEAF_KEYS 32
+// Children per inner node; its keys fill two cache lines, the last key slot being padding
+#define BPTREE_FANOUT 32
+
+// Index of the missing leaf or node; slot 0 of each arena is never used
+#define NIL_BLOCK 0u
+
+// Deepest path a B+tree of 2^32 keys can have with half-full nodes
+#define MAX_BPTREE_HEIGHT 16
+
+// Size of the cache lines nodes are aligned to
+#define CACHE_LINE 64
+
+// Aggregate of one key stored in a leaf
+typedef struct {
+    long capacity;
+    long consumption;
+} BPEntry;
+
+// Leaf of the B+tree: sorted keys, their aggregates and the next leaf in key order
+typedef struct {
+    _Alignas(CACHE_LINE) int keys[BPTREE_LEAF_KEYS];
+    BPEntry entries[BPTREE_LEAF_KEYS];
+    uint32_t next;
+    int count;
+} BPLeaf;
+
+// Inner node: count separator keys and count + 1 children (inner nodes, or leaves on the last level)
+// Unused key slots hold INT_MAX, so that searches scan whole vectors of keys
+typedef struct {
+    _Alignas(CACHE_LINE) int keys[BPTREE_FANOUT];
+    int count;
+    uint32_t children[BPTREE_FANOUT];
+} BPInner;
+
+// B+tree stored in two contiguous arenas, one of leaves and one of inner nodes
+typedef struct {
+    BPLeaf* leaves;
+    uint32_t leafCount;
+    uint32_t leafSize;
+    BPInner* inners;
+    uint32_t innerCount;
+    uint32_t innerSize;
+    uint32_t root;
+    uint32_t first;
+    int height;
+    uint32_t size;
+    unsigned long splits;
+} BPTree;
+
+// B+tree function prototypes
+void initBPTree(BPTree* tree);
+void insertBPTree(BPTree* tree, int key, long capacity, long consumption);
+const BPEntry* findBPTree(const BPTree* tree, int key);
+void freeBPTree(BPTree* tree);
+void mergeBPTree(BPTree* tree, BPTree* other);
+uint32_t bptreeSize(const BPTree* tree);
+int bptreeHeight(const BPTree* tree);
+size_t bptreeMemory(const BPTree* tree);
+
+#endif
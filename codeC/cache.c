@@ -0,0 +1,529 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "cache.h"
+#include "chunk.h"
+#include "scan.h"
+
+// A line-aligned slice of the input parsed into the cache from a given row
+typedef struct {
+    const char* begin;
+    const char* end;
+    ColumnCache* cache;
+    size_t firstRow;
+    int overflow;
+} BuildSlice;
+
+static size_t columnsEnd(size_t rows) {
+/**
+ * @brief Computes the offset of the plant index in a column cache.
+ *
+ * @param rows The number of rows.
+ * @return The size of the header and the columns, rounded up to 8 bytes.
+ */
+
+    size_t size = sizeof(CacheHeader) + rows * (2 * sizeof(int64_t) + ID_COLUMN_COUNT * sizeof(int32_t) + 3);
+    return (size + 7) & ~(size_t)7;
+}
+
+static size_t cacheSize(size_t rows, size_t runCount) {
+/**
+ * @brief Computes the size of a column cache.
+ *
+ * @param rows The number of rows.
+ * @param runCount The number of runs of the plant index.
+ * @return The size of the header, the columns and the plant index.
+ */
+
+    return columnsEnd(rows) + runCount * sizeof(PlantRun);
+}
+
+static void setColumns(ColumnCache* cache, char* data, size_t rows, size_t runCount) {
+/**
+ * @brief Points the columns and plant index of a cache into its data, laid out as in the file.
+ *
+ * The 64-bit columns come first so that every column is naturally aligned;
+ * the plant index follows the columns.
+ *
+ * @param cache The cache whose columns are set.
+ * @param data The header followed by the columns and the plant index.
+ * @param rows The number of rows.
+ * @param runCount The number of runs of the plant index.
+ */
+
+    char* p = data + sizeof(CacheHeader);
+
+    cache->rows = rows;
+    cache->runs = (PlantRun*)(data + columnsEnd(rows));
+    cache->runCount = runCount;
+    cache->data = data;
+    cache->size = cacheSize(rows, runCount);
+    cache->capacity = (int64_t*)p;
+    p += rows * sizeof(int64_t);
+    cache->load = (int64_t*)p;
+    p += rows * sizeof(int64_t);
+    for (int i = 0; i < ID_COLUMN_COUNT; i++) {
+        cache->ids[i] = (int32_t*)p;
+        p += rows * sizeof(int32_t);
+    }
+    cache->dash = (uint8_t*)p;
+    p += rows;
+    cache->empty = (uint8_t*)p;
+    p += rows;
+    cache->text = (uint8_t*)p;
+}
+
+uint64_t hashBytes(uint64_t hash, const char* data, size_t size) {
+/**
+ * @brief Extends a 64-bit hash with a block of bytes, eight bytes at a time.
+ *
+ * @param hash The hash so far.
+ * @param data The bytes to hash.
+ * @param size The number of bytes.
+ * @return The extended hash.
+ */
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 0x100000001b3ULL;
+    }
+    for (; i < size; i++) {
+        hash = (hash ^ (unsigned char)data[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static int describeSource(const InputFile* input, CacheHeader* header) {
+/**
+ * @brief Fills the source fields of a header: size, modification time and fingerprint.
+ *
+ * The fingerprint hashes the first and last CACHE_FINGERPRINT_SIZE bytes of
+ * the source, to catch rewrites that keep the size and the timestamp.
+ *
+ * @param input The mapped source.
+ * @param header The header receiving the fields.
+ * @return 0 on success, -1 if the source cannot be described.
+ */
+
+    struct stat info;
+    if (!input->mapped || fstat(input->fd, &info) != 0) return -1;
+
+    size_t edge = input->size < CACHE_FINGERPRINT_SIZE ? input->size : CACHE_FINGERPRINT_SIZE;
+    uint64_t fingerprint = hashBytes(0xcbf29ce484222325ULL, input->data, edge);
+    fingerprint = hashBytes(fingerprint, input->data + input->size - edge, edge);
+
+    header->sourceSize = (uint64_t)info.st_size;
+    header->sourceMtime = (int64_t)info.st_mtim.tv_sec;
+    header->sourceMtimeNsec = (int64_t)info.st_mtim.tv_nsec;
+    header->sourceFingerprint = fingerprint;
+    return 0;
+}
+
+static uint64_t checksumColumns(const ColumnCache* cache) {
+/**
+ * @brief Computes the checksum of the columns of a cache.
+ *
+ * @param cache The cache to check.
+ * @return The checksum of everything after the header.
+ */
+
+    return hashBytes(0xcbf29ce484222325ULL, cache->data + sizeof(CacheHeader), cache->size - sizeof(CacheHeader));
+}
+
+static uint64_t checksumRun(const ColumnCache* cache, const PlantRun* run) {
+/**
+ * @brief Computes the checksum of the rows of a plant run, in every column.
+ *
+ * @param cache The cache to check.
+ * @param run The run whose rows are hashed.
+ * @return The checksum of the rows of the run.
+ */
+
+    size_t first = run->firstRow;
+    size_t count = run->endRow - run->firstRow;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    hash = hashBytes(hash, (const char*)(cache->capacity + first), count * sizeof(int64_t));
+    hash = hashBytes(hash, (const char*)(cache->load + first), count * sizeof(int64_t));
+    for (int i = 0; i < ID_COLUMN_COUNT; i++) {
+        hash = hashBytes(hash, (const char*)(cache->ids[i] + first), count * sizeof(int32_t));
+    }
+    hash = hashBytes(hash, (const char*)(cache->dash + first), count);
+    hash = hashBytes(hash, (const char*)(cache->empty + first), count);
+    return hashBytes(hash, (const char*)(cache->text + first), count);
+}
+
+static uint64_t checksumIndex(const ColumnCache* cache) {
+/**
+ * @brief Computes the checksum of the plant index of a cache, the checksums of its runs included.
+ */
+
+    return hashBytes(0xcbf29ce484222325ULL, (const char*)cache->runs, cache->runCount * sizeof(PlantRun));
+}
+
+static void* buildWorker(void* argument) {
+/**
+ * @brief Parses a slice of the input into consecutive rows of the cache.
+ *
+ * @param argument The BuildSlice to parse; its overflow flag is set if an ID
+ *                 does not fit in 32 bits.
+ * @return NULL.
+ */
+
+    BuildSlice* slice = (BuildSlice*)argument;
+    ColumnCache* cache = slice->cache;
+    const char* line = slice->begin;
+    size_t row = slice->firstRow;
+    Scanner scanner;
+    initScanner(&scanner, slice->begin, slice->end);
+
+    while (line < slice->end) {
+        Record record;
+        line = scanRecord(&scanner, &record);
+
+        for (int i = 0; i < ID_COLUMN_COUNT; i++) {
+            cache->ids[i][row] = (int32_t)record.value[i];
+            if (cache->ids[i][row] != record.value[i]) slice->overflow = 1;
+        }
+        cache->capacity[row] = record.value[COL_CAPACITY];
+        cache->load[row] = record.value[COL_LOAD];
+        cache->dash[row] = record.dash;
+        cache->empty[row] = record.empty;
+        cache->text[row] = record.text;
+        row++;
+    }
+
+    return NULL;
+}
+
+static int compareRuns(const void* a, const void* b) {
+/**
+ * @brief Orders plant runs by plant, then by first row.
+ *
+ * @param a Pointer to the first PlantRun.
+ * @param b Pointer to the second PlantRun.
+ * @return An integer less than, equal to, or greater than zero.
+ */
+
+    const PlantRun* runA = (const PlantRun*)a;
+    const PlantRun* runB = (const PlantRun*)b;
+
+    if (runA->plantId != runB->plantId) return runA->plantId < runB->plantId ? -1 : 1;
+    return (runA->firstRow > runB->firstRow) - (runA->firstRow < runB->firstRow);
+}
+
+static void indexPlants(ColumnCache* cache) {
+/**
+ * @brief Builds the plant index of a cache: the runs of consecutive rows of each plant.
+ *
+ * Rows whose plant column is '-', empty or text belong to no plant. Lines
+ * of a plant are usually grouped in the input, so there are few runs. The
+ * index is appended to the data of the cache.
+ *
+ * @param cache The cache built in memory; its data is reallocated.
+ */
+
+    PlantRun* runs = NULL;
+    size_t runCount = 0;
+    size_t runSize = 0;
+    const uint8_t unindexed = (uint8_t)COLUMN_BIT(COL_PLANT);
+
+    for (size_t row = 0; row < cache->rows; row++) {
+        if ((cache->dash[row] | cache->empty[row] | cache->text[row]) & unindexed) continue;
+
+        int32_t plantId = cache->ids[COL_PLANT][row];
+        if (runCount > 0 && runs[runCount - 1].plantId == plantId && runs[runCount - 1].endRow == row) {
+            runs[runCount - 1].endRow = row + 1;
+            continue;
+        }
+
+        if (runCount == runSize) {
+            runSize = runSize ? runSize * 2 : 64;
+            runs = realloc(runs, runSize * sizeof(PlantRun));
+            if (!runs) {
+                perror("Memory reallocation error");
+                exit(EXIT_FAILURE);
+            }
+        }
+        runs[runCount].plantId = plantId;
+        runs[runCount].reserved = 0;
+        runs[runCount].firstRow = row;
+        runs[runCount].endRow = row + 1;
+        runs[runCount].checksum = 0;
+        runCount++;
+    }
+
+    if (runCount > 1) qsort(runs, runCount, sizeof(PlantRun), compareRuns);
+
+    char* data = realloc(cache->data, cacheSize(cache->rows, runCount));
+    if (!data) {
+        perror("Memory reallocation error");
+        exit(EXIT_FAILURE);
+    }
+    setColumns(cache, data, cache->rows, runCount);
+    if (runCount > 0) memcpy(cache->runs, runs, runCount * sizeof(PlantRun));
+    free(runs);
+}
+
+int buildColumnCache(ColumnCache* cache, const InputFile* input, int threads) {
+/**
+ * @brief Parses a mapped input into a column cache held in memory.
+ *
+ * The lines are counted first so that the columns are allocated once; the
+ * input is then split into line-aligned slices parsed concurrently, each
+ * slice writing its own range of rows. The plant index is built last.
+ *
+ * @param cache The cache to build.
+ * @param input The mapped input.
+ * @param threads The number of threads used to parse the input.
+ * @return 0 on success, -1 if the input is not mapped or an ID does not fit in 32 bits.
+ */
+
+    memset(cache, 0, sizeof(*cache));
+    if (!input->mapped) return -1;
+
+    const char* begin = input->data;
+    const char* end = input->data + input->size;
+
+    Chunk chunks[MAX_THREADS];
+    BuildSlice slices[MAX_THREADS];
+    int count = splitChunks(begin, end, chunks, threads);
+    size_t rows = 0;
+
+    for (int i = 0; i < count; i++) {
+        slices[i].begin = chunks[i].begin;
+        slices[i].end = chunks[i].end;
+        slices[i].cache = cache;
+        slices[i].firstRow = rows;
+        slices[i].overflow = 0;
+
+        // A slice ends with a newline, except the last one if the file does not
+        const char* p = chunks[i].begin;
+        while ((p = memchr(p, '\n', (size_t)(chunks[i].end - p))) != NULL) {
+            rows++;
+            p++;
+        }
+        if (chunks[i].end[-1] != '\n') rows++;
+    }
+
+    char* data = calloc(1, cacheSize(rows, 0));
+    if (!data) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    setColumns(cache, data, rows, 0);
+
+    pthread_t workers[MAX_THREADS];
+    int started[MAX_THREADS] = {0};
+    for (int i = 1; i < count; i++) {
+        started[i] = pthread_create(&workers[i], NULL, buildWorker, &slices[i]) == 0;
+    }
+    if (count > 0) buildWorker(&slices[0]);
+
+    int overflow = count > 0 && slices[0].overflow;
+    for (int i = 1; i < count; i++) {
+        if (started[i]) {
+            pthread_join(workers[i], NULL);
+        } else {
+            buildWorker(&slices[i]);
+        }
+        overflow |= slices[i].overflow;
+    }
+
+    if (overflow) {
+        freeColumnCache(cache);
+        return -1;
+    }
+
+    indexPlants(cache);
+    return 0;
+}
+
+int loadColumnCache(ColumnCache* cache, const char* path, const InputFile* input, int plantId) {
+/**
+ * @brief Maps a column cache file if it is intact and matches the input.
+ *
+ * The cache is rejected if its layout is unknown, if the size, modification
+ * time or fingerprint of the input changed since it was written, or if the
+ * data to be read does not match its checksum. For a single plant, only the
+ * plant index and the runs of that plant are checked, so a plant query
+ * touches no other rows; otherwise every column is.
+ *
+ * @param cache The cache to load.
+ * @param path The path of the cache file.
+ * @param input The mapped input the cache must describe.
+ * @param plantId The only plant whose rows will be read, or -1 for every row.
+ * @return 0 on success, -1 if there is no valid cache for the input.
+ */
+
+    memset(cache, 0, sizeof(*cache));
+
+    CacheHeader source;
+    if (describeSource(input, &source) != 0) return -1;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(CacheHeader)) {
+        close(fd);
+        return -1;
+    }
+
+    char* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return -1;
+
+    CacheHeader header;
+    memcpy(&header, data, sizeof(header));
+    int valid = memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) == 0
+        && header.version == CACHE_VERSION
+        && header.headerSize == sizeof(CacheHeader)
+        && cacheSize(header.rows, header.runCount) == (size_t)info.st_size
+        && header.sourceSize == source.sourceSize
+        && header.sourceMtime == source.sourceMtime
+        && header.sourceMtimeNsec == source.sourceMtimeNsec
+        && header.sourceFingerprint == source.sourceFingerprint;
+
+    if (valid) {
+        setColumns(cache, data, header.rows, header.runCount);
+        cache->mapped = 1;
+        valid = checksumIndex(cache) == header.indexChecksum;
+    }
+
+    if (valid && plantId == -1) {
+        madvise(data, cache->size, MADV_SEQUENTIAL);
+        valid = checksumColumns(cache) == header.checksum;
+    } else if (valid) {
+        const PlantRun* runs;
+        size_t runCount = findPlantRuns(cache, plantId, &runs);
+        for (size_t r = 0; valid && r < runCount; r++) {
+            valid = runs[r].endRow <= header.rows && runs[r].firstRow < runs[r].endRow &&
+                    checksumRun(cache, &runs[r]) == runs[r].checksum;
+        }
+    }
+
+    if (!valid) {
+        munmap(data, (size_t)info.st_size);
+        memset(cache, 0, sizeof(*cache));
+        return -1;
+    }
+    return 0;
+}
+
+int saveColumnCache(ColumnCache* cache, const char* path, const InputFile* input) {
+/**
+ * @brief Writes a column cache built in memory next to its input.
+ *
+ * The file is written under a temporary name and renamed into place, so a
+ * concurrent run never maps a partial cache.
+ *
+ * @param cache The cache to write; its header is filled in.
+ * @param path The path of the cache file.
+ * @param input The mapped input the cache describes.
+ * @return 0 on success, -1 on error (errno is set).
+ */
+
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    if (describeSource(input, &header) != 0) return -1;
+    memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.version = CACHE_VERSION;
+    header.headerSize = sizeof(CacheHeader);
+    header.rows = cache->rows;
+    header.runCount = cache->runCount;
+    for (size_t r = 0; r < cache->runCount; r++) cache->runs[r].checksum = checksumRun(cache, &cache->runs[r]);
+    header.indexChecksum = checksumIndex(cache);
+    header.checksum = checksumColumns(cache);
+    memcpy(cache->data, &header, sizeof(header));
+
+    char temporaryPath[4096];
+    if (snprintf(temporaryPath, sizeof(temporaryPath), "%s.%d.tmp", path, (int)getpid()) >= (int)sizeof(temporaryPath)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    FILE* file = fopen(temporaryPath, "wb");
+    if (!file) return -1;
+
+    size_t written = fwrite(cache->data, 1, cache->size, file);
+    if (fclose(file) != 0 || written != cache->size || rename(temporaryPath, path) != 0) {
+        int error = errno;
+        unlink(temporaryPath);
+        errno = error;
+        return -1;
+    }
+    return 0;
+}
+
+void loadRecord(const ColumnCache* cache, size_t row, Record* record) {
+/**
+ * @brief Rebuilds the parsed line of a row, as parseRecord() produced it.
+ *
+ * @param cache The cache to read.
+ * @param row The row, numbered from 0.
+ * @param record The record receiving the columns.
+ */
+
+    for (int i = 0; i < ID_COLUMN_COUNT; i++) {
+        record->value[i] = cache->ids[i][row];
+    }
+    record->value[COL_CAPACITY] = cache->capacity[row];
+    record->value[COL_LOAD] = cache->load[row];
+    record->dash = cache->dash[row];
+    record->empty = cache->empty[row];
+    record->text = cache->text[row];
+}
+
+size_t findPlantRuns(const ColumnCache* cache, int plantId, const PlantRun** runs) {
+/**
+ * @brief Looks up the rows of a plant in the plant index.
+ *
+ * @param cache The cache to search.
+ * @param plantId The plant ID.
+ * @param runs Receives the first run of the plant, in row order.
+ * @return The number of runs of the plant, 0 if the plant has no rows.
+ */
+
+    size_t low = 0;
+    size_t high = cache->runCount;
+
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (cache->runs[middle].plantId < plantId) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    size_t end = low;
+    while (end < cache->runCount && cache->runs[end].plantId == plantId) end++;
+
+    *runs = cache->runs + low;
+    return end - low;
+}
+
+void freeColumnCache(ColumnCache* cache) {
+/**
+ * @brief Releases the mapping or memory of a column cache.
+ *
+ * @param cache The cache to free.
+ */
+
+    if (cache->mapped) {
+        munmap(cache->data, cache->size);
+    } else {
+        free(cache->data);
+    }
+    memset(cache, 0, sizeof(*cache));
+}
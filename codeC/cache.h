@@ -0,0 +1,72 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "filter.h"
+#include "input.h"
+
+// Identifies a column cache file and the version of its layout
+#define CACHE_MAGIC "CWCOLS\0\0"
+#define CACHE_VERSION 3
+
+// Suffix appended to the input path to name its column cache
+#define CACHE_SUFFIX ".cache"
+
+// Columns plant to individual are stored as 32-bit IDs
+#define ID_COLUMN_COUNT 6
+
+// Bytes of the source hashed at each end for its fingerprint
+#define CACHE_FINGERPRINT_SIZE 65536
+
+// Header of a column cache file; the columns follow it
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t rows;
+    uint64_t sourceSize;
+    int64_t sourceMtime;
+    int64_t sourceMtimeNsec;
+    uint64_t sourceFingerprint;
+    uint64_t runCount;
+    uint64_t checksum;
+    uint64_t indexChecksum;
+} CacheHeader;
+
+// Consecutive rows [firstRow, endRow) of one plant and the checksum of their columns; the plant index is sorted by
+// plant, then row
+typedef struct {
+    int32_t plantId;
+    uint32_t reserved;
+    uint64_t firstRow;
+    uint64_t endRow;
+    uint64_t checksum;
+} PlantRun;
+
+// The parsed input stored column by column, one row per input line
+typedef struct {
+    size_t rows;
+    int64_t* capacity;
+    int64_t* load;
+    int32_t* ids[ID_COLUMN_COUNT];
+    uint8_t* dash;
+    uint8_t* empty;
+    uint8_t* text;
+    PlantRun* runs;
+    size_t runCount;
+    char* data;
+    size_t size;
+    int mapped;
+} ColumnCache;
+
+// Column cache function prototypes
+int buildColumnCache(ColumnCache* cache, const InputFile* input, int threads);
+int loadColumnCache(ColumnCache* cache, const char* path, const InputFile* input, int plantId);
+int saveColumnCache(ColumnCache* cache, const char* path, const InputFile* input);
+void loadRecord(const ColumnCache* cache, size_t row, Record* record);
+size_t findPlantRuns(const ColumnCache* cache, int plantId, const PlantRun** runs);
+void freeColumnCache(ColumnCache* cache);
+uint64_t hashBytes(uint64_t hash, const char* data, size_t size);
+
+#endif
@@ -0,0 +1,418 @@
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "candidate.h"
+
+// Seeds of the index hash (row 0) and of the sketch rows
+static const uint32_t HASH_SEEDS[SKETCH_ROWS + 1] = {0, 0x9e3779b9u, 0x7f4a7c15u, 0xf39cc060u, 0x5ced1b47u};
+
+static uint32_t hashKey(int key, int row) {
+/**
+ * @brief Mixes a station ID into a 32-bit hash, one independent hash per row.
+ */
+
+    uint32_t hash = (uint32_t)key ^ HASH_SEEDS[row];
+    hash = (hash ^ (hash >> 16)) * 0x85ebca6bu;
+    hash = (hash ^ (hash >> 13)) * 0xc2b2ae35u;
+    return hash ^ (hash >> 16);
+}
+
+static size_t roundUpPower(size_t count) {
+/**
+ * @brief Returns the smallest power of two at least equal to count.
+ */
+
+    size_t power = 1;
+    while (power < count) power *= 2;
+    return power;
+}
+
+void initCandidates(CandidateTable* table, int size) {
+/**
+ * @brief Initializes an empty table keeping at most size stations.
+ *
+ * Everything the table will ever use is allocated here: the entries, an
+ * index twice as large, and the sketch and filter of the dropped stations.
+ *
+ * @param table The table to initialize.
+ * @param size The number of stations kept, from MIN_CANDIDATES to MAX_CANDIDATES.
+ */
+
+    // The sizes are computed in size_t; up to MAX_CANDIDATES, every mask fits an int
+    size_t indexSize = roundUpPower(2 * (size_t)size);
+    size_t sketchWidth = roundUpPower((size_t)size);
+    size_t markBits = roundUpPower((size_t)size * DROP_MARK_BITS);
+
+    memset(table, 0, sizeof(*table));
+    table->size = size;
+    table->indexMask = (int)(indexSize - 1);
+    table->sketchMask = (int)(sketchWidth - 1);
+    table->markMask = (int)(markBits - 1);
+    table->droppedLow = LONG_MAX;
+    table->droppedHigh = LONG_MIN;
+
+    table->entries = malloc((size_t)size * sizeof(Candidate));
+    table->index = malloc(indexSize * sizeof(int));
+    table->sketch = calloc(SKETCH_ROWS * sketchWidth, sizeof(long));
+    table->marks = calloc(markBits / 64, sizeof(uint64_t));
+    if (!table->entries || !table->index || !table->sketch || !table->marks) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i <= table->indexMask; i++) table->index[i] = NO_CANDIDATE;
+}
+
+static int findSlot(const CandidateTable* table, int key) {
+/**
+ * @brief Returns the index slot holding a key, or the empty slot where it would be inserted.
+ */
+
+    int slot = (int)(hashKey(key, 0) & (uint32_t)table->indexMask);
+    while (table->index[slot] != NO_CANDIDATE && table->entries[table->index[slot]].key != key) {
+        slot = (slot + 1) & table->indexMask;
+    }
+    return slot;
+}
+
+static long sketchEstimate(const CandidateTable* table, int key) {
+/**
+ * @brief Bounds the capacity and consumption of a station that the table dropped.
+ *
+ * Each row adds the dropped amounts of every station hashed to the same
+ * counter, so the smallest counter is an upper bound.
+ *
+ * @param table The table.
+ * @param key The station ID.
+ * @return An upper bound of the dropped capacity and consumption of the station, 0 if nothing was dropped.
+ */
+
+    if (table->dropped == 0) return 0;
+
+    long estimate = LONG_MAX;
+    int width = table->sketchMask + 1;
+    for (int row = 0; row < SKETCH_ROWS; row++) {
+        long count = table->sketch[row * width + (hashKey(key, row + 1) & (uint32_t)table->sketchMask)];
+        if (count < estimate) estimate = count;
+    }
+    return estimate;
+}
+
+static uint32_t markBit(int key, int probe) {
+/**
+ * @brief Returns the probe-th bit of a station in the filter of dropped stations, by double hashing.
+ */
+
+    return hashKey(key, 1) + (uint32_t)probe * (hashKey(key, 2) | 1);
+}
+
+static void markDropped(CandidateTable* table, int key) {
+/**
+ * @brief Marks a station as dropped in the filter.
+ */
+
+    for (int probe = 0; probe < DROP_MARK_HASHES; probe++) {
+        uint32_t bit = markBit(key, probe) & (uint32_t)table->markMask;
+        table->marks[bit / 64] |= (uint64_t)1 << (bit % 64);
+    }
+}
+
+static int wasDropped(const CandidateTable* table, int key) {
+/**
+ * @brief Tells whether a station may have been dropped by the table; never wrong when it answers no.
+ */
+
+    if (table->dropped == 0) return 0;
+
+    for (int probe = 0; probe < DROP_MARK_HASHES; probe++) {
+        uint32_t bit = markBit(key, probe) & (uint32_t)table->markMask;
+        if (!(table->marks[bit / 64] & (uint64_t)1 << (bit % 64))) return 0;
+    }
+    return 1;
+}
+
+static long lostAmount(const CandidateTable* table, int key) {
+/**
+ * @brief Bounds the capacity and consumption of a station lost by the table, 0 if it was never dropped.
+ *
+ * The filter tells the stations never dropped apart much more often than
+ * the sketch, whose counters all add up stations once many were dropped.
+ */
+
+    return wasDropped(table, key) ? sketchEstimate(table, key) : 0;
+}
+
+static void addSketch(CandidateTable* table, int key, long amount) {
+/**
+ * @brief Adds the dropped capacity and consumption of a station to every row of the sketch, and marks it dropped.
+ */
+
+    int width = table->sketchMask + 1;
+    for (int row = 0; row < SKETCH_ROWS; row++) {
+        table->sketch[row * width + (hashKey(key, row + 1) & (uint32_t)table->sketchMask)] += amount;
+    }
+    markDropped(table, key);
+}
+
+static long estimatedDifference(const Candidate* candidate) {
+/**
+ * @brief Returns the difference of a candidate from the lines the table saw.
+ */
+
+    return candidate->capacity - candidate->consumption;
+}
+
+static int compareByEstimate(const void* a, const void* b) {
+/**
+ * @brief qsort adapter ordering candidates by estimated difference, then by key.
+ */
+
+    const Candidate* first = (const Candidate*)a;
+    const Candidate* second = (const Candidate*)b;
+    long x = estimatedDifference(first);
+    long y = estimatedDifference(second);
+    if (x != y) return (x > y) - (x < y);
+    return (first->key > second->key) - (first->key < second->key);
+}
+
+static void rebuildIndex(CandidateTable* table) {
+/**
+ * @brief Indexes the entries again after they were moved.
+ */
+
+    for (int i = 0; i <= table->indexMask; i++) table->index[i] = NO_CANDIDATE;
+    for (int i = 0; i < table->count; i++) {
+        table->index[findSlot(table, table->entries[i].key)] = i;
+    }
+}
+
+static void dropMiddle(CandidateTable* table) {
+/**
+ * @brief Makes room in a full table by dropping the middle half of its stations.
+ *
+ * The quarter with the smallest differences and the quarter with the
+ * largest are kept. Every dropped station widens the range of differences
+ * of the stations outside the table by its bounds, and its capacity and
+ * consumption are added to the sketch, in case more of its lines follow.
+ *
+ * @param table The full table.
+ */
+
+    qsort(table->entries, (size_t)table->count, sizeof(Candidate), compareByEstimate);
+
+    int kept = table->size / 4;
+    for (int i = kept; i < table->count - kept; i++) {
+        const Candidate* candidate = &table->entries[i];
+        long low;
+        long high;
+        candidateBounds(candidate, &low, &high);
+        if (low < table->droppedLow) table->droppedLow = low;
+        if (high > table->droppedHigh) table->droppedHigh = high;
+        addSketch(table, candidate->key, labs(candidate->capacity) + labs(candidate->consumption));
+        table->dropped++;
+    }
+
+    memmove(&table->entries[kept], &table->entries[table->count - kept], (size_t)kept * sizeof(Candidate));
+    table->count = 2 * kept;
+    rebuildIndex(table);
+}
+
+static void insertCandidate(CandidateTable* table, int key, long capacity, long consumption, long error,
+                            int firstSeen) {
+/**
+ * @brief Takes a station into the table, dropping the middle half of it first when it is full.
+ *
+ * @param table The table, which does not hold the key.
+ * @param key The station ID.
+ * @param capacity The capacity of its first line seen.
+ * @param consumption The consumption of its lines seen.
+ * @param error The bound of its capacity and consumption lost before.
+ * @param firstSeen 1 if the first line of the station was seen, so that its capacity is exact.
+ */
+
+    if (table->count == table->size) dropMiddle(table);
+
+    Candidate* candidate = &table->entries[table->count];
+    candidate->key = key;
+    candidate->capacity = capacity;
+    candidate->consumption = consumption;
+    candidate->error = error;
+    candidate->firstSeen = firstSeen;
+    table->index[findSlot(table, key)] = table->count++;
+}
+
+void addCandidate(CandidateTable* table, int key, long capacity, long consumption) {
+/**
+ * @brief Adds a line to the aggregate of its station, taking the station into the table if needed.
+ *
+ * As in the exact backends, the first line of a station sets its capacity.
+ * A station never dropped is seen from its first line, so its capacity is
+ * exact. Otherwise lines of it may have been dropped before, bounded by the
+ * sketch, and the first of them, with its capacity, may be
+ * among them: whatever the line taking it in carries, its capacity is
+ * uncertain.
+ *
+ * @param table The table receiving the line.
+ * @param key The station ID.
+ * @param capacity The capacity of the line.
+ * @param consumption The consumption of the line.
+ */
+
+    int slot = findSlot(table, key);
+    if (table->index[slot] != NO_CANDIDATE) {
+        table->entries[table->index[slot]].consumption += consumption;
+        return;
+    }
+
+    int dropped = wasDropped(table, key);
+    insertCandidate(table, key, capacity, consumption, dropped ? sketchEstimate(table, key) : 0, !dropped);
+}
+
+void mergeCandidates(CandidateTable* table, CandidateTable* other) {
+/**
+ * @brief Merges the candidates of a table built from the next slice of the input, then frees it.
+ *
+ * Candidates of both tables add their consumption. A candidate missing from
+ * the other table may have had later lines dropped by it, and a candidate
+ * new to this table may have had earlier lines dropped by it, its first line
+ * included: both bounds are added to their error, and the latter makes the
+ * capacity uncertain. A station outside both tables may have been
+ * dropped by each of them, so the two ranges of dropped differences add up.
+ *
+ * @param table The table receiving the candidates.
+ * @param other The table to merge; it is freed.
+ */
+
+    // An empty table simply takes over the other one
+    if (table->count == 0 && table->dropped == 0) {
+        freeCandidates(table);
+        *table = *other;
+        memset(other, 0, sizeof(*other));
+        return;
+    }
+
+    if (other->dropped > 0) {
+        for (int i = 0; i < table->count; i++) {
+            if (!findCandidate(other, table->entries[i].key)) {
+                table->entries[i].error += lostAmount(other, table->entries[i].key);
+            }
+        }
+    }
+
+    // New candidates look their earlier lines up before the drops of the other table are added
+    for (int i = 0; i < other->count; i++) {
+        Candidate* candidate = &other->entries[i];
+        if (!findCandidate(table, candidate->key) && wasDropped(table, candidate->key)) {
+            candidate->error += sketchEstimate(table, candidate->key);
+            candidate->firstSeen = 0;
+        }
+    }
+
+    if (other->dropped > 0) {
+        long low = table->dropped > 0 && table->droppedLow < 0 ? table->droppedLow : 0;
+        long high = table->dropped > 0 && table->droppedHigh > 0 ? table->droppedHigh : 0;
+        table->droppedLow = low + (other->droppedLow < 0 ? other->droppedLow : 0);
+        table->droppedHigh = high + (other->droppedHigh > 0 ? other->droppedHigh : 0);
+        table->dropped += other->dropped;
+        for (int i = 0; i < SKETCH_ROWS * (table->sketchMask + 1); i++) table->sketch[i] += other->sketch[i];
+        for (int i = 0; i < (table->markMask + 1) / 64; i++) table->marks[i] |= other->marks[i];
+    }
+
+    for (int i = 0; i < other->count; i++) {
+        const Candidate* candidate = &other->entries[i];
+        int slot = findSlot(table, candidate->key);
+        if (table->index[slot] != NO_CANDIDATE) {
+            Candidate* kept = &table->entries[table->index[slot]];
+            kept->consumption += candidate->consumption;
+            kept->error += candidate->error;
+        } else {
+            insertCandidate(table, candidate->key, candidate->capacity, candidate->consumption, candidate->error,
+                            candidate->firstSeen);
+        }
+    }
+
+    freeCandidates(other);
+}
+
+const Candidate* findCandidate(const CandidateTable* table, int key) {
+/**
+ * @brief Looks up the candidate of a station.
+ *
+ * @param table The table.
+ * @param key The station ID.
+ * @return The candidate, or NULL if the station is not in the table.
+ */
+
+    if (table->count == 0) return NULL;
+    int slot = findSlot(table, key);
+    return table->index[slot] == NO_CANDIDATE ? NULL : &table->entries[table->index[slot]];
+}
+
+void candidateBounds(const Candidate* candidate, long* low, long* high) {
+/**
+ * @brief Computes the range the exact difference of a candidate lies in.
+ *
+ * The lost lines may only add consumption, unless the first line of the
+ * station may be among them: its capacity is then either the one seen or
+ * that of the lost line, from 0 up to the error.
+ *
+ * @param candidate The candidate.
+ * @param low Receives the smallest possible difference.
+ * @param high Receives the largest possible difference.
+ */
+
+    long difference = estimatedDifference(candidate);
+    if (candidate->firstSeen) {
+        *low = difference - candidate->error;
+        *high = difference;
+        return;
+    }
+
+    long capacity = candidate->capacity;
+    *low = (capacity < 0 ? capacity : 0) - candidate->consumption - candidate->error;
+    *high = (capacity > candidate->error ? capacity : candidate->error) - candidate->consumption;
+}
+
+void verifyCandidate(CandidateTable* table, int key, long capacity, long consumption) {
+/**
+ * @brief Replaces the estimated aggregate of a candidate with the exact one from a second pass.
+ *
+ * @param table The table.
+ * @param key The station ID; ignored if it is not a candidate.
+ * @param capacity The exact capacity.
+ * @param consumption The exact consumption.
+ */
+
+    int slot = findSlot(table, key);
+    if (table->index[slot] == NO_CANDIDATE) return;
+    Candidate* candidate = &table->entries[table->index[slot]];
+    candidate->capacity = capacity;
+    candidate->consumption = consumption;
+    candidate->error = 0;
+    candidate->firstSeen = 1;
+}
+
+size_t candidatesMemory(const CandidateTable* table) {
+/**
+ * @brief Returns the bytes allocated by a table, which do not change while it is filled.
+ */
+
+    if (!table->entries) return 0;
+    return (size_t)table->size * sizeof(Candidate) + (size_t)(table->indexMask + 1) * sizeof(int) +
+           (size_t)SKETCH_ROWS * (table->sketchMask + 1) * sizeof(long) + (size_t)(table->markMask + 1) / 8;
+}
+
+void freeCandidates(CandidateTable* table) {
+/**
+ * @brief Frees the memory held by a table and leaves it empty.
+ *
+ * @param table The table to free.
+ */
+
+    free(table->entries);
+    free(table->index);
+    free(table->sketch);
+    free(table->marks);
+    memset(table, 0, sizeof(*table));
+}
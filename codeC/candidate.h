@@ -0,0 +1,64 @@
+#ifndef CANDIDATE_H
+#define CANDIDATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Fewest candidates a bounded table keeps; with more stations than that, both ends of a ranking hold 10 stations
+#define MIN_CANDIDATES 64
+
+// Most candidates a bounded table keeps, about 150 MB; every mask of the table then fits an int
+#define MAX_CANDIDATES (1 << 20)
+
+// Rows of the sketch of the dropped stations, each with about as many counters as there are candidates
+#define SKETCH_ROWS 4
+
+// Bits per candidate of the filter marking the dropped stations, and bits marked per station
+#define DROP_MARK_BITS 512
+#define DROP_MARK_HASHES 8
+
+// Index slot holding no candidate
+#define NO_CANDIDATE -1
+
+// One station kept by a bounded table and its aggregate since it was last taken in
+// error bounds the capacity and consumption of the station that were dropped before, or were lost by a merge;
+// firstSeen tells that the first line of the station, which sets its capacity, was not among them
+typedef struct {
+    int key;
+    long capacity;
+    long consumption;
+    long error;
+    int firstSeen;
+} Candidate;
+
+// At most size stations, those with the largest and smallest differences, indexed by key with linear probing
+// When the table is full, the middle half of it is dropped: the dropped stations are marked in a Bloom filter, their
+// capacity and consumption are added to a count-min sketch, and their differences widen the range every station
+// outside the table lies in
+typedef struct {
+    Candidate* entries;
+    int* index;
+    int indexMask;
+    int size;
+    int count;
+    long* sketch;
+    int sketchMask;
+    uint64_t* marks;
+    int markMask;
+    long dropped;
+    long droppedLow;
+    long droppedHigh;
+    int verified;
+} CandidateTable;
+
+// Candidate table function prototypes
+void initCandidates(CandidateTable* table, int size);
+void addCandidate(CandidateTable* table, int key, long capacity, long consumption);
+void mergeCandidates(CandidateTable* table, CandidateTable* other);
+const Candidate* findCandidate(const CandidateTable* table, int key);
+void candidateBounds(const Candidate* candidate, long* low, long* high);
+void verifyCandidate(CandidateTable* table, int key, long capacity, long consumption);
+size_t candidatesMemory(const CandidateTable* table);
+void freeCandidates(CandidateTable* table);
+
+#endif
@@ -0,0 +1,405 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "chart.h"
+#include "png.h"
+
+// Palette of the PNG chart
+enum { COLOR_WHITE, COLOR_BLACK, COLOR_GRID, COLOR_RED, COLOR_GREEN, COLOR_COUNT };
+
+static const uint8_t chartPalette[COLOR_COUNT][3] = {
+    {255, 255, 255}, {0, 0, 0}, {192, 192, 192}, {255, 0, 0}, {0, 255, 0}
+};
+
+// 3x5 pixel font of the PNG chart; lowercase letters are drawn as capitals
+static const char glyphChars[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ()-+.,:_/^";
+
+static const unsigned char glyphRows[][5] = {
+    {7, 5, 5, 5, 7}, {2, 6, 2, 2, 7}, {7, 1, 7, 4, 7}, {7, 1, 3, 1, 7}, {5, 5, 7, 1, 1}, {7, 4, 7, 1, 7}, {7, 4, 7, 5, 7}, {7, 1, 1, 2, 2},
+    {7, 5, 7, 5, 7}, {7, 5, 7, 1, 7}, {2, 5, 7, 5, 5}, {6, 5, 6, 5, 6}, {3, 4, 4, 4, 3}, {6, 5, 5, 5, 6}, {7, 4, 6, 4, 7}, {7, 4, 6, 4, 4},
+    {3, 4, 5, 5, 3}, {5, 5, 7, 5, 5}, {7, 2, 2, 2, 7}, {1, 1, 1, 5, 2}, {5, 5, 6, 5, 5}, {4, 4, 4, 4, 7}, {5, 7, 7, 5, 5}, {6, 5, 5, 5, 5},
+    {2, 5, 5, 5, 2}, {6, 5, 6, 4, 4}, {2, 5, 5, 6, 3}, {6, 5, 6, 5, 5}, {3, 4, 2, 1, 6}, {7, 2, 2, 2, 2}, {5, 5, 5, 5, 7}, {5, 5, 5, 5, 2},
+    {5, 5, 7, 7, 5}, {5, 5, 2, 5, 5}, {5, 5, 2, 2, 2}, {7, 1, 2, 4, 7}, {2, 4, 4, 4, 2}, {2, 1, 1, 1, 2}, {0, 0, 7, 0, 0}, {0, 2, 7, 2, 0},
+    {0, 0, 0, 0, 2}, {0, 0, 0, 2, 4}, {0, 2, 0, 2, 0}, {0, 0, 0, 0, 7}, {1, 1, 2, 4, 4}, {2, 5, 0, 0, 0}
+};
+
+// Text anchors: the reference point is at the start, middle or end of the text
+enum { ANCHOR_START, ANCHOR_MIDDLE, ANCHOR_END };
+
+// Scale of the chart: decades of the logarithmic y axis and number of station pairs on the x axis
+typedef struct {
+    int count;
+    int firstDecade;
+    int lastDecade;
+    int decadeStep;
+} ChartLayout;
+
+static const char* const chartTitle = "Top 10 and Bottom 10 Stations by Difference";
+static const char* const chartLabels[2] = {"Overload (Top 10)", "Underutilized (Bottom 10)"};
+
+int parseChartFormats(const char* name, int* formats) {
+/**
+ * @brief Parses the chart formats given on the command line.
+ *
+ * @param name svg, png, both or none.
+ * @param formats Receives the formats, as CHART_SVG and CHART_PNG bits.
+ * @return 0 on success, -1 if the name is unknown.
+ */
+
+    if (strcmp(name, "svg") == 0) {
+        *formats = CHART_SVG;
+    } else if (strcmp(name, "png") == 0) {
+        *formats = CHART_PNG;
+    } else if (strcmp(name, "both") == 0) {
+        *formats = CHART_SVG | CHART_PNG;
+    } else if (strcmp(name, "none") == 0) {
+        *formats = 0;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+static long barValue(const StationDiff* stations, int side, int i) {
+/**
+ * @brief Returns the height of a bar, as plotted by the Gnuplot script.
+ *
+ * @param stations The top stations (side 0) or the bottom stations (side 1).
+ * @param side 0 for the top stations (their difference), 1 for the bottom ones (minus their difference).
+ * @param i The rank of the station.
+ * @return The value of the bar; values <= 0 cannot be drawn on the logarithmic axis.
+ */
+
+    return side == 0 ? stations[i].difference : -stations[i].difference;
+}
+
+static void layoutChart(ChartLayout* layout, const StationDiff* top, const StationDiff* bottom, int count) {
+/**
+ * @brief Chooses whole decades for the y axis so that every drawable bar fits.
+ *
+ * @param layout Receives the scale.
+ * @param top The top stations.
+ * @param bottom The bottom stations.
+ * @param count The number of stations on each side.
+ */
+
+    long smallest = 0;
+    long largest = 0;
+    for (int side = 0; side < 2; side++) {
+        for (int i = 0; i < count; i++) {
+            long value = barValue(side == 0 ? top : bottom, side, i);
+            if (value <= 0) continue;
+            if (smallest == 0 || value < smallest) smallest = value;
+            if (value > largest) largest = value;
+        }
+    }
+
+    layout->count = count;
+    layout->firstDecade = 0;
+    layout->lastDecade = 1;
+    if (largest > 0) {
+        layout->firstDecade = (int)floor(log10((double)smallest));
+        layout->lastDecade = (int)ceil(log10((double)largest));
+        if (layout->lastDecade <= layout->firstDecade) layout->lastDecade = layout->firstDecade + 1;
+    }
+    layout->decadeStep = 1 + (layout->lastDecade - layout->firstDecade) / 10;
+}
+
+static double chartX(const ChartLayout* layout, double x) {
+/**
+ * @brief Converts an x coordinate of the plot (-1 to count) to a pixel column.
+ */
+
+    return CHART_LEFT + (x + 1) / (layout->count + 1) * (CHART_WIDTH - CHART_LEFT - CHART_RIGHT);
+}
+
+static double chartY(const ChartLayout* layout, double value) {
+/**
+ * @brief Converts a positive value to a pixel row on the logarithmic axis.
+ */
+
+    double t = (log10(value) - layout->firstDecade) / (layout->lastDecade - layout->firstDecade);
+    return CHART_HEIGHT - CHART_BOTTOM - t * (CHART_HEIGHT - CHART_TOP - CHART_BOTTOM);
+}
+
+static void decadeLabel(char* label, int decade) {
+/**
+ * @brief Formats the label of a power of ten: 1, 10, 100, 1000, then 1e4, 1e5...
+ */
+
+    if (decade >= 0 && decade <= 3) {
+        sprintf(label, "%d", decade == 0 ? 1 : decade == 1 ? 10 : decade == 2 ? 100 : 1000);
+    } else {
+        sprintf(label, "1e%d", decade);
+    }
+}
+
+int writeChartSvg(const char* path, const StationDiff* top, const StationDiff* bottom, int count) {
+/**
+ * @brief Draws the top/bottom difference bar chart of the Gnuplot script as an SVG file.
+ *
+ * The layout follows the script: logarithmic y axis with a grid on its
+ * tics, red bars for the top stations and green bars (minus the
+ * difference) for the bottom stations side by side, station IDs rotated
+ * by -45 degrees under their bars, title, axis labels and legend.
+ *
+ * @param path The path of the SVG file.
+ * @param top The top stations, from the largest difference down.
+ * @param bottom The bottom stations, from the smallest difference up.
+ * @param count The number of stations on each side.
+ * @return 0 on success, -1 on error (errno is set).
+ */
+
+    static const char* const colors[2] = {"#ff0000", "#00ff00"};
+    ChartLayout layout;
+    layoutChart(&layout, top, bottom, count);
+
+    FILE* svg = fopen(path, "w");
+    if (!svg) return -1;
+
+    int plotLeft = CHART_LEFT;
+    int plotRight = CHART_WIDTH - CHART_RIGHT;
+    int plotTop = CHART_TOP;
+    int plotBottom = CHART_HEIGHT - CHART_BOTTOM;
+
+    fprintf(svg, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    fprintf(svg, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%d\" height=\"%d\" viewBox=\"0 0 %d %d\" "
+                 "font-family=\"sans-serif\" font-size=\"12\">\n", CHART_WIDTH, CHART_HEIGHT, CHART_WIDTH, CHART_HEIGHT);
+    fprintf(svg, "<rect width=\"100%%\" height=\"100%%\" fill=\"#ffffff\"/>\n");
+    fprintf(svg, "<text x=\"%d\" y=\"%d\" text-anchor=\"middle\" font-size=\"16\">%s</text>\n",
+            CHART_WIDTH / 2, CHART_TOP / 2 + 6, chartTitle);
+
+    // Grid and tics of the logarithmic axis
+    for (int decade = layout.firstDecade; decade <= layout.lastDecade; decade += layout.decadeStep) {
+        char label[32];
+        double y = chartY(&layout, pow(10, decade));
+        decadeLabel(label, decade);
+        fprintf(svg, "<line x1=\"%d\" y1=\"%.1f\" x2=\"%d\" y2=\"%.1f\" stroke=\"#c0c0c0\" stroke-dasharray=\"2,3\"/>\n",
+                plotLeft, y, plotRight, y);
+        fprintf(svg, "<text x=\"%d\" y=\"%.1f\" text-anchor=\"end\">%s</text>\n", plotLeft - 8, y + 4, label);
+    }
+
+    // Bars and rotated station IDs
+    for (int side = 0; side < 2; side++) {
+        const StationDiff* stations = side == 0 ? top : bottom;
+        for (int i = 0; i < count; i++) {
+            double x = i + (side == 0 ? -0.2 : 0.2);
+            long value = barValue(stations, side, i);
+            if (value > 0) {
+                double left = chartX(&layout, x - 0.2);
+                double right = chartX(&layout, x + 0.2);
+                double y = chartY(&layout, (double)value);
+                fprintf(svg, "<rect x=\"%.1f\" y=\"%.1f\" width=\"%.1f\" height=\"%.1f\" fill=\"%s\" stroke=\"#000000\"/>\n",
+                        left, y, right - left, plotBottom - y, colors[side]);
+            }
+            double tic = chartX(&layout, x);
+            fprintf(svg, "<text x=\"%.1f\" y=\"%d\" transform=\"rotate(45 %.1f %d)\">%d</text>\n",
+                    tic, plotBottom + 14, tic, plotBottom + 14, stations[i].key);
+        }
+    }
+
+    fprintf(svg, "<rect x=\"%d\" y=\"%d\" width=\"%d\" height=\"%d\" fill=\"none\" stroke=\"#000000\"/>\n",
+            plotLeft, plotTop, plotRight - plotLeft, plotBottom - plotTop);
+
+    // Legend in the top right corner
+    for (int side = 0; side < 2; side++) {
+        int y = plotTop + 20 + 18 * side;
+        fprintf(svg, "<text x=\"%d\" y=\"%d\" text-anchor=\"end\">%s</text>\n", plotRight - 60, y, chartLabels[side]);
+        fprintf(svg, "<rect x=\"%d\" y=\"%d\" width=\"40\" height=\"10\" fill=\"%s\" stroke=\"#000000\"/>\n",
+                plotRight - 50, y - 9, colors[side]);
+    }
+
+    fprintf(svg, "<text x=\"%d\" y=\"%d\" text-anchor=\"middle\" transform=\"rotate(-90 %d %d)\">Difference (kW)</text>\n",
+            24, (plotTop + plotBottom) / 2, 24, (plotTop + plotBottom) / 2);
+    fprintf(svg, "<text x=\"%d\" y=\"%d\" text-anchor=\"middle\">Station ID</text>\n",
+            (plotLeft + plotRight) / 2, CHART_HEIGHT - 12);
+    fprintf(svg, "</svg>\n");
+
+    int failed = ferror(svg);
+    if (fclose(svg) != 0 || failed) return -1;
+    return 0;
+}
+
+static void fillRect(PaletteImage* image, int x0, int y0, int x1, int y1, uint8_t color) {
+/**
+ * @brief Fills the pixels [x0, x1) x [y0, y1) of an image, clipped to the image.
+ */
+
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 > image->width) x1 = image->width;
+    if (y1 > image->height) y1 = image->height;
+    for (int y = y0; y < y1; y++) {
+        for (int x = x0; x < x1; x++) {
+            image->pixels[(size_t)y * image->width + x] = color;
+        }
+    }
+}
+
+static void strokeRect(PaletteImage* image, int x0, int y0, int x1, int y1, uint8_t color) {
+/**
+ * @brief Draws the one-pixel outline of the rectangle [x0, x1] x [y0, y1].
+ */
+
+    fillRect(image, x0, y0, x1 + 1, y0 + 1, color);
+    fillRect(image, x0, y1, x1 + 1, y1 + 1, color);
+    fillRect(image, x0, y0, x0 + 1, y1 + 1, color);
+    fillRect(image, x1, y0, x1 + 1, y1 + 1, color);
+}
+
+static const unsigned char* glyphOf(char c) {
+/**
+ * @brief Returns the rows of the glyph of a character, or NULL for a blank.
+ */
+
+    if (c >= 'a' && c <= 'z') c = (char)(c - 'a' + 'A');
+    const char* found = c ? strchr(glyphChars, c) : NULL;
+    return found ? glyphRows[found - glyphChars] : NULL;
+}
+
+static void drawText(PaletteImage* image, double x, double y, const char* text, int scale, int angle, int anchor,
+                     uint8_t color) {
+/**
+ * @brief Draws a line of text with the 3x5 font, scaled and rotated.
+ *
+ * Each pixel of the rotated bounding box is mapped back into the unrotated
+ * text and takes the color of the glyph pixel it falls on, so rotated text
+ * has no holes.
+ *
+ * @param image The image to draw on.
+ * @param x The column of the reference point.
+ * @param y The row of the reference point, at the middle of the text height.
+ * @param text The text.
+ * @param scale The size of a font pixel, in image pixels.
+ * @param angle The rotation, counterclockwise: 0, 90 or -45 degrees.
+ * @param anchor Where the reference point is along the text: ANCHOR_START, ANCHOR_MIDDLE or ANCHOR_END.
+ * @param color The color of the text.
+ */
+
+    // Unit vectors along the text and down its glyphs, in image coordinates
+    double ux = 1, uy = 0;
+    if (angle == 90) {
+        ux = 0;
+        uy = -1;
+    } else if (angle == -45) {
+        ux = uy = 0.70710678;
+    }
+    double vx = -uy, vy = ux;
+
+    double width = (double)strlen(text) * 4 * scale - scale;
+    double height = 5.0 * scale;
+    double startX = anchor == ANCHOR_START ? 0 : anchor == ANCHOR_MIDDLE ? width / 2 : width;
+    double startY = height / 2;
+
+    // Bounding box of the rotated text, from its four corners
+    double minX = x, maxX = x, minY = y, maxY = y;
+    for (int corner = 0; corner < 4; corner++) {
+        double lx = (corner & 1 ? width : 0) - startX;
+        double ly = (corner & 2 ? height : 0) - startY;
+        double cx = x + lx * ux + ly * vx;
+        double cy = y + lx * uy + ly * vy;
+        if (cx < minX) minX = cx;
+        if (cx > maxX) maxX = cx;
+        if (cy < minY) minY = cy;
+        if (cy > maxY) maxY = cy;
+    }
+
+    for (int py = (int)minY - 1; py <= (int)maxY + 1; py++) {
+        for (int px = (int)minX - 1; px <= (int)maxX + 1; px++) {
+            if (px < 0 || py < 0 || px >= image->width || py >= image->height) continue;
+
+            double dx = px + 0.5 - x;
+            double dy = py + 0.5 - y;
+            double lx = startX + dx * ux + dy * uy;
+            double ly = startY + dx * vx + dy * vy;
+            if (lx < 0 || ly < 0 || lx >= width || ly >= height) continue;
+
+            int cell = (int)lx / scale;
+            int column = cell % 4;
+            const unsigned char* glyph = glyphOf(text[cell / 4]);
+            if (column < 3 && glyph && (glyph[(int)ly / scale] >> (2 - column)) & 1) {
+                image->pixels[(size_t)py * image->width + px] = color;
+            }
+        }
+    }
+}
+
+int writeChartPng(const char* path, const StationDiff* top, const StationDiff* bottom, int count) {
+/**
+ * @brief Draws the same chart as writeChartSvg() into a palette image and writes it as a PNG file.
+ *
+ * @param path The path of the PNG file.
+ * @param top The top stations, from the largest difference down.
+ * @param bottom The bottom stations, from the smallest difference up.
+ * @param count The number of stations on each side.
+ * @return 0 on success, -1 on error (errno is set).
+ */
+
+    static const uint8_t colors[2] = {COLOR_RED, COLOR_GREEN};
+    ChartLayout layout;
+    layoutChart(&layout, top, bottom, count);
+
+    PaletteImage image;
+    image.width = CHART_WIDTH;
+    image.height = CHART_HEIGHT;
+    image.palette = chartPalette;
+    image.colors = COLOR_COUNT;
+    image.pixels = calloc((size_t)CHART_WIDTH * CHART_HEIGHT, 1);
+    if (!image.pixels) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+
+    int plotLeft = CHART_LEFT;
+    int plotRight = CHART_WIDTH - CHART_RIGHT;
+    int plotTop = CHART_TOP;
+    int plotBottom = CHART_HEIGHT - CHART_BOTTOM;
+
+    drawText(&image, CHART_WIDTH / 2.0, CHART_TOP / 2.0, chartTitle, 3, 0, ANCHOR_MIDDLE, COLOR_BLACK);
+
+    for (int decade = layout.firstDecade; decade <= layout.lastDecade; decade += layout.decadeStep) {
+        char label[32];
+        int y = (int)chartY(&layout, pow(10, decade));
+        decadeLabel(label, decade);
+        for (int x = plotLeft; x < plotRight; x += 5) {
+            fillRect(&image, x, y, x + 2, y + 1, COLOR_GRID);
+        }
+        drawText(&image, plotLeft - 8, y, label, 2, 0, ANCHOR_END, COLOR_BLACK);
+    }
+
+    for (int side = 0; side < 2; side++) {
+        const StationDiff* stations = side == 0 ? top : bottom;
+        for (int i = 0; i < count; i++) {
+            double x = i + (side == 0 ? -0.2 : 0.2);
+            long value = barValue(stations, side, i);
+            if (value > 0) {
+                int left = (int)chartX(&layout, x - 0.2);
+                int right = (int)chartX(&layout, x + 0.2);
+                int y = (int)chartY(&layout, (double)value);
+                fillRect(&image, left, y, right, plotBottom, colors[side]);
+                strokeRect(&image, left, y, right, plotBottom, COLOR_BLACK);
+            }
+
+            char key[16];
+            sprintf(key, "%d", stations[i].key);
+            drawText(&image, chartX(&layout, x), plotBottom + 10, key, 2, -45, ANCHOR_START, COLOR_BLACK);
+        }
+    }
+
+    strokeRect(&image, plotLeft, plotTop, plotRight, plotBottom, COLOR_BLACK);
+
+    for (int side = 0; side < 2; side++) {
+        int y = plotTop + 16 + 16 * side;
+        drawText(&image, plotRight - 60, y, chartLabels[side], 2, 0, ANCHOR_END, COLOR_BLACK);
+        fillRect(&image, plotRight - 50, y - 5, plotRight - 10, y + 5, colors[side]);
+        strokeRect(&image, plotRight - 50, y - 5, plotRight - 10, y + 5, COLOR_BLACK);
+    }
+
+    drawText(&image, 24, (plotTop + plotBottom) / 2.0, "Difference (kW)", 2, 90, ANCHOR_MIDDLE, COLOR_BLACK);
+    drawText(&image, (plotLeft + plotRight) / 2.0, CHART_HEIGHT - 14, "Station ID", 2, 0, ANCHOR_MIDDLE, COLOR_BLACK);
+
+    int status = writePng(path, &image);
+    free(image.pixels);
+    return status;
+}
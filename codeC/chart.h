@@ -0,0 +1,26 @@
+#ifndef CHART_H
+#define CHART_H
+
+#include "station.h"
+
+// Chart formats written for lv all, combined as bits; the Gnuplot script is only written, never run
+#define CHART_SVG 1
+#define CHART_PNG 2
+#define CHART_GNUPLOT 4
+
+// Size of the chart, as in the Gnuplot script
+#define CHART_WIDTH 1200
+#define CHART_HEIGHT 600
+
+// Margins around the plot area, in pixels
+#define CHART_LEFT 110
+#define CHART_RIGHT 40
+#define CHART_TOP 50
+#define CHART_BOTTOM 130
+
+// Chart function prototypes
+int parseChartFormats(const char* name, int* formats);
+int writeChartSvg(const char* path, const StationDiff* top, const StationDiff* bottom, int count);
+int writeChartPng(const char* path, const StationDiff* top, const StationDiff* bottom, int count);
+
+#endif
@@ -0,0 +1,217 @@
+#include <pthread.h>
+#include <string.h>
+#include "chunk.h"
+#include "input.h"
+#include "scan.h"
+
+int splitChunks(const char* begin, const char* end, Chunk* chunks, int count) {
+/**
+ * @brief Splits a block of complete lines into at most count line-aligned chunks.
+ *
+ * Chunks are cut at roughly equal sizes and then moved forward to the next
+ * line boundary, so no line is shared between two chunks. Only begin and end
+ * are set; the other fields of the chunks are left untouched.
+ *
+ * @param begin The first byte of the block.
+ * @param end The byte past the end of the block.
+ * @param chunks The array receiving the chunks.
+ * @param count The maximum number of chunks.
+ * @return The number of non-empty chunks produced.
+ */
+
+    size_t size = (size_t)(end - begin);
+    const char* start = begin;
+    int produced = 0;
+
+    for (int i = 0; i < count && start < end; i++) {
+        const char* stop = end;
+        if (i < count - 1) {
+            stop = begin + size / (size_t)count * (size_t)(i + 1);
+            if (stop <= start) continue;
+            const char* newline = memchr(stop - 1, '\n', (size_t)(end - stop + 1));
+            stop = newline ? newline + 1 : end;
+        }
+
+        chunks[produced].begin = start;
+        chunks[produced].end = stop;
+        produced++;
+        start = stop;
+    }
+
+    return produced;
+}
+
+static void addDiagnostic(Chunk* chunk, int line, IgnoreReason reason) {
+/**
+ * @brief Records an ignored line of a chunk.
+ *
+ * @param chunk The chunk the line belongs to.
+ * @param line The line number, counted from the start of the chunk.
+ * @param reason Why the line was ignored.
+ */
+
+    if (chunk->diagnosticCount >= chunk->diagnosticSize) {
+        chunk->diagnosticSize = chunk->diagnosticSize ? chunk->diagnosticSize * 2 : 16;
+        chunk->diagnostics = realloc(chunk->diagnostics, chunk->diagnosticSize * sizeof(Diagnostic));
+        if (!chunk->diagnostics) {
+            perror("Memory reallocation error");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    chunk->diagnostics[chunk->diagnosticCount].line = line;
+    chunk->diagnostics[chunk->diagnosticCount].reason = reason;
+    chunk->diagnosticCount++;
+}
+
+static void aggregateRecord(Chunk* chunk, const Record* record, int lineNumber, const char* line, const char* next) {
+/**
+ * @brief Adds one parsed line to every report of the chunk whose filter selects it.
+ *
+ * @param chunk The chunk the line belongs to; its reports and counters are updated.
+ * @param record The parsed line.
+ * @param lineNumber The number of the line reported by diagnostics.
+ * @param line The first byte of the line text, or NULL when it comes from the column cache.
+ * @param next The first byte of the next line, or NULL.
+ */
+
+    ReportSet* set = &chunk->reports;
+    PlantReports* plant = NULL;
+    int ignored = 0;
+    chunk->lines++;
+
+    // The per-plant variants count their lines exactly as a query restricted to their plant would
+    if (set->perPlant && !((record->dash | record->empty | record->text) & COLUMN_BIT(COL_PLANT))) {
+        plant = findPlantReports(set, (int)record->value[COL_PLANT]);
+    }
+
+    for (int i = 0; i < set->count; i++) {
+        Report* report = &set->reports[i];
+        Report* variant = plant ? &plant->reports[i] : NULL;
+        if (report->filter.plantId != -1 && plantMatches(&report->filter, record)) report->plantLines++;
+        if (variant) variant->plantLines++;
+        if (!filterMatches(&report->filter, record)) continue;
+        report->keptLines++;
+        if (variant) variant->keptLines++;
+
+        if (chunk->debugFile && line && i == 0) {
+            fwrite(line, 1, (size_t)(next - line), chunk->debugFile);
+            if (next[-1] != '\n') fputc('\n', chunk->debugFile);
+        }
+
+        if (record->empty & COLUMN_BIT(report->filter.keyColumn)) {
+            report->stats.ignoredLines++;
+            if (variant) variant->stats.ignoredLines++;
+            if (!ignored++) addDiagnostic(chunk, lineNumber, IGNORED_EMPTY_KEY);
+            continue;
+        }
+
+        if (record->empty & COLUMN_BIT(COL_CAPACITY)) {
+            report->stats.ignoredLines++;
+            if (variant) variant->stats.ignoredLines++;
+            if (!ignored++) addDiagnostic(chunk, lineNumber, IGNORED_EMPTY_CAPACITY);
+            continue;
+        }
+
+        int key = (int)record->value[report->filter.keyColumn];
+        addStation(&report->stations, key, record->value[COL_CAPACITY], record->value[COL_LOAD]);
+        if (variant) addStation(&variant->stations, key, record->value[COL_CAPACITY], record->value[COL_LOAD]);
+    }
+}
+
+void parseChunk(Chunk* chunk) {
+/**
+ * @brief Parses the lines of a chunk and aggregates them into the chunk's own reports.
+ *
+ * Each line is parsed once and added to every report whose filter selects
+ * it, and to the per-plant variant of those reports when requested.
+ * Duplicate keys are summed by addStation() as in a sequential run. Ignored
+ * lines are recorded in the chunk rather than printed, so that chunks parsed
+ * concurrently can report them in input order afterwards. When the chunk
+ * has a column cache, the rows of its runs that fall in its window are read
+ * instead of the text, and diagnostics are numbered from the window start.
+ *
+ * @param chunk The chunk to parse; its reports and counters are updated.
+ */
+
+    if (chunk->cache) {
+        for (size_t r = 0; r < chunk->runCount; r++) {
+            size_t first = chunk->runs[r].firstRow > chunk->firstRow ? chunk->runs[r].firstRow : chunk->firstRow;
+            size_t end = chunk->runs[r].endRow < chunk->endRow ? chunk->runs[r].endRow : chunk->endRow;
+            for (size_t row = first; row < end; row++) {
+                Record record;
+                loadRecord(chunk->cache, row, &record);
+                aggregateRecord(chunk, &record, (int)(row - chunk->firstRow + 1), NULL, NULL);
+            }
+        }
+        return;
+    }
+
+    const char* line = chunk->begin;
+    Scanner scanner;
+    initScanner(&scanner, chunk->begin, chunk->end);
+    while (line < chunk->end) {
+        Record record;
+        const char* next = scanRecord(&scanner, &record);
+        aggregateRecord(chunk, &record, chunk->lines + 1, line, next);
+        line = next;
+    }
+}
+
+static void* chunkWorker(void* argument) {
+/**
+ * @brief Thread entry point parsing one chunk.
+ *
+ * @param argument The chunk to parse.
+ * @return NULL.
+ */
+
+    parseChunk((Chunk*)argument);
+    return NULL;
+}
+
+void parseChunks(Chunk* chunks, int count) {
+/**
+ * @brief Parses several chunks concurrently, one thread per chunk.
+ *
+ * The first chunk is parsed by the calling thread. If a thread cannot be
+ * created, its chunk is parsed by the calling thread as well.
+ *
+ * @param chunks The chunks to parse.
+ * @param count The number of chunks.
+ */
+
+    pthread_t threads[MAX_THREADS];
+    int started[MAX_THREADS] = {0};
+
+    if (count == 0) return;
+
+    for (int i = 1; i < count; i++) {
+        started[i] = pthread_create(&threads[i], NULL, chunkWorker, &chunks[i]) == 0;
+    }
+
+    parseChunk(&chunks[0]);
+
+    for (int i = 1; i < count; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        } else {
+            parseChunk(&chunks[i]);
+        }
+    }
+}
+
+void printDiagnostics(const Chunk* chunk, int firstLine) {
+/**
+ * @brief Prints the ignored lines of a chunk with their line numbers in the whole input.
+ *
+ * @param chunk The parsed chunk.
+ * @param firstLine The number of lines of the input that precede the chunk.
+ */
+
+    for (int i = 0; i < chunk->diagnosticCount; i++) {
+        const Diagnostic* diagnostic = &chunk->diagnostics[i];
+        fprintf(stderr, "Line %d ignored: empty or null %s.\n", firstLine + diagnostic->line,
+                diagnostic->reason == IGNORED_EMPTY_KEY ? "key" : "capacity");
+    }
+}
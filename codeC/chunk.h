@@ -0,0 +1,44 @@
+#ifndef CHUNK_H
+#define CHUNK_H
+
+#include <stdio.h>
+#include "cache.h"
+#include "filter.h"
+#include "report.h"
+
+// Maximum number of worker threads accepted by -j
+#define MAX_THREADS 256
+
+// Reasons for ignoring a selected line
+typedef enum { IGNORED_EMPTY_KEY, IGNORED_EMPTY_CAPACITY } IgnoreReason;
+
+// A selected line that could not be aggregated, numbered from the start of its chunk (from the first row for the cache)
+typedef struct {
+    int line;
+    IgnoreReason reason;
+} Diagnostic;
+
+// A line-aligned slice of the input, or a row window over runs of its column cache, and the partial aggregate built from it
+typedef struct {
+    const char* begin;
+    const char* end;
+    const ColumnCache* cache;
+    const PlantRun* runs;
+    size_t runCount;
+    size_t firstRow;
+    size_t endRow;
+    FILE* debugFile;
+    ReportSet reports;
+    int lines;
+    Diagnostic* diagnostics;
+    int diagnosticCount;
+    int diagnosticSize;
+} Chunk;
+
+// Chunk function prototypes
+int splitChunks(const char* begin, const char* end, Chunk* chunks, int count);
+void parseChunk(Chunk* chunk);
+void parseChunks(Chunk* chunks, int count);
+void printDiagnostics(const Chunk* chunk, int firstLine);
+
+#endif
@@ -0,0 +1,114 @@
+#include <stdlib.h>
+#include <string.h>
+#include "filter.h"
+
+int initFilter(Filter* filter, const char* stationType, const char* consumerType, const char* plantId) {
+/**
+ * @brief Initializes the selection rules from the command-line arguments.
+ *
+ * @param filter The filter to initialize.
+ * @param stationType The station type (hvb, hva or lv).
+ * @param consumerType The consumer type (comp, indiv or all).
+ * @param plantId The plant ID to keep, or "-1" to keep every plant.
+ * @return 0 on success, -1 if the station or consumer type is unknown.
+ */
+
+    if (strcmp(stationType, "hvb") == 0) {
+        filter->station = STATION_HVB;
+        filter->keyColumn = COL_HVB;
+    } else if (strcmp(stationType, "hva") == 0) {
+        filter->station = STATION_HVA;
+        filter->keyColumn = COL_HVA;
+    } else if (strcmp(stationType, "lv") == 0) {
+        filter->station = STATION_LV;
+        filter->keyColumn = COL_LV;
+    } else {
+        return -1;
+    }
+
+    if (strcmp(consumerType, "comp") == 0) {
+        filter->consumer = CONSUMER_COMP;
+    } else if (strcmp(consumerType, "indiv") == 0) {
+        filter->consumer = CONSUMER_INDIV;
+    } else if (strcmp(consumerType, "all") == 0) {
+        filter->consumer = CONSUMER_ALL;
+    } else {
+        return -1;
+    }
+
+    filter->plantId = atoi(plantId);
+    filter->candidates = NULL;
+    return 0;
+}
+
+int filterMatches(const Filter* filter, const Record* record) {
+/**
+ * @brief Applies the station/consumer/plant selection rules to a parsed line.
+ *
+ * hvb and hva keep every line attached to a station of that level except
+ * individual consumers. lv keeps lines attached to an LV station, restricted
+ * to companies (comp), individuals (indiv) or both (all). Lines whose plant
+ * column is text (the "Power plant" header) never match. A filter restricted
+ * to candidates also drops the lines of other stations, and the lines a
+ * report ignores (empty key or capacity), which were reported already.
+ *
+ * @param filter The selection rules.
+ * @param record The parsed line.
+ * @return 1 if the line belongs to the query, 0 otherwise.
+ */
+
+    if (record->dash & COLUMN_BIT(filter->keyColumn)) return 0;
+    if (record->text & COLUMN_BIT(COL_PLANT)) return 0;
+
+    if (filter->station != STATION_LV || filter->consumer == CONSUMER_COMP) {
+        if (!(record->dash & COLUMN_BIT(COL_INDIVIDUAL))) return 0;
+    } else if (filter->consumer == CONSUMER_INDIV) {
+        if (!(record->dash & COLUMN_BIT(COL_COMPANY))) return 0;
+    }
+
+    if (!plantMatches(filter, record)) return 0;
+
+    if (filter->candidates) {
+        if (record->empty & (COLUMN_BIT(filter->keyColumn) | COLUMN_BIT(COL_CAPACITY))) return 0;
+        return findCandidate(filter->candidates, (int)record->value[filter->keyColumn]) != NULL;
+    }
+    return 1;
+}
+
+int plantMatches(const Filter* filter, const Record* record) {
+/**
+ * @brief Applies only the plant selection rule to a parsed line.
+ *
+ * @param filter The selection rules.
+ * @param record The parsed line.
+ * @return 1 if the line belongs to the plant of the query (or the query keeps every plant), 0 otherwise.
+ */
+
+    if (filter->plantId == -1) return 1;
+    if ((record->dash | record->empty | record->text) & COLUMN_BIT(COL_PLANT)) return 0;
+    return record->value[COL_PLANT] == filter->plantId;
+}
+
+const char* stationName(StationType station) {
+/**
+ * @brief Returns the command-line name of a station type.
+ *
+ * @param station The station type.
+ * @return "hvb", "hva" or "lv".
+ */
+
+    static const char* const names[] = {"hvb", "hva", "lv"};
+    return names[station];
+}
+
+const char* consumerName(ConsumerType consumer) {
+/**
+ * @brief Returns the command-line name of a consumer type.
+ *
+ * @param consumer The consumer type.
+ * @return "comp", "indiv" or "all".
+ */
+
+    static const char* const names[] = {"comp", "indiv", "all"};
+    return names[consumer];
+}
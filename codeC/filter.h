@@ -0,0 +1,50 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include "candidate.h"
+
+// Number of ';'-separated columns in a c-wire record
+#define COLUMN_COUNT 8
+
+// Column positions in a c-wire record
+#define COL_PLANT 0
+#define COL_HVB 1
+#define COL_HVA 2
+#define COL_LV 3
+#define COL_COMPANY 4
+#define COL_INDIVIDUAL 5
+#define COL_CAPACITY 6
+#define COL_LOAD 7
+
+// Station levels and consumer categories accepted on the command line
+typedef enum { STATION_HVB, STATION_HVA, STATION_LV } StationType;
+typedef enum { CONSUMER_COMP, CONSUMER_INDIV, CONSUMER_ALL } ConsumerType;
+
+// Bit of a column in the Record masks
+#define COLUMN_BIT(column) (1u << (column))
+
+// One parsed c-wire line; '-', empty and textual columns are flagged per column bit
+typedef struct {
+    long value[COLUMN_COUNT];
+    unsigned char dash;
+    unsigned char empty;
+    unsigned char text;
+} Record;
+
+// Selection rules for one station/consumer/plant query, optionally restricted to the stations of a candidate table
+typedef struct {
+    StationType station;
+    ConsumerType consumer;
+    int plantId;
+    int keyColumn;
+    const CandidateTable* candidates;
+} Filter;
+
+// Filter function prototypes
+int initFilter(Filter* filter, const char* stationType, const char* consumerType, const char* plantId);
+int filterMatches(const Filter* filter, const Record* record);
+int plantMatches(const Filter* filter, const Record* record);
+const char* stationName(StationType station);
+const char* consumerName(ConsumerType consumer);
+
+#endif
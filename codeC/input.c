@@ -0,0 +1,344 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "input.h"
+
+int openInput(InputFile* input, const char* path, ReadAheadMode mode) {
+/**
+ * @brief Opens the input file, memory-mapping it when it is a regular file.
+ *
+ * Pipes, terminals and other non-seekable inputs (or "-" for stdin) are read
+ * by the read-ahead pipeline, or by blocking reads of INPUT_BLOCK_SIZE bytes
+ * with READ_AHEAD_OFF. Any other explicit mode sends regular files through
+ * the pipeline as well, instead of mapping them.
+ *
+ * @param input The input to initialize.
+ * @param path The path of the file to open, or "-" for the standard input.
+ * @param mode How the input is read.
+ * @return 0 on success, -1 on error (errno is set).
+ */
+
+    memset(input, 0, sizeof(*input));
+    input->fd = strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY);
+    if (input->fd < 0) return -1;
+
+    struct stat info;
+    int mappable = mode == READ_AHEAD_DEFAULT || mode == READ_AHEAD_OFF;
+    if (mappable && fstat(input->fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, input->fd, 0);
+        if (data != MAP_FAILED) {
+            madvise(data, (size_t)info.st_size, MADV_SEQUENTIAL);
+            input->mapped = 1;
+            input->data = data;
+            input->size = (size_t)info.st_size;
+            return 0;
+        }
+    }
+
+    if (mode != READ_AHEAD_OFF) {
+        if (startReadAhead(&input->ahead, input->fd, mode) != 0) {
+            int error = errno;
+            if (input->fd != STDIN_FILENO) close(input->fd);
+            errno = error;
+            return -1;
+        }
+        input->pipelined = 1;
+    }
+
+    input->capacity = INPUT_BLOCK_SIZE;
+    input->data = malloc(input->capacity);
+    if (!input->data) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    return 0;
+}
+
+static void carryBytes(InputFile* input, const char* bytes, size_t count) {
+/**
+ * @brief Appends bytes to the partial line carried to the next buffer of the pipeline.
+ *
+ * @param input The pipelined input.
+ * @param bytes The bytes to append.
+ * @param count The number of bytes.
+ */
+
+    if (input->size + count > input->capacity) {
+        while (input->size + count > input->capacity) input->capacity *= 2;
+        input->data = realloc(input->data, input->capacity);
+        if (!input->data) {
+            perror("Memory reallocation error");
+            exit(EXIT_FAILURE);
+        }
+    }
+    memcpy(input->data + input->size, bytes, count);
+    input->size += count;
+}
+
+static int nextPipelinedBlock(InputFile* input, const char** begin, const char** end) {
+/**
+ * @brief Returns the complete lines of the next buffer of the read-ahead pipeline.
+ *
+ * The partial line at the end of a buffer is carried over and copied in
+ * front of the next buffer, in its headroom, so that each buffer gives one
+ * block. A carried line longer than the headroom is completed and returned
+ * as a block of its own instead. The buffer stays valid until the next call.
+ *
+ * @param input The pipelined input.
+ * @param begin Receives the first byte of the block.
+ * @param end Receives the byte past the end of the block.
+ * @return 1 if a block was returned, 0 at the end of the input.
+ */
+
+    // A carried line returned on its own by the previous call has been parsed
+    if (input->used > 0) {
+        input->size = 0;
+        input->used = 0;
+    }
+
+    for (;;) {
+        if (input->bufferUsed == input->bufferSize) {
+            char* data;
+            size_t size;
+            int status = nextReadBuffer(&input->ahead, &data, &size);
+            if (status < 0) perror("Error reading input file");
+            if (status <= 0) {
+                // The last line has no newline
+                if (input->size == 0) return 0;
+                input->used = input->size;
+                *begin = input->data;
+                *end = input->data + input->size;
+                return 1;
+            }
+            input->buffer = data;
+            input->bufferSize = size;
+            input->bufferUsed = 0;
+        }
+
+        char* start = input->buffer + input->bufferUsed;
+        size_t length = input->bufferSize - input->bufferUsed;
+        const char* last = memrchr(start, '\n', length);
+        if (!last) {
+            carryBytes(input, start, length);
+            input->bufferUsed = input->bufferSize;
+            continue;
+        }
+
+        if (input->size > READ_AHEAD_HEADROOM) {
+            const char* first = memchr(start, '\n', length);
+            carryBytes(input, start, (size_t)(first + 1 - start));
+            input->bufferUsed += (size_t)(first + 1 - start);
+            input->used = input->size;
+            *begin = input->data;
+            *end = input->data + input->size;
+            return 1;
+        }
+
+        start -= input->size;
+        memcpy(start, input->data, input->size);
+        input->size = 0;
+        carryBytes(input, last + 1, (size_t)(input->buffer + input->bufferSize - (last + 1)));
+        input->bufferUsed = input->bufferSize;
+
+        *begin = start;
+        *end = last + 1;
+        return 1;
+    }
+}
+
+int nextInputBlock(InputFile* input, const char** begin, const char** end) {
+/**
+ * @brief Returns the next block of complete lines.
+ *
+ * A mapped file is returned as a single block, from the offset given to
+ * skipInput() if any. A pipelined input gives a block per buffer of the
+ * read-ahead ring. Otherwise the block holds every complete line read so
+ * far; the trailing partial line is kept for the next call, and the buffer
+ * grows if a single line does not fit.
+ *
+ * @param input The input to read from.
+ * @param begin Receives the first byte of the block.
+ * @param end Receives the byte past the end of the block.
+ * @return 1 if a block was returned, 0 at the end of the input.
+ */
+
+    if (input->mapped) {
+        if (input->used == input->size) return 0;
+        *begin = input->data + input->used;
+        *end = input->data + input->size;
+        input->used = input->size;
+        return 1;
+    }
+    if (input->pipelined) return nextPipelinedBlock(input, begin, end);
+
+    // Keep the partial line left over by the previous block
+    memmove(input->data, input->data + input->used, input->size - input->used);
+    input->size -= input->used;
+    input->used = 0;
+
+    while (!input->eof) {
+        if (input->size == input->capacity) {
+            const char* lastNewline = memrchr(input->data, '\n', input->size);
+            if (lastNewline) {
+                input->used = (size_t)(lastNewline - input->data) + 1;
+                break;
+            }
+
+            input->capacity *= 2;
+            input->data = realloc(input->data, input->capacity);
+            if (!input->data) {
+                perror("Memory reallocation error");
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        ssize_t count = read(input->fd, input->data + input->size, input->capacity - input->size);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            perror("Error reading input file");
+            input->eof = 1;
+        } else if (count == 0) {
+            input->eof = 1;
+        } else {
+            input->size += (size_t)count;
+        }
+    }
+
+    if (input->eof) input->used = input->size;
+    if (input->used == 0) return 0;
+
+    *begin = input->data;
+    *end = input->data + input->used;
+    return 1;
+}
+
+void skipInput(InputFile* input, size_t offset) {
+/**
+ * @brief Skips the first bytes of a mapped input, which must end a line.
+ *
+ * @param input The mapped input, before its first block is read.
+ * @param offset The number of bytes to skip.
+ */
+
+    if (input->mapped && offset <= input->size) input->used = offset;
+}
+
+void closeInput(InputFile* input) {
+/**
+ * @brief Releases the mapping or buffer of the input and closes it.
+ *
+ * @param input The input to close.
+ */
+
+    if (input->mapped) {
+        munmap(input->data, input->size);
+    } else {
+        free(input->data);
+    }
+    if (input->pipelined) stopReadAhead(&input->ahead);
+    if (input->fd != STDIN_FILENO) close(input->fd);
+    input->data = NULL;
+    input->pipelined = 0;
+}
+
+const char* inputReaderName(const InputFile* input) {
+/**
+ * @brief Names how an open input is read, for the statistics file.
+ *
+ * @param input The input.
+ * @return "mmap", "uring", "thread" for the reader thread of the pipeline, or "read".
+ */
+
+    if (input->mapped) return "mmap";
+    if (input->pipelined) return readAheadName(input->ahead.engine);
+    return "read";
+}
+
+void parseColumn(Record* record, int column, const char* start, const char* stop) {
+/**
+ * @brief Parses one column whose bytes are already delimited; shared by parseRecord() and the vector scanners.
+ *
+ * @param record The record receiving the column.
+ * @param column The column index.
+ * @param start The first byte of the column.
+ * @param stop The ';' or '\n' ending the column, or the end of the buffer.
+ */
+
+    const char* p = start;
+    long value = 0;
+    int negative = 0;
+    int converting = 1;
+
+    if (p < stop && *p == '-') {
+        negative = 1;
+        p++;
+    }
+
+    for (; p < stop; p++) {
+        unsigned digit = (unsigned)(*p - '0');
+        if (digit < 10) {
+            if (converting) value = value * 10 + digit;
+        } else if (*p != '\r') {
+            converting = 0;
+            record->text |= COLUMN_BIT(column);
+        }
+    }
+
+    size_t length = (size_t)(stop - start);
+    if (length > 0 && start[length - 1] == '\r') length--;
+
+    if (length == 0) {
+        record->empty |= COLUMN_BIT(column);
+    } else if (negative && length == 1) {
+        record->dash |= COLUMN_BIT(column);
+    }
+    record->value[column] = negative ? -value : value;
+}
+
+const char* parseRecord(const char* line, const char* end, Record* record) {
+/**
+ * @brief Parses one ';'-separated line in place into a Record.
+ *
+ * Each column is delimited, then converted by parseColumn(): digits are
+ * accumulated as an integer (like atol, conversion stops at the first other
+ * character), a lone '-' marks the column as absent, and empty or missing
+ * columns are flagged as empty. Absent and empty columns are stored as 0.
+ *
+ * @param line The first byte of the line.
+ * @param end The byte past the end of the buffer.
+ * @param record The record receiving the parsed columns.
+ * @return The first byte of the next line.
+ */
+
+    const char* p = line;
+    int column = 0;
+    record->dash = 0;
+    record->empty = 0;
+    record->text = 0;
+
+    while (column < COLUMN_COUNT) {
+        const char* start = p;
+        while (p < end && *p != ';' && *p != '\n') p++;
+        parseColumn(record, column, start, p);
+        column++;
+
+        if (p >= end || *p == '\n') break;
+        p++;
+    }
+
+    // Columns beyond the end of the line are missing
+    for (int i = column; i < COLUMN_COUNT; i++) {
+        record->value[i] = 0;
+        record->empty |= COLUMN_BIT(i);
+    }
+
+    // Skip anything past the eighth column up to the end of the line
+    while (p < end && *p != '\n') p++;
+    return p < end ? p + 1 : end;
+}
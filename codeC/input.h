@@ -0,0 +1,40 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stddef.h>
+#include "filter.h"
+#include "readahead.h"
+
+// Size of the blocks read when the input cannot be memory-mapped
+#define INPUT_BLOCK_SIZE (1 << 20)
+
+// Interval between two checks of a followed input for new lines, in milliseconds
+#define FOLLOW_POLL_MS 10
+
+// Input source: the whole file mapped in memory, buffers of the read-ahead pipeline, or blocks read from a pipe
+// With the pipeline, data holds the partial line carried from one buffer to the next
+typedef struct {
+    int fd;
+    int mapped;
+    char* data;
+    size_t size;
+    size_t used;
+    size_t capacity;
+    int eof;
+    int pipelined;
+    ReadAhead ahead;
+    char* buffer;
+    size_t bufferSize;
+    size_t bufferUsed;
+} InputFile;
+
+// Input function prototypes
+int openInput(InputFile* input, const char* path, ReadAheadMode mode);
+int nextInputBlock(InputFile* input, const char** begin, const char** end);
+void skipInput(InputFile* input, size_t offset);
+void closeInput(InputFile* input);
+const char* inputReaderName(const InputFile* input);
+void parseColumn(Record* record, int column, const char* start, const char* stop);
+const char* parseRecord(const char* line, const char* end, Record* record);
+
+#endif
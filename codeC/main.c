@@ -1,435 +1,1384 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include "tree.h"
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "station.h"
+#include "report.h"
+#include "result.h"
+#include "filter.h"
+#include "input.h"
+#include "cache.h"
+#include "chart.h"
+#include "chunk.h"
+#include "output.h"
+#include "rank.h"
+#include "scan.h"
+#include "server.h"
+#include "shard.h"
+#include "snapshot.h"
+#include "sort.h"
+#include "stats.h"
+
+int writeRankingFiles(const StationDiff* top, const StationDiff* bottom, int selected, const char* suffix) {
+/**
+ * @brief Writes the top 10, bottom 10 and min/max files of lv all from the selected extremes.
+ * 
+ * Each file is written under a temporary name and renamed into place, so a
+ * reader never sees a partial ranking while it is refreshed.
+ * 
+ * @param top The stations with the largest differences, from the largest down.
+ * @param bottom The stations with the smallest differences, from the smallest up.
+ * @param selected The number of stations written to each of the top and bottom files, at most 10.
+ * @param suffix Appended to the output file names (empty, or "_<plant>" for per-plant variants).
+ * @return 0 on success, -1 if a file cannot be written.
+ */
+
+    char path[256];
+    const char* names[2] = {"top10", "bottom10"};
+    const StationDiff* rows[2] = {top, bottom};
+    int status = 0;
+
+    for (int f = 0; f < 2; f++) {
+        sprintf(path, "output/%s_lv_all%s.csv", names[f], suffix);
+        OutputFile file;
+        if (openOutputReplace(&file, path) != 0) {
+            perror("Error opening top/bottom 10 files");
+            return -1;
+        }
+        for (int i = 0; i < selected; i++) {
+            writeStation(&file, &rows[f][i], 1);
+        }
+        if (closeOutput(&file) != 0) {
+            perror("Error writing output file");
+            status = -1;
+        }
+    }
 
-// Structure to dynamically hold station data
-typedef struct {
-    int key;
-    long capacity;
-    double consumption;
-    double difference;
-} StationDiff;
+    // The min/max file holds the top rows followed by the bottom rows, sorted together by difference
+    StationDiff extremes[20];
+    memcpy(extremes, top, selected * sizeof(StationDiff));
+    memcpy(extremes + selected, bottom, selected * sizeof(StationDiff));
 
-int compareByDifference(const void* a, const void* b) {
+    sprintf(path, "output/lv_all_minmax%s.csv", suffix);
+    OutputFile minMaxFile;
+    if (openOutputReplace(&minMaxFile, path) != 0) {
+        perror("Error opening output file");
+        return -1;
+    }
+    writeMinMaxFile(extremes, 2 * selected, &minMaxFile);
+    if (closeOutput(&minMaxFile) != 0) {
+        perror("Error writing output file");
+        status = -1;
+    }
+    return status;
+}
+
+void generateGnuplotScript(const char* scriptPath, const char* top10Path, const char* bottom10Path, const char* outputPath) {
 /**
- * @brief Compares two StationDiff structures by their difference values.
+ * @brief Generates a Gnuplot script for visualizing the top and bottom 10 stations.
  * 
- * @param a Pointer to the first StationDiff structure.
- * @param b Pointer to the second StationDiff structure.
- * @return An integer less than, equal to, or greater than zero if the difference
- *         of the first structure is less than, equal to, or greater than that of the second.
+ * @param scriptPath The path to save the Gnuplot script file.
+ * @param top10Path The path to the file containing the top 10 stations.
+ * @param bottom10Path The path to the file containing the bottom 10 stations.
+ * @param outputPath The path to save the generated chart image.
  */
 
-    const StationDiff* stationA = (const StationDiff*)a;
-    const StationDiff* stationB = (const StationDiff*)b;
+    FILE* gp = fopen(scriptPath, "w");
+    if (!gp) {
+        perror("Error opening Gnuplot script file");
+        return;
+    }
+
+    fprintf(gp,
+    "set logscale y\n"
+    "set terminal png size 1200,600\n"
+    "set output '%s'\n"
+    "set title 'Top 10 and Bottom 10 Stations by Difference'\n"
+    "set boxwidth 0.4 relative\n" // Réduit la largeur des barres
+    "set style fill solid border -1\n"
+    "set ylabel 'Difference (kW)'\n"
+    "set xlabel 'Station ID'\n"
+    "set xtics rotate by -45\n"
+    "set grid ytics\n"
+    "set datafile separator \":\"\n"
+    "plot '%s' using ($0-0.2):4:xtic(1) with boxes title 'Overload (Top 10)' lc rgb 'red',\\\n"
+    "     '%s' using ($0+0.2):($4*(-1)):xtic(1) with boxes title 'Underutilized (Bottom 10)' lc rgb 'green'\n",
+    outputPath, top10Path, bottom10Path);
+    
 
-    if (stationA->difference < stationB->difference) return -1;
-    if (stationA->difference > stationB->difference) return 1;
-    return 0;
+
+    fclose(gp);
 }
 
-int compareByCapacity(const void* a, const void* b) {
+void mergeChunks(ReportSet* reports, Chunk* chunks, int count, int* lineNumber, RunStats* stats) {
 /**
- * @brief Compares two StationDiff structures by their capacity values.
+ * @brief Reports the ignored lines of parsed chunks and merges their partial reports in input order.
  * 
- * @param a Pointer to the first StationDiff structure.
- * @param b Pointer to the second StationDiff structure.
- * @return An integer less than, equal to, or greater than zero if the capacity
- *         of the first structure is less than, equal to, or greater than that of the second.
+ * @param reports The reports receiving the aggregates.
+ * @param chunks The parsed chunks, in input order; their reports are freed.
+ * @param count The number of chunks.
+ * @param lineNumber The number of lines before the first chunk; advanced past the last one.
+ * @param stats The run statistics receiving the ignored line counts and the merge time.
  */
 
-    const StationDiff* stationA = (const StationDiff*)a;
-    const StationDiff* stationB = (const StationDiff*)b;
+    double start = statsClock();
 
-    if (stationA->capacity < stationB->capacity) return -1;
-    if (stationA->capacity > stationB->capacity) return 1;
-    return 0;
+    for (int i = 0; i < count; i++) {
+        for (int d = 0; d < chunks[i].diagnosticCount; d++) {
+            if (chunks[i].diagnostics[d].reason == IGNORED_EMPTY_KEY) {
+                stats->ignoredEmptyKey++;
+            } else {
+                stats->ignoredEmptyCapacity++;
+            }
+        }
+        printDiagnostics(&chunks[i], chunks[i].cache ? (int)chunks[i].firstRow : *lineNumber);
+        free(chunks[i].diagnostics);
+        *lineNumber += chunks[i].lines;
+        mergeReportSet(reports, &chunks[i].reports);
+    }
+
+    addTimer(&stats->timers, "merge", statsClock() - start);
 }
 
-void collectStations(AVLNode* root, StationDiff** stations, int* count, int* size) {
+void printReadSummary(const ReportSet* reports, int lineNumber, RunStats* stats) {
 /**
- * @brief Collects all stations from an AVL tree into a dynamic array of StationDiff structures.
+ * @brief Prints the number of lines read and kept by each report.
  * 
- * @param root The root of the AVL tree.
- * @param stations Pointer to the dynamic array of StationDiff structures.
- * @param count Pointer to the number of stations collected so far.
- * @param size Pointer to the current size of the dynamic array.
+ * @param reports The aggregated reports.
+ * @param lineNumber The number of lines read.
+ * @param stats The run statistics receiving the number of lines read.
  */
 
-    if (!root) return;
+    stats->linesRead = lineNumber;
+    printf("File reading completed. Total lines read: %d", lineNumber);
+    for (int i = 0; i < reports->count; i++) {
+        const Filter* filter = &reports->reports[i].filter;
+        printf(", %s %s: %d kept", stationName(filter->station), consumerName(filter->consumer),
+               reports->reports[i].keptLines);
+    }
+    printf("\n");
+}
 
-    collectStations(root->left, stations, count, size);
+void aggregateChunks(ReportSet* reports, Chunk* chunks, int count, FILE* debugFile, int* lineNumber,
+                     RunStats* stats) {
+/**
+ * @brief Parses split chunks in parallel into private copies of the reports, then merges them in order.
+ * 
+ * @param reports The reports receiving the aggregates.
+ * @param chunks The chunks returned by splitChunks(), in input order.
+ * @param count The number of chunks.
+ * @param debugFile If not NULL, receives a copy of every line selected by the first report.
+ * @param lineNumber The number of lines before the first chunk; advanced past the last one.
+ * @param stats The run statistics.
+ */
 
-    if (*count >= *size) {
-        *size *= 2;
-        *stations = realloc(*stations, (*size) * sizeof(StationDiff));
-        if (!*stations) {
-            perror("Memory reallocation error");
-            exit(EXIT_FAILURE);
-        }
+    for (int i = 0; i < count; i++) {
+        chunks[i].debugFile = debugFile;
+        copyReportSet(&chunks[i].reports, reports);
+    }
+
+    // A single chunk carries on with the aggregate itself, which the merge hands back whole: a bounded
+    // table then never merges a partial table that dropped stations of its own
+    if (count == 1) {
+        ReportSet empty = chunks[0].reports;
+        chunks[0].reports = *reports;
+        *reports = empty;
     }
 
-    (*stations)[*count].key = root->key;
-    (*stations)[*count].capacity = root->capacity;
-    (*stations)[*count].consumption = root->consumption;
-    (*stations)[*count].difference = root->capacity - root->consumption;
-    (*count)++;
+    double start = statsClock();
+    parseChunks(chunks, count);
+    addTimer(&stats->timers, "parse_aggregate", statsClock() - start);
 
-    collectStations(root->right, stations, count, size);
+    mergeChunks(reports, chunks, count, lineNumber, stats);
 }
 
-void inorderTraversalToSortedFile(AVLNode* root, FILE* outputFile) {
+int readBlocks(ReportSet* reports, InputFile* input, int lineNumber, FILE* debugFile, int threads, RunStats* stats) {
 /**
- * @brief Performs an inorder traversal of the AVL tree and writes sorted stations to a file.
+ * @brief Aggregates every block of an input, each split into a chunk per thread.
  * 
- * @param root The root of the AVL tree.
- * @param outputFile The file to write the sorted station data.
+ * @param reports The reports receiving the aggregates.
+ * @param input The raw input to read data from.
+ * @param lineNumber The number of lines already aggregated into the reports.
+ * @param debugFile If not NULL, receives a copy of every line selected by the first report (forces one thread).
+ * @param threads The number of threads used to parse each block.
+ * @param stats The run statistics.
+ * @return The number of lines aggregated, those before the input included.
  */
 
-    if (!root) return;
+    Chunk chunks[MAX_THREADS];
+    const char* block;
+    const char* blockEnd;
 
-    int count = 0;
-    int size = 1024;
-    StationDiff* stations = malloc(size * sizeof(StationDiff));
-    if (!stations) {
-        perror("Memory allocation error");
-        exit(EXIT_FAILURE);
+    if (debugFile) threads = 1;
+
+    double start = statsClock();
+    while (nextInputBlock(input, &block, &blockEnd)) {
+        addTimer(&stats->timers, "read", statsClock() - start);
+        memset(chunks, 0, sizeof(chunks));
+        int count = splitChunks(block, blockEnd, chunks, threads);
+        aggregateChunks(reports, chunks, count, debugFile, &lineNumber, stats);
+        start = statsClock();
     }
 
-    collectStations(root, &stations, &count, &size);
-    qsort(stations, count, sizeof(StationDiff), compareByCapacity);
+    return lineNumber;
+}
+
+void readLines(ReportSet* reports, InputFile* input, int lineNumber, FILE* debugFile, int threads, RunStats* stats) {
+/**
+ * @brief Reads the raw c-wire input once and aggregates every line into the reports that select it.
+ * 
+ * Each block of the input is split into line-aligned chunks that are parsed by
+ * separate threads into private copies of the reports; the partial reports are
+ * then merged in input order. Loads are summed as 64-bit integers, so the sums
+ * are exact and the result does not depend on the number of threads.
+ * 
+ * @param reports The reports receiving the aggregates.
+ * @param input The raw input to read data from.
+ * @param lineNumber The number of lines already aggregated into the reports (from a snapshot), 0 otherwise.
+ * @param debugFile If not NULL, receives a copy of every line selected by the first report (forces one thread).
+ * @param threads The number of threads used to parse each block.
+ * @param stats The run statistics.
+ */
+
+    lineNumber = readBlocks(reports, input, lineNumber, debugFile, threads, stats);
+    printReadSummary(reports, lineNumber, stats);
+}
+
+void closeInputs(InputFile* inputs, int count) {
+/**
+ * @brief Closes the first count input files of an array, then frees the array.
+ * 
+ * @param inputs The opened input files.
+ * @param count The number of files to close.
+ */
 
     for (int i = 0; i < count; i++) {
-        fprintf(outputFile, "%d:%ld:%.2f\n", stations[i].key, stations[i].capacity, stations[i].consumption);
+        closeInput(&inputs[i]);
     }
+    free(inputs);
+}
 
-    free(stations);
+void readShards(ReportSet* reports, InputFile* shards, int shardCount, FILE* debugFile, int threads, RunStats* stats) {
+/**
+ * @brief Aggregates several input files as if they were read one after the other.
+ * 
+ * Consecutive mapped files are taken by groups of up to one file per thread:
+ * the threads are shared between the files of a group, whose chunks are
+ * parsed together, so small files are read in parallel as well as large
+ * ones. The partial reports are merged in file order, which sums the loads
+ * of a station found in several files and numbers the lines as in the
+ * concatenation of the files. Other inputs are read block by block.
+ * 
+ * @param reports The reports receiving the aggregates.
+ * @param shards The opened input files, in order.
+ * @param shardCount The number of files.
+ * @param debugFile If not NULL, receives a copy of every line selected by the first report (forces one thread).
+ * @param threads The number of threads.
+ * @param stats The run statistics.
+ */
+
+    Chunk chunks[MAX_THREADS];
+    int lineNumber = 0;
+
+    if (debugFile) threads = 1;
+
+    for (int first = 0; first < shardCount;) {
+        if (!shards[first].mapped) {
+            lineNumber = readBlocks(reports, &shards[first], lineNumber, debugFile, threads, stats);
+            first++;
+            continue;
+        }
+
+        int group = 1;
+        while (group < threads && first + group < shardCount && shards[first + group].mapped) group++;
+
+        double start = statsClock();
+        memset(chunks, 0, sizeof(chunks));
+        int count = 0;
+        for (int s = 0; s < group; s++) {
+            const char* block;
+            const char* blockEnd;
+            if (!nextInputBlock(&shards[first + s], &block, &blockEnd)) continue;
+            int share = threads / group + (s < threads % group);
+            count += splitChunks(block, blockEnd, &chunks[count], share);
+        }
+        addTimer(&stats->timers, "read", statsClock() - start);
+
+        aggregateChunks(reports, chunks, count, debugFile, &lineNumber, stats);
+        first += group;
+    }
+
+    printReadSummary(reports, lineNumber, stats);
 }
 
-void generateTopAndBottom10(AVLNode* root, FILE* topFile, FILE* bottomFile, int limit) {
+size_t rowAtRank(const PlantRun* runs, size_t runCount, size_t rank) {
 /**
- * @brief Generates the top and bottom 10 stations by difference and writes them to separate files.
+ * @brief Finds the row holding a given rank among the rows of a list of runs.
  * 
- * @param root The root of the AVL tree.
- * @param topFile The file to write the top stations with the largest differences.
- * @param bottomFile The file to write the bottom stations with the smallest differences.
- * @param limit The number of stations to include in each file.
+ * @param runs The runs, in row order.
+ * @param runCount The number of runs.
+ * @param rank The rank of the row among the rows of the runs, from 0.
+ * @return The row, or the end of the last run if rank is past the last row.
+ */
+
+    for (size_t r = 0; r < runCount; r++) {
+        size_t length = runs[r].endRow - runs[r].firstRow;
+        if (rank < length) return runs[r].firstRow + rank;
+        rank -= length;
+    }
+    return runCount > 0 ? runs[runCount - 1].endRow : 0;
+}
+
+int commonPlant(const ReportSet* reports) {
+/**
+ * @brief Returns the plant every report is restricted to, or -1 if they do not all target the same one.
  */
 
-    if (!root) return;
+    int plantId = reports->reports[0].filter.plantId;
+    for (int i = 1; i < reports->count; i++) {
+        if (reports->reports[i].filter.plantId != plantId) plantId = -1;
+    }
+    return plantId;
+}
+
+void readColumns(ReportSet* reports, const ColumnCache* cache, int threads, RunStats* stats) {
+/**
+ * @brief Aggregates the rows of a column cache into the reports that select them.
+ * 
+ * When every report is restricted to the same plant, only the rows of that
+ * plant are read, found through the plant index of the cache. The rows to
+ * read are split into equal shares aggregated by separate threads, then
+ * merged in order, exactly as readLines() does with the text.
+ * 
+ * @param reports The reports receiving the aggregates.
+ * @param cache The parsed input.
+ * @param threads The number of threads.
+ * @param stats The run statistics.
+ */
+
+    PlantRun everything = {0, 0, 0, cache->rows, 0};
+    const PlantRun* runs = &everything;
+    size_t runCount = 1;
+
+    int plantId = commonPlant(reports);
+    if (plantId != -1) runCount = findPlantRuns(cache, plantId, &runs);
+
+    size_t selected = 0;
+    for (size_t r = 0; r < runCount; r++) {
+        selected += runs[r].endRow - runs[r].firstRow;
+    }
 
+    Chunk chunks[MAX_THREADS];
+    int lineNumber = 0;
     int count = 0;
-    int size = 1024;
-    StationDiff* stations = malloc(size * sizeof(StationDiff));
-    if (!stations) {
-        perror("Memory allocation error");
-        exit(EXIT_FAILURE);
+    size_t firstRow = 0;
+
+    memset(chunks, 0, sizeof(chunks));
+    for (int i = 0; i < threads; i++) {
+        size_t endRow = i == threads - 1 ? cache->rows : rowAtRank(runs, runCount, selected / threads * (i + 1));
+        if (firstRow == endRow) continue;
+
+        chunks[count].cache = cache;
+        chunks[count].runs = runs;
+        chunks[count].runCount = runCount;
+        chunks[count].firstRow = firstRow;
+        chunks[count].endRow = endRow;
+        copyReportSet(&chunks[count].reports, reports);
+        count++;
+        firstRow = endRow;
+    }
+
+    double start = statsClock();
+    parseChunks(chunks, count);
+    addTimer(&stats->timers, "aggregate_columns", statsClock() - start);
+
+    mergeChunks(reports, chunks, count, &lineNumber, stats);
+
+    // Rows of other plants are skipped, not absent: the input still has every row of the cache
+    printReadSummary(reports, (int)cache->rows, stats);
+}
+
+void readInput(ReportSet* reports, InputFile* input, const char* cachePath, FILE* debugFile, int threads,
+               RunStats* stats) {
+/**
+ * @brief Aggregates the input into the reports, through its column cache when one is requested.
+ * 
+ * A valid cache is mapped and read without touching the text. Otherwise the
+ * text is parsed into a new cache, which is saved for the next runs and then
+ * aggregated. Inputs that are not regular files, and runs that copy the
+ * selected lines to a debug file, always read the text.
+ * 
+ * @param reports The reports receiving the aggregates.
+ * @param input The raw input.
+ * @param cachePath The path of the column cache, or NULL to read the text.
+ * @param debugFile If not NULL, receives a copy of every line selected by the first report.
+ * @param threads The number of threads.
+ * @param stats The run statistics.
+ */
+
+    ColumnCache cache;
+
+    if (cachePath && !debugFile && input->mapped) {
+        double start = statsClock();
+        int loaded = loadColumnCache(&cache, cachePath, input, commonPlant(reports)) == 0;
+        addTimer(&stats->timers, "cache_load", statsClock() - start);
+        if (loaded) {
+            printf("Reading column cache %s\n", cachePath);
+            stats->cacheUsed = 1;
+            readColumns(reports, &cache, threads, stats);
+            freeColumnCache(&cache);
+            return;
+        }
+
+        start = statsClock();
+        int built = buildColumnCache(&cache, input, threads) == 0;
+        addTimer(&stats->timers, "cache_build", statsClock() - start);
+        if (built) {
+            start = statsClock();
+            int saved = saveColumnCache(&cache, cachePath, input) == 0;
+            addTimer(&stats->timers, "cache_save", statsClock() - start);
+            if (saved) {
+                printf("Column cache written to %s\n", cachePath);
+            } else {
+                perror("Warning: cannot write the column cache");
+            }
+            stats->cacheUsed = 1;
+            readColumns(reports, &cache, threads, stats);
+            freeColumnCache(&cache);
+            return;
+        }
     }
 
-    collectStations(root, &stations, &count, &size);
-    qsort(stations, count, sizeof(StationDiff), compareByDifference);
+    readLines(reports, input, 0, debugFile, threads, stats);
+}
+
+int verifyCandidates(Report* report, char* const* paths, int pathCount, ReadAheadMode mode, RunStats* stats) {
+/**
+ * @brief Reads the input a second time to replace the aggregates of the candidates with exact ones.
+ * 
+ * Only the lines of the candidate stations are aggregated, into an exact
+ * map that never holds more stations than the table. Afterwards the
+ * candidates are exact; only the stations the table dropped remain bounded.
+ * 
+ * @param report The lv all report aggregated in a bounded table.
+ * @param paths The input files.
+ * @param pathCount The number of input files.
+ * @param mode How the input is read.
+ * @param stats The run statistics receiving the time of the pass.
+ * @return 0 on success, -1 if an input file cannot be opened again.
+ */
+
+    double start = statsClock();
+    CandidateTable* table = &report->stations.candidates;
 
-    for (int i = 0; i < limit && i < count; i++) {
-        // Top stations: largest differences at the end of the array
-        fprintf(topFile, "%d:%ld:%.2f:%.2f\n",
-                stations[count - 1 - i].key,
-                stations[count - 1 - i].capacity,
-                stations[count - 1 - i].consumption,
-                stations[count - 1 - i].difference);
+    ReportSet exact;
+    initReportSet(&exact, BACKEND_AUTO, 0, 0);
+    Filter filter = report->filter;
+    filter.candidates = table;
+    addReport(&exact, &filter);
 
-        // Bottom stations: smallest differences at the start of the array
-        fprintf(bottomFile, "%d:%ld:%.2f:%.2f\n",
-                stations[i].key,
-                stations[i].capacity,
-                stations[i].consumption,
-                stations[i].difference);
+    Chunk chunk;
+    const char* block;
+    const char* blockEnd;
+    int lineNumber = 0;
+    for (int i = 0; i < pathCount; i++) {
+        InputFile input;
+        if (openInput(&input, paths[i], mode) != 0) {
+            freeReportSet(&exact);
+            return -1;
+        }
+        while (nextInputBlock(&input, &block, &blockEnd)) {
+            memset(&chunk, 0, sizeof(chunk));
+            splitChunks(block, blockEnd, &chunk, 1);
+            copyReportSet(&chunk.reports, &exact);
+            parseChunk(&chunk);
+            mergeChunks(&exact, &chunk, 1, &lineNumber, stats);
+        }
+        closeInput(&input);
     }
 
+    StationDiff* stations;
+    int count = collectStations(&exact.reports[0].stations, &stations);
+    for (int i = 0; i < count; i++) {
+        verifyCandidate(table, stations[i].key, stations[i].capacity, stations[i].consumption);
+    }
+    table->verified = 1;
     free(stations);
+    freeReportSet(&exact);
+
+    printf("Verified the %d candidates in a second pass over %d lines\n", count, lineNumber);
+    addTimer(&stats->timers, "verify", statsClock() - start);
+    return 0;
 }
 
-void generateGnuplotScript(const char* scriptPath, const char* top10Path, const char* bottom10Path, const char* outputPath) {
+int writeLvAllFiles(const StationDiff* top, const StationDiff* bottom, int selected, const char* suffix, int charts,
+                    ReportStats* stats) {
 /**
- * @brief Generates a Gnuplot script for visualizing the top and bottom 10 stations.
+ * @brief Writes the top/bottom 10, min/max and chart files of lv all from the selected extremes.
  * 
- * @param scriptPath The path to save the Gnuplot script file.
- * @param top10Path The path to the file containing the top 10 stations.
- * @param bottom10Path The path to the file containing the bottom 10 stations.
- * @param outputPath The path to save the generated chart image.
+ * @param top The stations with the largest differences, from the largest down.
+ * @param bottom The stations with the smallest differences, from the smallest up.
+ * @param selected The number of stations in each of top and bottom, at most 10.
+ * @param suffix Appended to the output file names (empty, or "_<plant>" for per-plant variants).
+ * @param charts The charts written: CHART_SVG, CHART_PNG and CHART_GNUPLOT bits.
+ * @param stats The statistics of the report, receiving the write and chart times.
+ * @return 0 on success, -1 if an output file cannot be written.
  */
 
-    FILE* gp = fopen(scriptPath, "w");
-    if (!gp) {
-        perror("Error opening Gnuplot script file");
-        return;
+    const char* station_type = stationName(STATION_LV);
+    const char* consumer_type = consumerName(CONSUMER_ALL);
+    int status = 0;
+
+    double start = statsClock();
+    if (writeRankingFiles(top, bottom, selected, suffix) != 0) status = -1;
+    addTimer(&stats->timers, "write_ranking", statsClock() - start);
+
+    char top10Path[256];
+    char bottom10Path[256];
+    sprintf(top10Path, "output/top10_lv_all%s.csv", suffix);
+    sprintf(bottom10Path, "output/bottom10_lv_all%s.csv", suffix);
+
+    start = statsClock();
+    char chartPath[256];
+    if (charts & CHART_SVG) {
+        sprintf(chartPath, "output/chart_lv_all%s.svg", suffix);
+        if (writeChartSvg(chartPath, top, bottom, selected) != 0) {
+            perror("Error writing SVG chart");
+            status = -1;
+        }
+    }
+    if (charts & CHART_PNG) {
+        sprintf(chartPath, "output/chart_lv_all%s.png", suffix);
+        if (writeChartPng(chartPath, top, bottom, selected) != 0) {
+            perror("Error writing PNG chart");
+            status = -1;
+        }
     }
+    addTimer(&stats->timers, "chart", statsClock() - start);
 
-    fprintf(gp,
-    "set logscale y\n"
-    "set terminal png size 1200,600\n"
-    "set output '%s'\n"
-    "set title 'Top 10 and Bottom 10 Stations by Difference'\n"
-    "set boxwidth 0.4 relative\n" // Réduit la largeur des barres
-    "set style fill solid border -1\n"
-    "set ylabel 'Difference (kW)'\n"
-    "set xlabel 'Station ID'\n"
-    "set xtics rotate by -45\n"
-    "set grid ytics\n"
-    "set datafile separator \":\"\n"
-    "plot '%s' using ($0-0.2):4:xtic(1) with boxes title 'Overload (Top 10)' lc rgb 'red',\\\n"
-    "     '%s' using ($0+0.2):($4*(-1)):xtic(1) with boxes title 'Underutilized (Bottom 10)' lc rgb 'green'\n",
-    outputPath, top10Path, bottom10Path);
-    
+    // The Gnuplot script is only written for those who restyle the chart; it is not run
+    if (charts & CHART_GNUPLOT) {
+        char scriptPath[256];
+        sprintf(scriptPath, "output/plot_%s_%s%s.gp", station_type, consumer_type, suffix);
+        sprintf(chartPath, "output/chart_lv_all%s.png", suffix);
+        generateGnuplotScript(scriptPath, top10Path, bottom10Path, chartPath);
+    }
 
+    return status;
+}
 
-    fclose(gp);
+int writeBoundedReport(Report* report, const char* suffix, int charts) {
+/**
+ * @brief Writes the lv all files of a report aggregated in a bounded candidate table.
+ * 
+ * The top and bottom stations are selected among the candidates, by the
+ * difference of the lines the table saw, or by the exact one once the
+ * candidates were verified. How far they may be from the exact ranking is
+ * printed and kept in the report statistics. No sorted file is written,
+ * since the table does not hold every station.
+ * 
+ * @param report The aggregated lv all report.
+ * @param suffix Appended to the output file names.
+ * @param charts The charts written: CHART_SVG, CHART_PNG and CHART_GNUPLOT bits.
+ * @return 0 on success, -1 if an output file cannot be written.
+ */
+
+    ReportStats* stats = &report->stats;
+    const CandidateTable* table = &report->stations.candidates;
+    double start = statsClock();
+
+    StationDiff* candidates;
+    int count = collectStations(&report->stations, &candidates);
+    recordMapStats(report, count);
+
+    // A table that dropped stations saw more of them than it keeps, which is always enough for 10 at each end
+    StationDiff top[10];
+    StationDiff bottom[10];
+    int selected = selectExtremes(candidates, count, rankingLimit(table->dropped > 0 ? table->size : count), top, bottom);
+    RankBounds bounds;
+    boundRanking(&report->stations, top, bottom, selected, &bounds);
+    addTimer(&stats->timers, "select_extremes", statsClock() - start);
+
+    stats->rankError = bounds.maxError;
+    stats->topExact = bounds.topExact;
+    stats->bottomExact = bounds.bottomExact;
+
+    printf("Bounded ranking: %d candidates kept, %ld stations dropped; top %d %s, bottom %d %s", count, table->dropped,
+           selected, bounds.topExact ? "exact" : "may miss stations", selected,
+           bounds.bottomExact ? "exact" : "may miss stations");
+    if (table->dropped > 0) {
+        printf("; listed differences within %ld of exact%s; dropped stations between %ld and %ld", bounds.maxError,
+               table->verified ? " (verified)" : "", table->droppedLow, table->droppedHigh);
+    }
+    printf("\n");
+
+    free(candidates);
+    freeStationMap(&report->stations);
+    return writeLvAllFiles(top, bottom, selected, suffix, charts, stats);
 }
 
-void readLines(int columnIndex, AVLNode** tree, FILE* file) {
+int writeReport(Report* report, const char* suffix, int charts, int binary) {
 /**
- * @brief Reads lines from a CSV file and inserts them as nodes into an AVL tree.
+ * @brief Writes the output files of a report: the sorted stations and, for lv all,
+ *        the top/bottom 10, min/max and chart files.
+ * 
+ * The stations of the report are freed once their snapshot is taken.
  * 
- * @param columnIndex The column index in the CSV file that represents the key.
- * @param tree Pointer to the root of the AVL tree.
- * @param file The input file to read data from.
+ * @param report The aggregated report.
+ * @param suffix Appended to the output file names (empty, or "_<plant>" for per-plant variants).
+ * @param charts The charts written for lv all: CHART_SVG, CHART_PNG and CHART_GNUPLOT bits.
+ * @param binary 1 to also write the sorted stations as a binary result file.
+ * @return 0 on success, -1 if an output file cannot be written.
  */
 
-    char line[1024];
-    int lineNumber = 0;
+    if (report->stations.backend == BACKEND_BOUNDED) return writeBoundedReport(report, suffix, charts);
+
+    const char* station_type = stationName(report->filter.station);
+    const char* consumer_type = consumerName(report->filter.consumer);
+
+    ReportStats* stats = &report->stats;
+    double start = statsClock();
 
-    while (fgets(line, sizeof(line), file)) {
-        lineNumber++;
-        char* columns[8] = {NULL};
-        char* token = strtok(line, ";");
-        int i = 0;
+    // One snapshot of the aggregated stations is shared by every output
+    StationDiff* snapshot;
+    int stationCount = collectStations(&report->stations, &snapshot);
+    addTimer(&stats->timers, "snapshot", statsClock() - start);
 
-        while (token != NULL && i < 8) {
-            columns[i] = token;
-            i++;
-            token = strtok(NULL, ";");
+    // The map statistics are taken before its stations are freed
+    recordMapStats(report, stationCount);
+    freeStationMap(&report->stations);
+
+    start = statsClock();
+    sortByCapacity(snapshot, stationCount);
+    addTimer(&stats->timers, "sort", statsClock() - start);
+
+    char outputFileName[256];
+    sprintf(outputFileName, "output/sorted_%s_%s%s.csv", station_type, consumer_type, suffix);
+    OutputFile outputFile;
+    if (openOutput(&outputFile, outputFileName) != 0) {
+        perror("Error opening output file");
+        free(snapshot);
+        return -1;
+    }
+
+    writeSortedHeader(&outputFile, station_type);
+    start = statsClock();
+    writeSortedFile(snapshot, stationCount, &outputFile);
+    int status = 0;
+    if (closeOutput(&outputFile) != 0) {
+        perror("Error writing output file");
+        status = -1;
+    }
+    addTimer(&stats->timers, "write_sorted", statsClock() - start);
+
+    // The same stations in fixed-width columns, for readers that map the file instead of parsing the text
+    if (binary) {
+        start = statsClock();
+        sprintf(outputFileName, "output/sorted_%s_%s%s%s", station_type, consumer_type, suffix, RESULT_SUFFIX);
+        if (writeResultFile(outputFileName, snapshot, stationCount, station_type, consumer_type,
+                            report->filter.plantId) != 0) {
+            perror("Error writing binary result file");
+            status = -1;
         }
+        addTimer(&stats->timers, "write_binary", statsClock() - start);
+    }
 
-        if (!columns[columnIndex] || columns[columnIndex][0] == '\0') {
-            fprintf(stderr, "Line %d ignored: empty or null key.\n", lineNumber);
-            continue;
+    // Only generate top/bottom 10 and plot if station_type=lv and consumer_type=all
+    if (report->filter.station == STATION_LV && report->filter.consumer == CONSUMER_ALL) {
+        start = statsClock();
+        StationDiff top[10];
+        StationDiff bottom[10];
+        int selected = selectExtremes(snapshot, stationCount, rankingLimit(stationCount), top, bottom);
+        addTimer(&stats->timers, "select_extremes", statsClock() - start);
+
+        if (writeLvAllFiles(top, bottom, selected, suffix, charts, stats) != 0) status = -1;
+    }
+
+    free(snapshot);
+    return status;
+}
+
+static volatile sig_atomic_t followStopped = 0;
+
+static void stopFollowing(int signalNumber) {
+/**
+ * @brief Signal handler ending the follow mode after the lines read so far.
+ */
+
+    (void)signalNumber;
+    followStopped = 1;
+}
+
+int publishRanking(ReportSet* reports, RankList* top, RankList* bottom, ChangedKeys* changed, RunStats* stats) {
+/**
+ * @brief Brings the live lv all ranking up to date and rewrites the top 10, bottom 10 and min/max files.
+ * 
+ * Only the stations changed since the previous publication are looked up and
+ * merged into the rankings; the stations are scanned again only when a
+ * ranking no longer holds enough exact entries.
+ * 
+ * @param reports The lv all report being followed.
+ * @param top The ranking of the largest differences.
+ * @param bottom The ranking of the smallest differences.
+ * @param changed The keys changed since the previous publication; emptied.
+ * @param stats The run statistics.
+ * @return 0 on success, -1 if a file cannot be written.
+ */
+
+    double start = statsClock();
+    const StationMap* map = &reports->reports[0].stations;
+    int limit = rankingLimit(countStations(map));
+
+    StationDiff* stations;
+    int count = takeChangedStations(changed, map, &stations);
+    if (updateRankList(top, stations, count, limit) != 0 || updateRankList(bottom, stations, count, limit) != 0) {
+        rebuildRankLists(top, bottom, map);
+        stats->rankRebuilds++;
+    }
+    free(stations);
+
+    int status = writeRankingFiles(top->entries, bottom->entries, limit, "");
+    stats->rankPublishes++;
+    addTimer(&stats->timers, "follow_publish", statsClock() - start);
+    return status;
+}
+
+void followInput(ReportSet* reports, const char* path, size_t offset, int lineNumber, int threads, long refreshMs,
+                 long refreshLines, RunStats* stats) {
+/**
+ * @brief Follows a growing input like tail -f and keeps the lv all ranking files up to date.
+ * 
+ * The input is polled every FOLLOW_POLL_MS milliseconds. Complete new lines
+ * are parsed and merged into the report as in a normal run, and the keys of
+ * the stations they touch are remembered. The ranking is published once
+ * refreshMs milliseconds have passed since the previous publication or
+ * refreshLines lines are pending, whichever comes first. The mode ends on
+ * SIGINT or SIGTERM, or if the input shrinks.
+ * 
+ * @param reports The lv all report, already holding the first offset bytes of the input.
+ * @param path The path of the input.
+ * @param offset The number of bytes already read.
+ * @param lineNumber The number of lines already read.
+ * @param threads The number of threads used to parse the new lines.
+ * @param refreshMs The minimum time between two publications, in milliseconds.
+ * @param refreshLines The number of pending lines that triggers a publication at once (0 to only use the time).
+ * @param stats The run statistics.
+ */
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("Error opening input file");
+        return;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stopFollowing;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    size_t capacity = INPUT_BLOCK_SIZE;
+    size_t size = 0;
+    char* buffer = malloc(capacity);
+    if (!buffer) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+
+    RankList top;
+    RankList bottom;
+    ChangedKeys changed;
+    memset(&changed, 0, sizeof(changed));
+    initRankList(&top, 1);
+    initRankList(&bottom, -1);
+    rebuildRankLists(&top, &bottom, &reports->reports[0].stations);
+    publishRanking(reports, &top, &bottom, &changed, stats);
+
+    printf("Following %s from line %d (Ctrl-C to stop)\n", path, lineNumber + 1);
+    fflush(stdout);
+
+    Chunk chunks[MAX_THREADS];
+    long pendingLines = 0;
+    double lastPublish = statsClock();
+
+    while (!followStopped) {
+        struct stat info;
+        if (fstat(fd, &info) != 0 || (size_t)info.st_size < offset) {
+            fprintf(stderr, "Error: %s was truncated or replaced, stopping.\n", path);
+            break;
         }
 
-        if (!columns[6] || columns[6][0] == '\0') {
-            fprintf(stderr, "Line %d ignored: empty or null capacity.\n", lineNumber);
-            continue;
+        ssize_t count = 0;
+        if ((size_t)info.st_size > offset) {
+            if (size == capacity) {
+                capacity *= 2;
+                buffer = realloc(buffer, capacity);
+                if (!buffer) {
+                    perror("Memory reallocation error");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            count = pread(fd, buffer + size, capacity - size, (off_t)offset);
+            if (count < 0 && errno != EINTR) {
+                perror("Error reading input file");
+                break;
+            }
         }
 
-        int key = atoi(columns[columnIndex]);
-        long capacity = atol(columns[6]);
-        double consumption = (columns[7] != NULL && columns[7][0] != '-') ? atof(columns[7]) : 0.0;
+        if (count > 0) {
+            size += (size_t)count;
+            offset += (size_t)count;
+
+            // Only complete lines are parsed; a partial last line waits for the rest of it
+            const char* lastNewline = memrchr(buffer, '\n', size);
+            if (lastNewline) {
+                size_t used = (size_t)(lastNewline - buffer) + 1;
+                double start = statsClock();
+
+                memset(chunks, 0, sizeof(chunks));
+                int chunkCount = splitChunks(buffer, buffer + used, chunks, threads);
+                for (int i = 0; i < chunkCount; i++) {
+                    copyReportSet(&chunks[i].reports, reports);
+                }
+                parseChunks(chunks, chunkCount);
+                for (int i = 0; i < chunkCount; i++) {
+                    addChangedKeys(&changed, &chunks[i].reports.reports[0].stations);
+                    pendingLines += chunks[i].lines;
+                }
+                mergeChunks(reports, chunks, chunkCount, &lineNumber, stats);
+                addTimer(&stats->timers, "follow_parse", statsClock() - start);
+
+                memmove(buffer, buffer + used, size - used);
+                size -= used;
+            }
+        }
+
+        double now = statsClock();
+        if (pendingLines > 0 && ((now - lastPublish) * 1000 >= refreshMs || (refreshLines > 0 && pendingLines >= refreshLines))) {
+            publishRanking(reports, &top, &bottom, &changed, stats);
+            pendingLines = 0;
+            lastPublish = now;
+        }
 
-        *tree = insertNode(*tree, key, capacity, consumption);
+        if (count <= 0) {
+            struct timespec pause = {0, FOLLOW_POLL_MS * 1000000L};
+            nanosleep(&pause, NULL);
+        }
+    }
+
+    if (pendingLines > 0) publishRanking(reports, &top, &bottom, &changed, stats);
+    stats->linesRead = lineNumber;
+    printf("Stopped following %s after %d lines\n", path, lineNumber);
+
+    freeChangedKeys(&changed);
+    free(buffer);
+    close(fd);
+}
+
+void writeReportJson(FILE* file, const Report* report, int plantId) {
+/**
+ * @brief Writes the counters and timers of one report as a JSON object.
+ * 
+ * @param file The statistics file.
+ * @param report The written report.
+ * @param plantId The plant of a per-plant variant, or the plant of the query.
+ */
+
+    const ReportStats* stats = &report->stats;
+    long merges = report->keptLines - stats->ignoredLines - stats->distinctStations;
+
+    fprintf(file, "    {\"station\": \"%s\", \"consumer\": \"%s\", \"plant\": %d,\n",
+            stationName(report->filter.station), consumerName(report->filter.consumer), plantId);
+    fprintf(file, "     \"kept_lines\": %d, \"ignored_lines\": %ld, \"distinct_stations\": %ld, \"duplicate_merges\": %ld,\n",
+            report->keptLines, stats->ignoredLines, stats->distinctStations, merges);
+    fprintf(file, "     \"backend\": \"%s\", \"tree_height\": %d, \"rotations\": %lu, \"node_splits\": %lu,\n",
+            stats->backend, stats->treeHeight, stats->rotations, stats->nodeSplits);
+    if (report->stations.backend == BACKEND_BOUNDED) {
+        fprintf(file, "     \"dropped_stations\": %ld, \"rank_error\": %ld, \"top_exact\": %s, \"bottom_exact\": %s, \"verified\": %s,\n",
+                stats->droppedStations, stats->rankError, stats->topExact ? "true" : "false",
+                stats->bottomExact ? "true" : "false", stats->verified ? "true" : "false");
+    }
+    fprintf(file, "     \"timings\": ");
+    writeTimersJson(file, &stats->timers);
+    fprintf(file, "}");
+}
+
+int writeStatsFile(const char* path, int stdoutFd, const char* inputPath, const RunStats* stats,
+                   const ReportSet* reports) {
+/**
+ * @brief Writes the run statistics to a JSON file: input counters, phase timings,
+ *        and the counters of every written report, per-plant variants included.
+ * 
+ * @param path The statistics file, or "-" for the standard output.
+ * @param stdoutFd The original standard output, which "-" writes to.
+ * @param inputPath The first input file or directory given.
+ * @param stats The run statistics.
+ * @param reports The written reports.
+ * @return 0 on success, -1 if the file cannot be written.
+ */
+
+    FILE* file = strcmp(path, "-") == 0 ? fdopen(stdoutFd, "w") : fopen(path, "w");
+    if (!file) {
+        perror("Error opening statistics file");
+        return -1;
     }
 
-    printf("File reading completed. Total lines read: %d\n", lineNumber);
+    fprintf(file, "{\n  \"input\": ");
+    writeJsonString(file, inputPath);
+    fprintf(file, ", \"shards\": %d,\n  \"threads\": %d, \"scanner\": \"%s\", \"cache_used\": %s, \"snapshot_lines\": %ld,\n",
+            stats->shards, stats->threads, scanKernelName(), stats->cacheUsed ? "true" : "false", stats->snapshotLines);
+    fprintf(file, "  \"reader\": \"%s\", \"read_stalls\": %ld,\n", stats->reader ? stats->reader : "none",
+            stats->readStalls);
+    fprintf(file, "  \"lines_read\": %ld, \"lines_ignored\": {\"empty_key\": %ld, \"empty_capacity\": %ld},\n",
+            stats->linesRead, stats->ignoredEmptyKey, stats->ignoredEmptyCapacity);
+    fprintf(file, "  \"ranking_publishes\": %ld, \"ranking_rebuilds\": %ld, \"queries\": %ld,\n", stats->rankPublishes,
+            stats->rankRebuilds, stats->queries);
+    fprintf(file, "  \"timings\": ");
+    writeTimersJson(file, &stats->timers);
+    fprintf(file, ",\n  \"reports\": [");
+
+    // Reports never written (or, for a server, never queried) have no map statistics
+    int written = 0;
+    for (int i = 0; i < reports->count; i++) {
+        if (reports->reports[i].keptLines == 0 || !reports->reports[i].stats.backend) continue;
+        fprintf(file, "%s\n", written++ ? "," : "");
+        writeReportJson(file, &reports->reports[i], reports->reports[i].filter.plantId);
+    }
+    for (int p = 0; p < reports->plantCount; p++) {
+        for (int i = 0; i < reports->count; i++) {
+            if (reports->plants[p].reports[i].keptLines == 0 || !reports->plants[p].reports[i].stats.backend) continue;
+            fprintf(file, "%s\n", written++ ? "," : "");
+            writeReportJson(file, &reports->plants[p].reports[i], reports->plants[p].plantId);
+        }
+    }
+    fprintf(file, "\n  ]\n}\n");
+
+    if (fclose(file) != 0) {
+        perror("Error writing statistics file");
+        return -1;
+    }
+    return 0;
 }
 
 int main(int argc, char *argv[]) {
 /**
  * @brief The main entry point of the program. Parses command-line arguments, processes input data,
- *        performs AVL tree operations, generates files, and optionally visualizes data.
+ *        aggregates the stations, generates files, and optionally visualizes data.
  * 
  * @param argc The number of command-line arguments.
  * @param argv The array of command-line arguments.
  * @return EXIT_SUCCESS on successful execution, or EXIT_FAILURE on error.
  */
 
-    if (argc != 4) {
-        fprintf(stderr, "Usage: %s <station_type> <consumer_type> <plant_id>\n", argv[0]);
+    char *positional[argc];
+    int positionalCount = 0;
+    int debug_filter = 0;
+    int batch = 0;
+    int per_plant = 0;
+    int use_cache = 0;
+    int use_snapshot = 0;
+    int follow = 0;
+    long refresh_ms = 0;
+    long refresh_lines = 0;
+    int threads = 1;
+    int serve = 0;
+    const char *socket_path = NULL;
+    int charts = CHART_SVG | CHART_PNG;
+    int gnuplot_script = 0;
+    const char *stats_path = NULL;
+    BackendType backend = BACKEND_AUTO;
+    ScanKernel scanner = SCAN_AUTO;
+    ReadAheadMode read_ahead = READ_AHEAD_DEFAULT;
+    int top_budget = 0;
+    int verify = 0;
+    int binary = 0;
+    int backend_given = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--debug-filter") == 0) {
+            debug_filter = 1;
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            batch = 1;
+        } else if (strcmp(argv[i], "--per-plant") == 0) {
+            per_plant = 1;
+        } else if (strcmp(argv[i], "--cache") == 0) {
+            use_cache = 1;
+        } else if (strcmp(argv[i], "--snapshot") == 0) {
+            use_snapshot = 1;
+        } else if (strcmp(argv[i], "--serve") == 0) {
+            serve = 1;
+        } else if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else if (strcmp(argv[i], "--follow") == 0) {
+            follow = 1;
+        } else if (strcmp(argv[i], "--refresh-ms") == 0 && i + 1 < argc) {
+            refresh_ms = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--refresh-lines") == 0 && i + 1 < argc) {
+            refresh_lines = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+            if (threads < 1 || threads > MAX_THREADS) {
+                fprintf(stderr, "Invalid thread count: %s (1 to %d)\n", argv[i], MAX_THREADS);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+            stats_path = argv[++i];
+        } else if (strcmp(argv[i], "--chart") == 0 && i + 1 < argc) {
+            if (parseChartFormats(argv[++i], &charts) != 0) {
+                fprintf(stderr, "Unknown chart format: %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--gnuplot") == 0) {
+            gnuplot_script = 1;
+        } else if (strcmp(argv[i], "--binary") == 0) {
+            binary = 1;
+        } else if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc) {
+            if (parseBackend(argv[++i], &backend) != 0) {
+                fprintf(stderr, "Unknown backend: %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+            backend_given = 1;
+        } else if (strcmp(argv[i], "--top-budget") == 0 && i + 1 < argc) {
+            long budget = strtol(argv[++i], NULL, 10);
+            if (budget < MIN_CANDIDATES || budget > MAX_CANDIDATES) {
+                fprintf(stderr, "Invalid candidate budget: %s (%d to %d stations)\n", argv[i], MIN_CANDIDATES,
+                        MAX_CANDIDATES);
+                return EXIT_FAILURE;
+            }
+            top_budget = (int)budget;
+        } else if (strcmp(argv[i], "--verify") == 0) {
+            verify = 1;
+        } else if (strcmp(argv[i], "--scanner") == 0 && i + 1 < argc) {
+            if (parseScanKernel(argv[++i], &scanner) != 0) {
+                fprintf(stderr, "Unknown scanner: %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--read-ahead") == 0 && i + 1 < argc) {
+            if (parseReadAhead(argv[++i], &read_ahead) != 0) {
+                fprintf(stderr, "Unknown read-ahead mode: %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+        } else if (argv[i][0] == '-' && argv[i][1] == '-') {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return EXIT_FAILURE;
+        } else {
+            positional[positionalCount++] = argv[i];
+        }
+    }
+
+    if (gnuplot_script) charts |= CHART_GNUPLOT;
+
+    // The line scanner is chosen once, before any thread parses
+    if (selectScanKernel(scanner) != 0) {
+        fprintf(stderr, "This processor does not support the requested scanner\n");
         return EXIT_FAILURE;
     }
 
-    char *station_type = argv[1];
-    char *consumer_type = argv[2];
-    char *plant_id = argv[3];
+    // The server answers every query of every plant, so it aggregates like a batch per-plant run
+    if (serve) {
+        batch = 1;
+        per_plant = 1;
+    }
 
-    char inputFileName[256];
-    if (strcmp(plant_id, "-1") == 0) {
-        sprintf(inputFileName, "tmp/filter_%s_%s.csv", station_type, consumer_type);
-    } else {
-        sprintf(inputFileName, "tmp/filter_%s_%s_%s.csv", station_type, consumer_type, plant_id);
+    if (batch ? positionalCount < 1 : positionalCount < 4) {
+        fprintf(stderr, "Usage: %s <input_file|directory>... <station_type> <consumer_type> <plant_id> [-j threads] [--backend auto|dense|avl|btree] [--scanner auto|scalar|sse4|avx2|avx512] [--read-ahead auto|uring|thread|off] [--cache] [--snapshot] [--stats file] [--chart svg|png|both|none] [--gnuplot] [--binary] [--debug-filter]\n", argv[0]);
+        fprintf(stderr, "       %s <input_file> lv all <plant_id> --follow [--refresh-ms ms] [--refresh-lines lines] [options]\n", argv[0]);
+        fprintf(stderr, "       %s <input_file> lv all <plant_id> --top-budget stations [--verify] [options]\n", argv[0]);
+        fprintf(stderr, "       %s <input_file|directory>... --batch [--per-plant] [-j threads] [--backend auto|dense|avl|btree] [--scanner auto|scalar|sse4|avx2|avx512] [--read-ahead auto|uring|thread|off] [--cache] [--snapshot] [--stats file] [--chart svg|png|both|none] [--gnuplot] [--binary]\n", argv[0]);
+        fprintf(stderr, "       %s <input_file> --serve [--socket path] [-j threads] [--backend auto|dense|avl|btree] [--read-ahead auto|uring|thread|off] [--cache] [--snapshot] [--stats file]\n", argv[0]);
+        return EXIT_FAILURE;
     }
 
-    FILE *inputFile = fopen(inputFileName, "r");
-    if (inputFile == NULL) {
-        perror("Error opening input file");
+    // Every positional argument before the query is an input file or a directory of input files
+    int input_count = batch ? positionalCount : positionalCount - 3;
+    char **query = positional + input_count;
+
+    // The cache, the snapshot and follow mode work on the mapped file, which the pipeline replaces
+    if ((use_cache || use_snapshot || follow) && read_ahead != READ_AHEAD_DEFAULT && read_ahead != READ_AHEAD_OFF) {
+        fprintf(stderr, "--read-ahead %s cannot be combined with --cache, --snapshot or --follow\n",
+                readAheadName(read_ahead));
         return EXIT_FAILURE;
     }
 
-    AVLNode *tree = NULL;
-    if (strcmp(station_type, "hvb") == 0) {
-        readLines(1, &tree, inputFile);
-    } else if (strcmp(station_type, "hva") == 0) {
-        readLines(2, &tree, inputFile);
-    } else if (strcmp(station_type, "lv") == 0) {
-        readLines(3, &tree, inputFile);
-    } else {
-        fprintf(stderr, "Unknown station type: %s\n", station_type);
-        fclose(inputFile);
+    // The bounded table replaces the station map of a single lv all query; it cannot be saved or served
+    if (top_budget && (batch || follow || use_snapshot || backend_given || strcmp(query[0], "lv") != 0 ||
+                       strcmp(query[1], "all") != 0)) {
+        fprintf(stderr, "--top-budget is only available for lv all, without --batch, --serve, --follow, --snapshot or --backend\n");
         return EXIT_FAILURE;
     }
+    // The binary result file holds the sorted stations, which a bounded ranking and a server never write
+    if (binary && (top_budget || serve)) {
+        fprintf(stderr, "--binary is not available with --top-budget or --serve\n");
+        return EXIT_FAILURE;
+    }
+    if (verify && !top_budget) {
+        fprintf(stderr, "--verify is only available with --top-budget\n");
+        return EXIT_FAILURE;
+    }
+    if (top_budget) {
+        backend = BACKEND_BOUNDED;
+        threads = 1;
+    }
 
-    fclose(inputFile);
+    if (use_snapshot && debug_filter) {
+        fprintf(stderr, "--snapshot is not available with --debug-filter\n");
+        return EXIT_FAILURE;
+    }
 
-    char outputFileName[256];
-    sprintf(outputFileName, "output/sorted_%s_%s.csv", station_type, consumer_type);
-    FILE *outputFile = fopen(outputFileName, "w");
-    if (!outputFile) {
-        perror("Error opening output file");
-        freeTree(tree);
+    if (serve && (follow || debug_filter)) {
+        fprintf(stderr, "--serve is not available with --follow or --debug-filter\n");
         return EXIT_FAILURE;
     }
 
-    fprintf(outputFile, "ID%s:Capacity:Consumption\n", station_type);
-    inorderTraversalToSortedFile(tree, outputFile);
-    fclose(outputFile);
+    if (socket_path && !serve) {
+        fprintf(stderr, "--socket is only available with --serve\n");
+        return EXIT_FAILURE;
+    }
 
-    // Only generate top/bottom 10 and plot if station_type=lv and consumer_type=all
-    if (strcmp(station_type, "lv") == 0 && strcmp(consumer_type, "all") == 0) {
-        // Open top10 and bottom10 files for writing
-        FILE* top10File = fopen("output/top10_lv_all.csv", "w");
-        FILE* bottom10File = fopen("output/bottom10_lv_all.csv", "w");
-        if (!top10File || !bottom10File) {
-            perror("Error opening top/bottom 10 files");
-            freeTree(tree);
+    // Served on standard input, the answers get the original standard output and every message goes to stderr;
+    // so does the JSON of --stats -, which the progress messages would otherwise break
+    int answer_fd = -1;
+    int stats_stdout = stats_path && strcmp(stats_path, "-") == 0;
+    if ((serve && !socket_path) || stats_stdout) {
+        fflush(stdout);
+        answer_fd = dup(STDOUT_FILENO);
+        if (answer_fd < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+            perror("Error redirecting standard output");
             return EXIT_FAILURE;
         }
+        setvbuf(stdout, NULL, _IOLBF, 0);
+    }
+
+    if (follow && (batch || debug_filter || strcmp(query[0], "lv") != 0 || strcmp(query[1], "all") != 0)) {
+        fprintf(stderr, "--follow is only available for lv all, without --batch or --debug-filter\n");
+        return EXIT_FAILURE;
+    }
 
-        FILE *file;
-        char ch;
-        int line_count = 0;
+    if (batch && debug_filter) {
+        fprintf(stderr, "--debug-filter is not available in batch mode\n");
+        return EXIT_FAILURE;
+    }
 
-        // Open the file in read mode
-        file = fopen("output/sorted_lv_all.csv", "r");
-        if (file == NULL) {
-            printf("Impossible d'ouvrir le fichier.\n");
-            return 1; // Exit if the file cannot be opened
-        }
+    // Phases are timed in every run; the statistics file is only written on request
+    RunStats stats;
+    memset(&stats, 0, sizeof(stats));
+    stats.threads = threads;
+    double total_start = statsClock();
 
-        // Read the file character by character
-        while ((ch = fgetc(file)) != EOF && line_count<20) {
-            if (ch == '\n') {
-                line_count++; // Count the new lines
-            }
-        }
+    ReportSet reports;
+    initReportSet(&reports, backend, top_budget, per_plant);
 
-        // If the file does not end with a newline, count the last line
-        if (line_count == 0 && ch == EOF && ftell(file) > 0) {
-            line_count = 1;
+    if (batch) {
+        addBatchReports(&reports);
+    } else {
+        Filter filter;
+        if (initFilter(&filter, query[0], query[1], query[2]) != 0) {
+            fprintf(stderr, "Unknown station or consumer type: %s %s\n", query[0], query[1]);
+            freeReportSet(&reports);
+            return EXIT_FAILURE;
         }
+        addReport(&reports, &filter);
+    }
 
-        // Close the file
-        fclose(file);
-
+    // Directories are replaced by the files they hold; several files are read as their concatenation would be
+    ShardList shards;
+    int listed = listShards(&shards, positional, input_count);
+    if (listed != 0 || shards.count == 0) {
+        if (listed != 0) {
+            perror("Error listing input directory");
+        } else {
+            fprintf(stderr, "Error: No input file found.\n");
+        }
+        freeShardList(&shards);
+        freeReportSet(&reports);
+        return EXIT_FAILURE;
+    }
+    if (shards.count > 1 && (use_cache || use_snapshot || follow)) {
+        fprintf(stderr, "--cache, --snapshot and --follow need a single input file\n");
+        freeShardList(&shards);
+        freeReportSet(&reports);
+        return EXIT_FAILURE;
+    }
+    char *input_path = shards.paths[0];
+    stats.shards = shards.count;
 
-        // Generate top and bottom 10 stations if line_count>=20;
-        if(line_count>=20){
-            generateTopAndBottom10(tree, top10File, bottom10File, 10);
+    InputFile *inputs = malloc((size_t)shards.count * sizeof(InputFile));
+    if (!inputs) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    InputFile *input = inputs;
+    double start = statsClock();
+    for (int i = 0; i < shards.count; i++) {
+        if (openInput(&inputs[i], shards.paths[i], read_ahead) != 0) {
+            fprintf(stderr, "Error opening input file %s: %s\n", shards.paths[i], strerror(errno));
+            closeInputs(inputs, i);
+            freeShardList(&shards);
+            freeReportSet(&reports);
+            return EXIT_FAILURE;
         }
-        else{
-            generateTopAndBottom10(tree, top10File, bottom10File, line_count/2);
+    }
+    addTimer(&stats.timers, "open", statsClock() - start);
+    stats.reader = inputReaderName(input);
+
+    for (int i = 0; (follow || verify) && i < shards.count; i++) {
+        struct stat input_info;
+        if (fstat(inputs[i].fd, &input_info) != 0 || !S_ISREG(input_info.st_mode)) {
+            fprintf(stderr, "%s needs regular input files\n", follow ? "--follow" : "--verify");
+            closeInputs(inputs, shards.count);
+            freeShardList(&shards);
+            freeReportSet(&reports);
+            return EXIT_FAILURE;
         }
+    }
 
-        // Close the top and bottom files before processing them
-        fclose(top10File);
-        fclose(bottom10File);
-
-        // Now, open the same files for reading
-        top10File = fopen("output/top10_lv_all.csv", "r");
-        bottom10File = fopen("output/bottom10_lv_all.csv", "r");
-        if (!top10File || !bottom10File) {
-            perror("Error opening top/bottom 10 files");
-            freeTree(tree);
-            return EXIT_FAILURE;
+    // The filtered lines are only written out when explicitly requested
+    FILE *debugFile = NULL;
+    if (debug_filter) {
+        char debugFileName[256];
+        if (strcmp(query[2], "-1") == 0) {
+            sprintf(debugFileName, "tmp/filter_%s_%s.csv", query[0], query[1]);
+        } else {
+            sprintf(debugFileName, "tmp/filter_%s_%s_%s.csv", query[0], query[1], query[2]);
         }
 
-        // Allocate space for merged data
-        int size = 1024;
-        int count = 0;
-        StationDiff* stations = malloc(size * sizeof(StationDiff));
-        if (!stations) {
-            perror("Memory allocation error");
-            fclose(top10File);
-            fclose(bottom10File);
+        debugFile = fopen(debugFileName, "w");
+        if (!debugFile) {
+            perror("Error opening filter debug file");
+            closeInputs(inputs, shards.count);
+            freeShardList(&shards);
+            freeReportSet(&reports);
             return EXIT_FAILURE;
         }
+    }
 
-        // Read from the top file and add to stations array
-        char line[1024];
-        while (fgets(line, sizeof(line), top10File)) {
-            if (count >= size) {
-                size *= 2;
-                stations = realloc(stations, size * sizeof(StationDiff));
-                if (!stations) {
-                    perror("Memory reallocation error");
-                    fclose(top10File);
-                    fclose(bottom10File);
-                    return EXIT_FAILURE;
-                }
-            }
+    // The column cache of an input is stored next to it
+    char cachePath[4096];
+    snprintf(cachePath, sizeof(cachePath), "%s%s", input_path, CACHE_SUFFIX);
+
+    // The aggregate of a query is saved next to its input; an appended input only has its new lines read
+    char snapshot_path[4096];
+    size_t snapshot_offset;
+    int snapshot_lines;
+    snapshotPath(snapshot_path, sizeof(snapshot_path), input_path, &reports);
+
+    start = statsClock();
+    int resumed = use_snapshot && loadSnapshot(&reports, snapshot_path, input, &snapshot_offset, &snapshot_lines) == 0;
+    if (use_snapshot) addTimer(&stats.timers, "snapshot_load", statsClock() - start);
+
+    if (resumed) {
+        printf("Resuming from snapshot %s (%d lines, %zu new bytes)\n", snapshot_path, snapshot_lines,
+               input->size - snapshot_offset);
+        stats.snapshotLines = snapshot_lines;
+        skipInput(input, snapshot_offset);
+        readLines(&reports, input, snapshot_lines, NULL, threads, &stats);
+    } else if (shards.count > 1) {
+        readShards(&reports, inputs, shards.count, debugFile, threads, &stats);
+    } else {
+        readInput(&reports, input, use_cache ? cachePath : NULL, debugFile, threads, &stats);
+    }
 
-            // Parse line
-            sscanf(line, "%d:%ld:%lf:%lf", &stations[count].key, &stations[count].capacity,
-                   &stations[count].consumption, &stations[count].difference);
-            count++;
+    // The snapshot covers the whole input: linesRead counts every line up to its end, cache reads of one plant
+    // included, so that resumed and followed runs number the new lines from the right base
+    if (use_snapshot) {
+        start = statsClock();
+        if (saveSnapshot(&reports, snapshot_path, input, (int)stats.linesRead) != 0) {
+            if (errno == EINVAL) {
+                fprintf(stderr, "Warning: snapshot not saved, the input does not end with a complete line\n");
+            } else {
+                perror("Warning: snapshot not saved");
+            }
         }
+        addTimer(&stats.timers, "snapshot_save", statsClock() - start);
+    }
 
-        // Read from the bottom file and add to stations array
-        while (fgets(line, sizeof(line), bottom10File)) {
-            if (count >= size) {
-                size *= 2;
-                stations = realloc(stations, size * sizeof(StationDiff));
-                if (!stations) {
-                    perror("Memory reallocation error");
-                    fclose(top10File);
-                    fclose(bottom10File);
-                    return EXIT_FAILURE;
-                }
-            }
+    for (int i = 0; i < shards.count; i++) {
+        stats.readStalls += inputs[i].ahead.stalls;
+    }
+    size_t input_end = input->mapped ? input->size : 0;
+    int partial_line = input->mapped && input->data[input->size - 1] != '\n';
+    closeInputs(inputs, shards.count);
+    if (debugFile) fclose(debugFile);
+
+    if (follow) {
+        if (partial_line) fprintf(stderr, "Warning: the last line of %s was incomplete and has been read as is\n", input_path);
+        followInput(&reports, input_path, input_end, (int)stats.linesRead, threads, refresh_ms, refresh_lines, &stats);
+    }
 
-            // Parse line
-            sscanf(line, "%d:%ld:%lf:%lf", &stations[count].key, &stations[count].capacity,
-                   &stations[count].consumption, &stations[count].difference);
-            count++;
-        }
+    if (!batch && reports.reports[0].filter.plantId != -1 && reports.reports[0].plantLines == 0) {
+        fprintf(stderr, "Error: The plant ID %s does not exist in the file.\n", query[2]);
+        freeShardList(&shards);
+        freeReportSet(&reports);
+        return EXIT_FAILURE;
+    }
 
-        // Sort the stations array by the difference column
-        qsort(stations, count, sizeof(StationDiff), compareByDifference);
+    if (!batch && reports.reports[0].keptLines == 0) {
+        fprintf(stderr, "Error: No data found for the specified parameters.\n");
+        freeShardList(&shards);
+        freeReportSet(&reports);
+        return EXIT_FAILURE;
+    }
 
-        // Write the sorted data to lv_all_minmax.csv
-        FILE* outputFile = fopen("output/lv_all_minmax.csv", "w");
-        if (!outputFile) {
-            perror("Error opening output file");
-            fclose(top10File);
-            fclose(bottom10File);
-            free(stations);
-            return EXIT_FAILURE;
-        }
+    // The candidates are settled by a second pass over their own lines only
+    if (verify && verifyCandidates(&reports.reports[0], shards.paths, shards.count, read_ahead, &stats) != 0) {
+        perror("Error opening input file");
+        freeShardList(&shards);
+        freeReportSet(&reports);
+        return EXIT_FAILURE;
+    }
 
-        for (int i = 0; i < count; i++) {
-            fprintf(outputFile, "%d:%ld:%.2f:%.2f\n", stations[i].key,
-                    stations[i].capacity, stations[i].consumption, stations[i].difference);
+    int status = EXIT_SUCCESS;
+    if (serve) {
+        Server server;
+        initServer(&server, &reports);
+        addTimer(&stats.timers, "load", statsClock() - total_start);
+
+        start = statsClock();
+        if (socket_path) {
+            if (serveSocket(&server, socket_path) != 0) {
+                perror("Error creating the query socket");
+                status = EXIT_FAILURE;
+            }
+        } else {
+            fprintf(stderr, "Serving queries on standard input\n");
+            // The JSON of --stats - follows the answers on the descriptor that serveStream closes
+            serveStream(&server, STDIN_FILENO, stats_stdout ? dup(answer_fd) : answer_fd);
         }
+        addTimer(&stats.timers, "serve", statsClock() - start);
+        stats.queries = server.queries;
+        freeServer(&server);
+
+        addTimer(&stats.timers, "total", statsClock() - total_start);
+        if (stats_path && writeStatsFile(stats_path, answer_fd, positional[0], &stats, &reports) != 0) status = EXIT_FAILURE;
+        freeShardList(&shards);
+        freeReportSet(&reports);
+        return status;
+    }
 
-        // Clean up
-        fclose(top10File);
-        fclose(bottom10File);
-        fclose(outputFile);
-        free(stations);
-
-        char scriptPath[256];
-        sprintf(scriptPath, "output/plot_%s_%s.gp", station_type, consumer_type);
-        generateGnuplotScript(scriptPath, "output/top10_lv_all.csv", "output/bottom10_lv_all.csv", "output/chart_lv_all.png");
+    for (int i = 0; i < reports.count; i++) {
+        if (reports.reports[i].keptLines == 0) continue;
+        if (writeReport(&reports.reports[i], "", charts, binary) != 0) status = EXIT_FAILURE;
+    }
 
-        system("gnuplot output/plot_lv_all.gp");
+    for (int p = 0; p < reports.plantCount; p++) {
+        char suffix[32];
+        sprintf(suffix, "_%d", reports.plants[p].plantId);
+        for (int i = 0; i < reports.count; i++) {
+            if (reports.plants[p].reports[i].keptLines == 0) continue;
+            if (writeReport(&reports.plants[p].reports[i], suffix, charts, binary) != 0) status = EXIT_FAILURE;
+        }
     }
 
-    freeTree(tree);
-    return EXIT_SUCCESS;
+    addTimer(&stats.timers, "total", statsClock() - total_start);
+    if (stats_path && writeStatsFile(stats_path, answer_fd, positional[0], &stats, &reports) != 0) status = EXIT_FAILURE;
+
+    freeShardList(&shards);
+    freeReportSet(&reports);
+    return status;
 }
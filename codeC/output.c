@@ -0,0 +1,358 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "output.h"
+
+int openOutput(OutputFile* output, const char* path) {
+/**
+ * @brief Creates (or truncates) an output file and allocates its buffer.
+ *
+ * @param output The output to initialize.
+ * @param path The path of the file to write.
+ * @return 0 on success, -1 on error (errno is set).
+ */
+
+    output->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (output->fd < 0) return -1;
+
+    output->buffer = malloc(OUTPUT_BUFFER_SIZE);
+    if (!output->buffer) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    output->used = 0;
+    output->error = 0;
+    output->target = NULL;
+    output->temporary = NULL;
+    return 0;
+}
+
+int openOutputReplace(OutputFile* output, const char* path) {
+/**
+ * @brief Opens an output that replaces a file in one step when it is closed.
+ *
+ * The data goes to a temporary file next to path, renamed over path by
+ * closeOutput(), so readers see either the old or the new file, never a
+ * partial one.
+ *
+ * @param output The output to initialize.
+ * @param path The path of the file to replace.
+ * @return 0 on success, -1 on error (errno is set).
+ */
+
+    size_t size = strlen(path) + 32;
+    char* temporary = malloc(size);
+    char* target = strdup(path);
+    if (!temporary || !target) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    snprintf(temporary, size, "%s.%d.tmp", path, (int)getpid());
+
+    if (openOutput(output, temporary) != 0) {
+        int error = errno;
+        free(temporary);
+        free(target);
+        errno = error;
+        return -1;
+    }
+    output->target = target;
+    output->temporary = temporary;
+    return 0;
+}
+
+void attachOutput(OutputFile* output, int fd) {
+/**
+ * @brief Buffers the writes to an already open descriptor, such as standard output or a socket.
+ *
+ * @param output The output to initialize.
+ * @param fd The descriptor; closeOutput() closes it.
+ */
+
+    output->fd = fd;
+    output->buffer = malloc(OUTPUT_BUFFER_SIZE);
+    if (!output->buffer) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    output->used = 0;
+    output->error = 0;
+    output->target = NULL;
+    output->temporary = NULL;
+}
+
+static void flushOutput(OutputFile* output) {
+/**
+ * @brief Writes the buffered bytes to the file.
+ *
+ * @param output The output to flush; its error flag is set if the write fails.
+ */
+
+    size_t written = 0;
+    while (written < output->used && !output->error) {
+        ssize_t count = write(output->fd, output->buffer + written, output->used - written);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            output->error = errno;
+        } else {
+            written += (size_t)count;
+        }
+    }
+    output->used = 0;
+}
+
+int pushOutput(OutputFile* output) {
+/**
+ * @brief Writes the buffered bytes now, so that a complete answer reaches the reader.
+ *
+ * @param output The output to flush.
+ * @return 0 on success, -1 if any write failed (errno is set).
+ */
+
+    flushOutput(output);
+    if (output->error) {
+        errno = output->error;
+        return -1;
+    }
+    return 0;
+}
+
+static char* reserveOutput(OutputFile* output, size_t size) {
+/**
+ * @brief Returns room for size bytes at the end of the buffer, flushing it if needed.
+ *
+ * @param output The output to write to.
+ * @param size The number of bytes needed, at most OUTPUT_BUFFER_SIZE.
+ * @return The first free byte of the buffer.
+ */
+
+    if (output->used + size > OUTPUT_BUFFER_SIZE) flushOutput(output);
+    return output->buffer + output->used;
+}
+
+void writeBytes(OutputFile* output, const void* data, size_t size) {
+/**
+ * @brief Appends raw bytes to the output.
+ *
+ * @param output The output to write to.
+ * @param data The bytes to write.
+ * @param size The number of bytes.
+ */
+
+    const char* bytes = data;
+    while (size > 0) {
+        size_t part = size < OUTPUT_BUFFER_SIZE ? size : OUTPUT_BUFFER_SIZE;
+        memcpy(reserveOutput(output, part), bytes, part);
+        output->used += part;
+        bytes += part;
+        size -= part;
+    }
+}
+
+void writeText(OutputFile* output, const char* text) {
+/**
+ * @brief Appends a string to the output.
+ *
+ * @param output The output to write to.
+ * @param text The string to write.
+ */
+
+    writeBytes(output, text, strlen(text));
+}
+
+static void writeChar(OutputFile* output, char c) {
+/**
+ * @brief Appends one character to the output.
+ *
+ * @param output The output to write to.
+ * @param c The character to write.
+ */
+
+    *reserveOutput(output, 1) = c;
+    output->used++;
+}
+
+static size_t formatUnsigned(char* destination, unsigned long value) {
+/**
+ * @brief Writes the decimal digits of an unsigned integer.
+ *
+ * @param destination Receives the digits (at least 20 bytes).
+ * @param value The integer to format.
+ * @return The number of digits written.
+ */
+
+    char digits[20];
+    size_t count = 0;
+
+    do {
+        digits[sizeof(digits) - 1 - count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    memcpy(destination, digits + sizeof(digits) - count, count);
+    return count;
+}
+
+void writeInteger(OutputFile* output, long value) {
+/**
+ * @brief Appends an integer to the output, formatted like "%ld".
+ *
+ * @param output The output to write to.
+ * @param value The integer to write.
+ */
+
+    char* p = reserveOutput(output, OUTPUT_FIELD_SIZE);
+    size_t length = 0;
+    unsigned long magnitude = (unsigned long)value;
+
+    if (value < 0) {
+        p[length++] = '-';
+        magnitude = 0 - magnitude;
+    }
+    length += formatUnsigned(p + length, magnitude);
+    output->used += length;
+}
+
+void writeFixed2(OutputFile* output, long value) {
+/**
+ * @brief Appends an integer amount to the output with two decimals, like "%.2f" of its value.
+ *
+ * Amounts are exact integers, so the decimals are always ".00".
+ *
+ * @param output The output to write to.
+ * @param value The amount to write.
+ */
+
+    writeInteger(output, value);
+    memcpy(reserveOutput(output, 3), ".00", 3);
+    output->used += 3;
+}
+
+void writeStation(OutputFile* output, const StationDiff* station, int withDifference) {
+/**
+ * @brief Appends one station row: "key:capacity:consumption", then ":difference" if requested.
+ *
+ * @param output The output to write to.
+ * @param station The station to write.
+ * @param withDifference 1 to add the difference column (top/bottom and min/max files).
+ */
+
+    writeInteger(output, station->key);
+    writeChar(output, ':');
+    writeInteger(output, station->capacity);
+    writeChar(output, ':');
+    writeFixed2(output, station->consumption);
+    if (withDifference) {
+        writeChar(output, ':');
+        writeFixed2(output, station->difference);
+    }
+    writeChar(output, '\n');
+}
+
+void writeSortedHeader(OutputFile* output, const char* stationType) {
+/**
+ * @brief Appends the header line of a sorted file, such as "IDlv:Capacity:Consumption".
+ *
+ * @param output The output to write to.
+ * @param stationType The station level of the report.
+ */
+
+    writeText(output, "ID");
+    writeText(output, stationType);
+    writeText(output, ":Capacity:Consumption\n");
+}
+
+int compareByDifference(const void* a, const void* b) {
+/**
+ * @brief Compares two StationDiff structures by their difference values.
+ * 
+ * @param a Pointer to the first StationDiff structure.
+ * @param b Pointer to the second StationDiff structure.
+ * @return An integer less than, equal to, or greater than zero if the difference
+ *         of the first structure is less than, equal to, or greater than that of the second.
+ */
+
+    const StationDiff* stationA = (const StationDiff*)a;
+    const StationDiff* stationB = (const StationDiff*)b;
+
+    if (stationA->difference < stationB->difference) return -1;
+    if (stationA->difference > stationB->difference) return 1;
+    return 0;
+}
+
+void writeSortedFile(StationDiff* stations, int count, OutputFile* outputFile) {
+/**
+ * @brief Writes the station snapshot, already sorted by capacity, to a file.
+ * 
+ * @param stations The sorted station snapshot.
+ * @param count The number of stations.
+ * @param outputFile The file to write the sorted station data.
+ */
+
+    for (int i = 0; i < count; i++) {
+        writeStation(outputFile, &stations[i], 0);
+    }
+}
+
+void writeMinMaxFile(StationDiff* extremes, int count, OutputFile* outputFile) {
+/**
+ * @brief Sorts the top and bottom rows together by difference and writes them to a file.
+ * 
+ * The rows are sorted with a stable insertion sort, so rows with the same
+ * difference keep their top-then-bottom order.
+ * 
+ * @param extremes The top rows followed by the bottom rows; sorted in place.
+ * @param count The total number of rows.
+ * @param outputFile The file to write the sorted rows.
+ */
+
+    for (int i = 1; i < count; i++) {
+        StationDiff current = extremes[i];
+        int j = i;
+        while (j > 0 && compareByDifference(&extremes[j - 1], &current) > 0) {
+            extremes[j] = extremes[j - 1];
+            j--;
+        }
+        extremes[j] = current;
+    }
+
+    for (int i = 0; i < count; i++) {
+        writeStation(outputFile, &extremes[i], 1);
+    }
+}
+
+int closeOutput(OutputFile* output) {
+/**
+ * @brief Flushes the buffer, closes the file and releases the buffer.
+ *
+ * A file opened with openOutputReplace() is renamed over its target if
+ * every write succeeded, and removed otherwise.
+ *
+ * @param output The output to close.
+ * @return 0 on success, -1 if any write failed (errno is set).
+ */
+
+    flushOutput(output);
+    int error = output->error;
+    if (close(output->fd) != 0 && !error) error = errno;
+    free(output->buffer);
+    output->buffer = NULL;
+
+    if (output->temporary) {
+        if (!error && rename(output->temporary, output->target) != 0) error = errno;
+        if (error) unlink(output->temporary);
+        free(output->temporary);
+        free(output->target);
+        output->temporary = NULL;
+        output->target = NULL;
+    }
+
+    if (error) {
+        errno = error;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,39 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stddef.h>
+#include "station.h"
+
+// Size of the buffer filled before each write to an output file
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+// Room reserved for one field: a 64-bit integer with its sign
+#define OUTPUT_FIELD_SIZE 64
+
+// Output file written through a large user-space buffer; a replaced file is written to temporary, then renamed to target
+typedef struct {
+    int fd;
+    char* buffer;
+    size_t used;
+    int error;
+    char* target;
+    char* temporary;
+} OutputFile;
+
+// Output function prototypes
+int openOutput(OutputFile* output, const char* path);
+int openOutputReplace(OutputFile* output, const char* path);
+void attachOutput(OutputFile* output, int fd);
+int pushOutput(OutputFile* output);
+void writeBytes(OutputFile* output, const void* data, size_t size);
+void writeText(OutputFile* output, const char* text);
+void writeInteger(OutputFile* output, long value);
+void writeFixed2(OutputFile* output, long value);
+void writeStation(OutputFile* output, const StationDiff* station, int withDifference);
+void writeSortedHeader(OutputFile* output, const char* stationType);
+int compareByDifference(const void* a, const void* b);
+void writeSortedFile(StationDiff* stations, int count, OutputFile* outputFile);
+void writeMinMaxFile(StationDiff* extremes, int count, OutputFile* outputFile);
+int closeOutput(OutputFile* output);
+
+#endif
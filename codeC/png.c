@@ -0,0 +1,265 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "png.h"
+
+// Growing byte buffer written bit by bit, least significant bit first, as deflate expects
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+    uint32_t bits;
+    int bitCount;
+} BitWriter;
+
+static void putByte(BitWriter* writer, uint8_t byte) {
+/**
+ * @brief Appends a byte to the buffer, growing it if needed.
+ *
+ * @param writer The buffer.
+ * @param byte The byte to append.
+ */
+
+    if (writer->size == writer->capacity) {
+        writer->capacity = writer->capacity ? 2 * writer->capacity : 4096;
+        writer->data = realloc(writer->data, writer->capacity);
+        if (!writer->data) {
+            perror("Memory reallocation error");
+            exit(EXIT_FAILURE);
+        }
+    }
+    writer->data[writer->size++] = byte;
+}
+
+static void putBits(BitWriter* writer, uint32_t value, int count) {
+/**
+ * @brief Appends the count low bits of a value, least significant first.
+ *
+ * @param writer The buffer.
+ * @param value The bits to append.
+ * @param count The number of bits, at most 16.
+ */
+
+    writer->bits |= value << writer->bitCount;
+    writer->bitCount += count;
+    while (writer->bitCount >= 8) {
+        putByte(writer, (uint8_t)writer->bits);
+        writer->bits >>= 8;
+        writer->bitCount -= 8;
+    }
+}
+
+static void putCode(BitWriter* writer, uint32_t code, int length) {
+/**
+ * @brief Appends a Huffman code, whose bits are stored most significant first.
+ *
+ * @param writer The buffer.
+ * @param code The code.
+ * @param length The number of bits of the code.
+ */
+
+    uint32_t reversed = 0;
+    for (int i = 0; i < length; i++) {
+        reversed = (reversed << 1) | ((code >> i) & 1);
+    }
+    putBits(writer, reversed, length);
+}
+
+static void putSymbol(BitWriter* writer, int symbol) {
+/**
+ * @brief Appends a literal/length symbol with the fixed Huffman codes of deflate.
+ *
+ * @param writer The buffer.
+ * @param symbol The symbol, 0 to 287.
+ */
+
+    if (symbol < 144) {
+        putCode(writer, 0x30 + symbol, 8);
+    } else if (symbol < 256) {
+        putCode(writer, 0x190 + symbol - 144, 9);
+    } else if (symbol < 280) {
+        putCode(writer, symbol - 256, 7);
+    } else {
+        putCode(writer, 0xc0 + symbol - 280, 8);
+    }
+}
+
+static void putRepeat(BitWriter* writer, int length) {
+/**
+ * @brief Appends a match repeating the previous byte length times (distance 1).
+ *
+ * @param writer The buffer.
+ * @param length The length of the match, 3 to DEFLATE_MAX_MATCH.
+ */
+
+    static const int base[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static const int extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+
+    int code = 28;
+    while (base[code] > length) code--;
+
+    putSymbol(writer, 257 + code);
+    putBits(writer, (uint32_t)(length - base[code]), extra[code]);
+    putCode(writer, 0, 5);
+}
+
+static void deflateRuns(BitWriter* writer, const uint8_t* data, size_t size) {
+/**
+ * @brief Compresses bytes into a zlib stream of one fixed-Huffman deflate block.
+ *
+ * Only runs of one repeated byte are matched (distance 1). Once the rows
+ * are filtered against the row above, a chart is almost entirely made of
+ * such runs, which this encodes in a few bits each.
+ *
+ * @param writer The buffer receiving the stream.
+ * @param data The bytes to compress.
+ * @param size The number of bytes.
+ */
+
+    putByte(writer, 0x78);
+    putByte(writer, 0x01);
+    putBits(writer, 1, 1);
+    putBits(writer, 1, 2);
+
+    size_t i = 0;
+    while (i < size) {
+        size_t run = 1;
+        while (i + run < size && data[i + run] == data[i]) run++;
+
+        putSymbol(writer, data[i]);
+        size_t left = run - 1;
+        while (left >= 3) {
+            int length = left < DEFLATE_MAX_MATCH ? (int)left : DEFLATE_MAX_MATCH;
+            putRepeat(writer, length);
+            left -= length;
+        }
+        for (; left > 0; left--) {
+            putSymbol(writer, data[i]);
+        }
+        i += run;
+    }
+
+    putSymbol(writer, 256);
+    if (writer->bitCount > 0) putBits(writer, 0, 8 - writer->bitCount);
+
+    uint32_t a = 1;
+    uint32_t b = 0;
+    for (size_t j = 0; j < size; j++) {
+        a = (a + data[j]) % 65521;
+        b = (b + a) % 65521;
+    }
+    uint32_t adler = (b << 16) | a;
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        putByte(writer, (uint8_t)(adler >> shift));
+    }
+}
+
+static uint32_t crc32(uint32_t crc, const uint8_t* data, size_t size) {
+/**
+ * @brief Extends the CRC-32 of a PNG chunk.
+ *
+ * @param crc The CRC so far (0 for a new chunk).
+ * @param data The bytes to add.
+ * @param size The number of bytes.
+ * @return The extended CRC.
+ */
+
+    static uint32_t table[256];
+    if (!table[1]) {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) {
+                c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            table[n] = c;
+        }
+    }
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static void writeChunk(FILE* file, const char* type, const uint8_t* data, size_t size) {
+/**
+ * @brief Writes a PNG chunk: its length, type, data and CRC.
+ *
+ * @param file The PNG file.
+ * @param type The four-letter chunk type.
+ * @param data The chunk data.
+ * @param size The size of the data.
+ */
+
+    uint8_t length[4] = {(uint8_t)(size >> 24), (uint8_t)(size >> 16), (uint8_t)(size >> 8), (uint8_t)size};
+    uint32_t crc = crc32(0, (const uint8_t*)type, 4);
+    crc = crc32(crc, data, size);
+    uint8_t check[4] = {(uint8_t)(crc >> 24), (uint8_t)(crc >> 16), (uint8_t)(crc >> 8), (uint8_t)crc};
+
+    fwrite(length, 1, 4, file);
+    fwrite(type, 1, 4, file);
+    fwrite(data, 1, size, file);
+    fwrite(check, 1, 4, file);
+}
+
+int writePng(const char* path, const PaletteImage* image) {
+/**
+ * @brief Writes a palette image as a PNG file.
+ *
+ * Every row but the first is filtered against the row above ("Up"), so
+ * unchanged areas become runs of zeros, then compressed by deflateRuns().
+ *
+ * @param path The path of the PNG file.
+ * @param image The image to write.
+ * @return 0 on success, -1 on error (errno is set).
+ */
+
+    size_t stride = (size_t)image->width + 1;
+    size_t size = stride * (size_t)image->height;
+    uint8_t* filtered = malloc(size);
+    if (!filtered) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int y = 0; y < image->height; y++) {
+        const uint8_t* row = image->pixels + (size_t)y * image->width;
+        uint8_t* out = filtered + (size_t)y * stride;
+        out[0] = y == 0 ? 0 : 2;
+        for (int x = 0; x < image->width; x++) {
+            out[1 + x] = y == 0 ? row[x] : (uint8_t)(row[x] - row[x - image->width]);
+        }
+    }
+
+    BitWriter compressed;
+    memset(&compressed, 0, sizeof(compressed));
+    deflateRuns(&compressed, filtered, size);
+    free(filtered);
+
+    uint8_t header[13] = {
+        (uint8_t)(image->width >> 24), (uint8_t)(image->width >> 16), (uint8_t)(image->width >> 8), (uint8_t)image->width,
+        (uint8_t)(image->height >> 24), (uint8_t)(image->height >> 16), (uint8_t)(image->height >> 8), (uint8_t)image->height,
+        8, 3, 0, 0, 0
+    };
+
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        free(compressed.data);
+        return -1;
+    }
+
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    fwrite(signature, 1, sizeof(signature), file);
+    writeChunk(file, "IHDR", header, sizeof(header));
+    writeChunk(file, "PLTE", &image->palette[0][0], (size_t)image->colors * 3);
+    writeChunk(file, "IDAT", compressed.data, compressed.size);
+    writeChunk(file, "IEND", NULL, 0);
+    free(compressed.data);
+
+    int failed = ferror(file);
+    if (fclose(file) != 0 || failed) return -1;
+    return 0;
+}
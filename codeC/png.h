@@ -0,0 +1,21 @@
+#ifndef PNG_H
+#define PNG_H
+
+#include <stdint.h>
+
+// Longest match of the deflate format
+#define DEFLATE_MAX_MATCH 258
+
+// An 8-bit palette image, one byte per pixel, row by row
+typedef struct {
+    int width;
+    int height;
+    uint8_t* pixels;
+    const uint8_t (*palette)[3];
+    int colors;
+} PaletteImage;
+
+// PNG function prototypes
+int writePng(const char* path, const PaletteImage* image);
+
+#endif
@@ -0,0 +1,200 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rank.h"
+
+void initRankList(RankList* list, int direction) {
+/**
+ * @brief Initializes an empty ranking, which holds every station (none yet).
+ *
+ * @param list The ranking to initialize.
+ * @param direction 1 to keep the largest differences, -1 to keep the smallest.
+ */
+
+    list->count = 0;
+    list->complete = 1;
+    list->direction = direction;
+}
+
+void rebuildRankLists(RankList* top, RankList* bottom, const StationMap* map) {
+/**
+ * @brief Fills both ends of a ranking from a full scan of the stations.
+ *
+ * @param top The ranking of the largest differences.
+ * @param bottom The ranking of the smallest differences.
+ * @param map The aggregated stations.
+ */
+
+    StationDiff* stations;
+    int count = collectStations(map, &stations);
+
+    top->count = bottom->count = selectExtremes(stations, count, RANK_DEPTH, top->entries, bottom->entries);
+    top->complete = bottom->complete = count <= RANK_DEPTH;
+    free(stations);
+}
+
+static int rankBefore(const RankList* list, const StationDiff* a, const StationDiff* b) {
+/**
+ * @brief Tells whether a station ranks strictly before another in a ranking.
+ */
+
+    return list->direction * compareByRank(a, b) > 0;
+}
+
+static int compareLargestFirst(const void* a, const void* b) {
+/**
+ * @brief qsort adapter ranking stations from the largest difference down.
+ */
+
+    return compareByRank((const StationDiff*)b, (const StationDiff*)a);
+}
+
+static int compareSmallestFirst(const void* a, const void* b) {
+/**
+ * @brief qsort adapter ranking stations from the smallest difference up.
+ */
+
+    return compareByRank((const StationDiff*)a, (const StationDiff*)b);
+}
+
+static int changedKey(const StationDiff* changed, int count, int key) {
+/**
+ * @brief Tells whether a key is among the changed stations, sorted by key.
+ */
+
+    int low = 0;
+    int high = count;
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (changed[middle].key < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low < count && changed[low].key == key;
+}
+
+int updateRankList(RankList* list, const StationDiff* changed, int count, int limit) {
+/**
+ * @brief Updates a ranking with the stations changed since it was last updated.
+ *
+ * Stations outside the list and unchanged all rank after its last entry,
+ * the threshold. So the unchanged entries, plus the changed stations that
+ * rank at or before the old threshold, are exactly the stations ranking at
+ * or before it: the list stays exact, possibly shorter. Only when fewer than
+ * limit entries remain must the ranking be rebuilt from a full scan. A list
+ * holding every station stays complete until it overflows RANK_DEPTH.
+ *
+ * @param list The ranking to update.
+ * @param changed The current values of the changed stations (new ones included), sorted by key without duplicates.
+ * @param count The number of changed stations.
+ * @param limit The number of entries that must stay exact.
+ * @return 0 on success, -1 if the ranking must be rebuilt with rebuildRankLists().
+ */
+
+    if (count == 0) return list->count >= limit || list->complete ? 0 : -1;
+
+    StationDiff threshold = list->count > 0 ? list->entries[list->count - 1] : changed[0];
+    int bounded = !list->complete;
+
+    StationDiff* candidates = malloc((size_t)(list->count + count) * sizeof(StationDiff));
+    if (!candidates) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+
+    int size = 0;
+    for (int i = 0; i < list->count; i++) {
+        if (!changedKey(changed, count, list->entries[i].key)) candidates[size++] = list->entries[i];
+    }
+    for (int i = 0; i < count; i++) {
+        if (!bounded || !rankBefore(list, &threshold, &changed[i])) candidates[size++] = changed[i];
+    }
+
+    qsort(candidates, size, sizeof(StationDiff), list->direction > 0 ? compareLargestFirst : compareSmallestFirst);
+
+    list->count = size < RANK_DEPTH ? size : RANK_DEPTH;
+    memcpy(list->entries, candidates, list->count * sizeof(StationDiff));
+    if (size > RANK_DEPTH) list->complete = 0;
+    free(candidates);
+
+    return list->complete || list->count >= limit ? 0 : -1;
+}
+
+void addChangedKeys(ChangedKeys* changed, const StationMap* map) {
+/**
+ * @brief Records the keys of every station of a partial aggregate as changed.
+ *
+ * @param changed The changed keys.
+ * @param map The stations aggregated from the new lines only.
+ */
+
+    StationDiff* stations;
+    int count = collectStations(map, &stations);
+
+    if (changed->count + count > changed->size) {
+        changed->size = 2 * (changed->count + count);
+        changed->keys = realloc(changed->keys, (size_t)changed->size * sizeof(int));
+        if (!changed->keys) {
+            perror("Memory reallocation error");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        changed->keys[changed->count++] = stations[i].key;
+    }
+    free(stations);
+}
+
+static int compareKeys(const void* a, const void* b) {
+/**
+ * @brief qsort adapter ordering station IDs.
+ */
+
+    int keyA = *(const int*)a;
+    int keyB = *(const int*)b;
+    return (keyA > keyB) - (keyA < keyB);
+}
+
+int takeChangedStations(ChangedKeys* changed, const StationMap* map, StationDiff** stations) {
+/**
+ * @brief Looks up the current values of the changed stations and forgets the changes.
+ *
+ * @param changed The changed keys; emptied.
+ * @param map The complete aggregate.
+ * @param stations Receives the changed stations sorted by key, without duplicates; the caller frees it.
+ * @return The number of changed stations.
+ */
+
+    qsort(changed->keys, changed->count, sizeof(int), compareKeys);
+
+    *stations = malloc((size_t)(changed->count > 0 ? changed->count : 1) * sizeof(StationDiff));
+    if (!*stations) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+
+    int count = 0;
+    for (int i = 0; i < changed->count; i++) {
+        if (i > 0 && changed->keys[i] == changed->keys[i - 1]) continue;
+        if (findStation(map, changed->keys[i], &(*stations)[count])) count++;
+    }
+
+    changed->count = 0;
+    return count;
+}
+
+void freeChangedKeys(ChangedKeys* changed) {
+/**
+ * @brief Frees the changed keys.
+ *
+ * @param changed The changed keys.
+ */
+
+    free(changed->keys);
+    changed->keys = NULL;
+    changed->count = 0;
+    changed->size = 0;
+}
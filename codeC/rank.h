@@ -0,0 +1,32 @@
+#ifndef RANK_H
+#define RANK_H
+
+#include "station.h"
+
+// Stations kept at each end of a live ranking, beyond the 10 that are published
+#define RANK_DEPTH 64
+
+// The stations with the largest (direction 1) or smallest (direction -1) differences, best first
+typedef struct {
+    StationDiff entries[RANK_DEPTH];
+    int count;
+    int complete;
+    int direction;
+} RankList;
+
+// Keys of the stations changed since the ranking was last updated, possibly repeated
+typedef struct {
+    int* keys;
+    int count;
+    int size;
+} ChangedKeys;
+
+// Ranking function prototypes
+void initRankList(RankList* list, int direction);
+void rebuildRankLists(RankList* top, RankList* bottom, const StationMap* map);
+int updateRankList(RankList* list, const StationDiff* changed, int count, int limit);
+void addChangedKeys(ChangedKeys* changed, const StationMap* map);
+int takeChangedStations(ChangedKeys* changed, const StationMap* map, StationDiff** stations);
+void freeChangedKeys(ChangedKeys* changed);
+
+#endif
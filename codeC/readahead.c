@@ -0,0 +1,428 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "readahead.h"
+
+int parseReadAhead(const char* name, ReadAheadMode* mode) {
+/**
+ * @brief Parses the read-ahead mode given on the command line.
+ *
+ * @param name The mode name: auto, uring, thread or off.
+ * @param mode Receives the mode.
+ * @return 0 on success, -1 if the name is unknown.
+ */
+
+    if (strcmp(name, "auto") == 0) {
+        *mode = READ_AHEAD_AUTO;
+    } else if (strcmp(name, "uring") == 0) {
+        *mode = READ_AHEAD_URING;
+    } else if (strcmp(name, "thread") == 0) {
+        *mode = READ_AHEAD_THREAD;
+    } else if (strcmp(name, "off") == 0) {
+        *mode = READ_AHEAD_OFF;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+const char* readAheadName(ReadAheadMode mode) {
+/**
+ * @brief Returns the name of a read-ahead mode, as accepted by parseReadAhead().
+ *
+ * @param mode The mode.
+ * @return The name of the mode.
+ */
+
+    switch (mode) {
+        case READ_AHEAD_AUTO: return "auto";
+        case READ_AHEAD_URING: return "uring";
+        case READ_AHEAD_THREAD: return "thread";
+        case READ_AHEAD_OFF: return "off";
+        default: return "default";
+    }
+}
+
+static int setupUring(Uring* uring, unsigned entries) {
+/**
+ * @brief Creates an io_uring instance and maps its rings.
+ *
+ * The C library has no io_uring wrapper and liburing is not required, so
+ * the rings are set up with the raw system calls.
+ *
+ * @param uring The instance to create.
+ * @param entries The number of submission entries.
+ * @return 0 on success, -1 if the kernel does not offer io_uring (errno is set).
+ */
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    memset(uring, 0, sizeof(*uring));
+
+    uring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (uring->fd < 0) return -1;
+
+    uring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    uring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    int single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single && uring->cqRingSize > uring->sqRingSize) uring->sqRingSize = uring->cqRingSize;
+
+    uring->sqRing = mmap(NULL, uring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         uring->fd, IORING_OFF_SQ_RING);
+    uring->cqRing = single ? uring->sqRing
+                           : mmap(NULL, uring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                  uring->fd, IORING_OFF_CQ_RING);
+    uring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    uring->sqes = mmap(NULL, uring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       uring->fd, IORING_OFF_SQES);
+    if (uring->sqRing == MAP_FAILED || uring->cqRing == MAP_FAILED || uring->sqes == MAP_FAILED) {
+        int error = errno;
+        if (uring->sqes != MAP_FAILED) munmap(uring->sqes, uring->sqesSize);
+        if (!single && uring->cqRing != MAP_FAILED) munmap(uring->cqRing, uring->cqRingSize);
+        if (uring->sqRing != MAP_FAILED) munmap(uring->sqRing, uring->sqRingSize);
+        close(uring->fd);
+        errno = error;
+        return -1;
+    }
+    if (single) uring->cqRingSize = 0;
+
+    char* sq = uring->sqRing;
+    char* cq = uring->cqRing;
+    uring->sqTail = (unsigned*)(sq + params.sq_off.tail);
+    uring->sqMask = (unsigned*)(sq + params.sq_off.ring_mask);
+    uring->sqArray = (unsigned*)(sq + params.sq_off.array);
+    uring->cqHead = (unsigned*)(cq + params.cq_off.head);
+    uring->cqTail = (unsigned*)(cq + params.cq_off.tail);
+    uring->cqMask = (unsigned*)(cq + params.cq_off.ring_mask);
+    uring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    return 0;
+}
+
+static void closeUring(Uring* uring) {
+/**
+ * @brief Unmaps the rings of an io_uring instance and closes it.
+ *
+ * @param uring The instance, with no request in flight.
+ */
+
+    munmap(uring->sqes, uring->sqesSize);
+    if (uring->cqRingSize) munmap(uring->cqRing, uring->cqRingSize);
+    munmap(uring->sqRing, uring->sqRingSize);
+    close(uring->fd);
+}
+
+static void submitRead(ReadAhead* ahead, int index) {
+/**
+ * @brief Queues the read of the rest of a buffer on the io_uring instance.
+ *
+ * The buffer is read at its own offset, after the bytes it already holds,
+ * so reads of several buffers can be in flight and complete in any order.
+ *
+ * @param ahead The pipeline.
+ * @param index The buffer to fill.
+ */
+
+    Uring* uring = &ahead->uring;
+    ReadBuffer* buffer = &ahead->buffers[index];
+    unsigned tail = *uring->sqTail;
+    unsigned slot = tail & *uring->sqMask;
+
+    struct io_uring_sqe* sqe = &uring->sqes[slot];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = ahead->fd;
+    sqe->addr = (uint64_t)(uintptr_t)(buffer->data + buffer->size);
+    sqe->len = (unsigned)(READ_AHEAD_BUFFER_SIZE - buffer->size);
+    sqe->off = (uint64_t)(buffer->offset + (off_t)buffer->size);
+    sqe->user_data = (uint64_t)index;
+    uring->sqArray[slot] = slot;
+    __atomic_store_n(uring->sqTail, tail + 1, __ATOMIC_RELEASE);
+
+    buffer->state = BUFFER_READING;
+    while (syscall(__NR_io_uring_enter, uring->fd, 1, 0, 0, NULL, 0) < 0 && errno == EINTR) {
+    }
+}
+
+static void queueBuffer(ReadAhead* ahead, int index) {
+/**
+ * @brief Gives an empty buffer the next range of the file and queues its read.
+ *
+ * @param ahead The pipeline.
+ * @param index The empty buffer.
+ */
+
+    ReadBuffer* buffer = &ahead->buffers[index];
+    buffer->size = 0;
+    buffer->offset = ahead->offset;
+    ahead->offset += READ_AHEAD_BUFFER_SIZE;
+    submitRead(ahead, index);
+}
+
+static void reapCompletion(ReadAhead* ahead) {
+/**
+ * @brief Waits for one completed read of the io_uring instance and updates its buffer.
+ *
+ * A short read before the end of the buffer queues the rest of the buffer
+ * again; a read of 0 bytes is the end of the file.
+ *
+ * @param ahead The pipeline.
+ */
+
+    Uring* uring = &ahead->uring;
+    unsigned head = *uring->cqHead;
+
+    while (head == __atomic_load_n(uring->cqTail, __ATOMIC_ACQUIRE)) {
+        if (syscall(__NR_io_uring_enter, uring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR) {
+            perror("Error waiting for input reads");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    const struct io_uring_cqe* cqe = &uring->cqes[head & *uring->cqMask];
+    int index = (int)cqe->user_data;
+    int result = cqe->res;
+    __atomic_store_n(uring->cqHead, head + 1, __ATOMIC_RELEASE);
+
+    ReadBuffer* buffer = &ahead->buffers[index];
+    if (result == -EINTR || result == -EAGAIN) {
+        submitRead(ahead, index);
+    } else if (result < 0) {
+        ahead->error = -result;
+        ahead->eof = 1;
+        buffer->state = BUFFER_FILLED;
+    } else if (result == 0) {
+        ahead->eof = 1;
+        buffer->state = BUFFER_FILLED;
+    } else {
+        buffer->size += (size_t)result;
+        if (buffer->size < READ_AHEAD_BUFFER_SIZE) {
+            submitRead(ahead, index);
+        } else {
+            buffer->state = BUFFER_FILLED;
+        }
+    }
+}
+
+static size_t readFully(int fd, char* data, size_t size, int* error) {
+/**
+ * @brief Reads until a buffer is full, the input ends or an error occurs.
+ *
+ * @param fd The input.
+ * @param data The buffer.
+ * @param size The size of the buffer.
+ * @param error Receives errno if a read failed, 0 otherwise.
+ * @return The number of bytes read.
+ */
+
+    size_t done = 0;
+    *error = 0;
+    while (done < size) {
+        ssize_t count = read(fd, data + done, size - done);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            *error = errno;
+            break;
+        }
+        if (count == 0) break;
+        done += (size_t)count;
+    }
+    return done;
+}
+
+static void* readerThread(void* argument) {
+/**
+ * @brief Thread entry point filling the buffers of the ring in order.
+ *
+ * The thread waits for the next buffer to be released by the parser, fills
+ * it, and hands it over; it ends after the buffer holding the end of the
+ * input or when the pipeline stops.
+ *
+ * @param argument The pipeline.
+ * @return NULL.
+ */
+
+    ReadAhead* ahead = argument;
+
+    for (int index = 0;; index = (index + 1) % READ_AHEAD_BUFFERS) {
+        ReadBuffer* buffer = &ahead->buffers[index];
+
+        pthread_mutex_lock(&ahead->lock);
+        while (!ahead->stopping && buffer->state != BUFFER_EMPTY) {
+            pthread_cond_wait(&ahead->emptied, &ahead->lock);
+        }
+        if (ahead->stopping) {
+            pthread_mutex_unlock(&ahead->lock);
+            return NULL;
+        }
+        buffer->state = BUFFER_READING;
+        pthread_mutex_unlock(&ahead->lock);
+
+        int error;
+        size_t size = readFully(ahead->fd, buffer->data, READ_AHEAD_BUFFER_SIZE, &error);
+
+        pthread_mutex_lock(&ahead->lock);
+        buffer->size = size;
+        buffer->state = BUFFER_FILLED;
+        if (size < READ_AHEAD_BUFFER_SIZE) {
+            ahead->eof = 1;
+            ahead->error = error;
+        }
+        pthread_cond_signal(&ahead->filled);
+        pthread_mutex_unlock(&ahead->lock);
+
+        if (size < READ_AHEAD_BUFFER_SIZE) return NULL;
+    }
+}
+
+int startReadAhead(ReadAhead* ahead, int fd, ReadAheadMode mode) {
+/**
+ * @brief Allocates the ring of buffers and starts reading the input into it.
+ *
+ * io_uring reads each buffer at its own offset, so it is only used for
+ * regular files; READ_AHEAD_AUTO and READ_AHEAD_DEFAULT fall back to the
+ * reader thread for pipes and for kernels without io_uring.
+ *
+ * @param ahead The pipeline to start.
+ * @param fd The input, read from its current position (the start for io_uring).
+ * @param mode The engine to use.
+ * @return 0 on success, -1 if io_uring was requested but cannot be used (errno is set).
+ */
+
+    memset(ahead, 0, sizeof(*ahead));
+    ahead->fd = fd;
+    ahead->held = -1;
+
+    struct stat info;
+    int regular = fstat(fd, &info) == 0 && S_ISREG(info.st_mode);
+    if (mode == READ_AHEAD_URING && !regular) {
+        errno = ESPIPE;
+        return -1;
+    }
+
+    ahead->engine = READ_AHEAD_THREAD;
+    if (mode != READ_AHEAD_THREAD && regular) {
+        if (setupUring(&ahead->uring, READ_AHEAD_BUFFERS) == 0) {
+            ahead->engine = READ_AHEAD_URING;
+        } else if (mode == READ_AHEAD_URING) {
+            return -1;
+        }
+    }
+
+    for (int i = 0; i < READ_AHEAD_BUFFERS; i++) {
+        ahead->buffers[i].memory = malloc(READ_AHEAD_HEADROOM + READ_AHEAD_BUFFER_SIZE);
+        if (!ahead->buffers[i].memory) {
+            perror("Memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+        ahead->buffers[i].data = ahead->buffers[i].memory + READ_AHEAD_HEADROOM;
+        ahead->buffers[i].state = BUFFER_EMPTY;
+    }
+
+    if (ahead->engine == READ_AHEAD_URING) {
+        for (int i = 0; i < READ_AHEAD_BUFFERS; i++) queueBuffer(ahead, i);
+        return 0;
+    }
+
+    pthread_mutex_init(&ahead->lock, NULL);
+    pthread_cond_init(&ahead->filled, NULL);
+    pthread_cond_init(&ahead->emptied, NULL);
+    if (pthread_create(&ahead->thread, NULL, readerThread, ahead) != 0) {
+        perror("Error creating the reader thread");
+        exit(EXIT_FAILURE);
+    }
+    return 0;
+}
+
+int nextReadBuffer(ReadAhead* ahead, char** data, size_t* size) {
+/**
+ * @brief Releases the buffer returned by the previous call and waits for the next one.
+ *
+ * Buffers come back in input order. The returned buffer belongs to the
+ * caller until the next call; READ_AHEAD_HEADROOM bytes in front of it may
+ * be written as well.
+ *
+ * @param ahead The pipeline.
+ * @param data Receives the first byte read into the buffer.
+ * @param size Receives the number of bytes read into the buffer.
+ * @return 1 if a buffer was returned, 0 at the end of the input, -1 on a read error (errno is set).
+ */
+
+    int released = ahead->held;
+    int index = (released + 1) % READ_AHEAD_BUFFERS;
+    ReadBuffer* buffer = &ahead->buffers[index];
+    ahead->held = index;
+
+    if (ahead->engine == READ_AHEAD_URING) {
+        if (released >= 0) {
+            ahead->buffers[released].state = BUFFER_EMPTY;
+            if (!ahead->eof) queueBuffer(ahead, released);
+        }
+        if (buffer->state == BUFFER_READING) ahead->stalls++;
+        while (buffer->state == BUFFER_READING) reapCompletion(ahead);
+    } else {
+        pthread_mutex_lock(&ahead->lock);
+        if (released >= 0) {
+            ahead->buffers[released].state = BUFFER_EMPTY;
+            pthread_cond_signal(&ahead->emptied);
+        }
+        if (buffer->state != BUFFER_FILLED && !(ahead->eof && buffer->state == BUFFER_EMPTY)) ahead->stalls++;
+        while (buffer->state != BUFFER_FILLED && !(ahead->eof && buffer->state == BUFFER_EMPTY)) {
+            pthread_cond_wait(&ahead->filled, &ahead->lock);
+        }
+        pthread_mutex_unlock(&ahead->lock);
+    }
+
+    if (buffer->state != BUFFER_FILLED || buffer->size == 0) {
+        // Nothing is held any more; a further call finds the same end
+        ahead->held = released;
+        if (ahead->error) {
+            errno = ahead->error;
+            return -1;
+        }
+        return 0;
+    }
+
+    buffer->state = BUFFER_HELD;
+    *data = buffer->data;
+    *size = buffer->size;
+    return 1;
+}
+
+void stopReadAhead(ReadAhead* ahead) {
+/**
+ * @brief Stops the pipeline and frees its buffers.
+ *
+ * Reads still in flight are waited for, since the kernel or the reader
+ * thread may still write into the buffers.
+ *
+ * @param ahead The pipeline to stop.
+ */
+
+    if (ahead->engine == READ_AHEAD_URING) {
+        for (int i = 0; i < READ_AHEAD_BUFFERS; i++) {
+            while (ahead->buffers[i].state == BUFFER_READING) reapCompletion(ahead);
+        }
+        closeUring(&ahead->uring);
+    } else {
+        pthread_mutex_lock(&ahead->lock);
+        ahead->stopping = 1;
+        pthread_cond_broadcast(&ahead->emptied);
+        pthread_mutex_unlock(&ahead->lock);
+        pthread_join(ahead->thread, NULL);
+        pthread_mutex_destroy(&ahead->lock);
+        pthread_cond_destroy(&ahead->filled);
+        pthread_cond_destroy(&ahead->emptied);
+    }
+
+    for (int i = 0; i < READ_AHEAD_BUFFERS; i++) {
+        free(ahead->buffers[i].memory);
+    }
+}
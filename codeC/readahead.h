@@ -0,0 +1,74 @@
+#ifndef READAHEAD_H
+#define READAHEAD_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+// Buffers of the ring; while the parser holds one, the others are being filled
+#define READ_AHEAD_BUFFERS 4
+#define READ_AHEAD_BUFFER_SIZE (8 << 20)
+
+// Free bytes in front of each buffer, where the partial line of the previous buffer is copied
+#define READ_AHEAD_HEADROOM (64 << 10)
+
+// How the input is read: READ_AHEAD_DEFAULT maps regular files and pipelines the other inputs,
+// READ_AHEAD_AUTO pipelines every input with io_uring when possible, READ_AHEAD_OFF never pipelines
+typedef enum { READ_AHEAD_DEFAULT, READ_AHEAD_AUTO, READ_AHEAD_URING, READ_AHEAD_THREAD, READ_AHEAD_OFF } ReadAheadMode;
+
+// State of a ring buffer
+typedef enum { BUFFER_EMPTY, BUFFER_READING, BUFFER_FILLED, BUFFER_HELD } BufferState;
+
+// One buffer of the ring and the bytes read into it
+typedef struct {
+    char* memory;
+    char* data;
+    size_t size;
+    off_t offset;
+    BufferState state;
+} ReadBuffer;
+
+// io_uring instance driven through raw system calls: its submission and completion rings
+typedef struct {
+    int fd;
+    void* sqRing;
+    size_t sqRingSize;
+    void* cqRing;
+    size_t cqRingSize;
+    struct io_uring_sqe* sqes;
+    size_t sqesSize;
+    unsigned* sqTail;
+    unsigned* sqMask;
+    unsigned* sqArray;
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned* cqMask;
+    struct io_uring_cqe* cqes;
+} Uring;
+
+// Read-ahead pipeline: a ring of buffers filled in order by io_uring or by a reader thread
+typedef struct {
+    int fd;
+    ReadAheadMode engine;
+    ReadBuffer buffers[READ_AHEAD_BUFFERS];
+    int held;
+    off_t offset;
+    int eof;
+    int error;
+    long stalls;
+    Uring uring;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t filled;
+    pthread_cond_t emptied;
+    int stopping;
+} ReadAhead;
+
+// Read-ahead function prototypes
+int parseReadAhead(const char* name, ReadAheadMode* mode);
+int startReadAhead(ReadAhead* ahead, int fd, ReadAheadMode mode);
+int nextReadBuffer(ReadAhead* ahead, char** data, size_t* size);
+void stopReadAhead(ReadAhead* ahead);
+const char* readAheadName(ReadAheadMode mode);
+
+#endif
@@ -0,0 +1,196 @@
+#include <string.h>
+#include "report.h"
+
+void initReportSet(ReportSet* set, BackendType backend, int candidates, int perPlant) {
+/**
+ * @brief Initializes an empty set of reports.
+ *
+ * @param set The set to initialize.
+ * @param backend The aggregation backend of every report.
+ * @param candidates The number of stations kept by each report with BACKEND_BOUNDED.
+ * @param perPlant 1 to also aggregate every report separately for each plant.
+ */
+
+    memset(set, 0, sizeof(*set));
+    set->backend = backend;
+    set->candidates = candidates;
+    set->perPlant = perPlant;
+    set->lastPlant = -1;
+}
+
+void addReport(ReportSet* set, const Filter* filter) {
+/**
+ * @brief Adds a report selected by a filter.
+ *
+ * @param set The set receiving the report.
+ * @param filter The selection rules of the report.
+ */
+
+    if (set->count >= MAX_REPORTS) {
+        fprintf(stderr, "Too many reports.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    Report* report = &set->reports[set->count++];
+    report->filter = *filter;
+    report->keptLines = 0;
+    report->plantLines = 0;
+    memset(&report->stats, 0, sizeof(report->stats));
+    initStationMap(&report->stations, set->backend, set->candidates);
+}
+
+void addBatchReports(ReportSet* set) {
+/**
+ * @brief Adds the five reports of the batch mode: hvb comp, hva comp, lv comp, lv indiv and lv all.
+ *
+ * @param set The set receiving the reports.
+ */
+
+    static const char* const queries[MAX_REPORTS][2] = {
+        {"hvb", "comp"}, {"hva", "comp"}, {"lv", "comp"}, {"lv", "indiv"}, {"lv", "all"}
+    };
+
+    for (int i = 0; i < MAX_REPORTS; i++) {
+        Filter filter;
+        initFilter(&filter, queries[i][0], queries[i][1], "-1");
+        addReport(set, &filter);
+    }
+}
+
+void copyReportSet(ReportSet* copy, const ReportSet* set) {
+/**
+ * @brief Creates an empty set with the same reports, used as a per-thread partial aggregate.
+ *
+ * @param copy The set to initialize.
+ * @param set The set whose reports are copied (without their stations).
+ */
+
+    initReportSet(copy, set->backend, set->candidates, set->perPlant);
+    for (int i = 0; i < set->count; i++) {
+        addReport(copy, &set->reports[i].filter);
+    }
+}
+
+PlantReports* findPlantReports(ReportSet* set, int plantId) {
+/**
+ * @brief Returns the per-plant reports of a plant, creating them on first use.
+ *
+ * The last plant found is remembered, since the lines of a plant are
+ * usually grouped together in the input.
+ *
+ * @param set The set owning the per-plant reports.
+ * @param plantId The plant ID.
+ * @return The reports of the plant; the pointer is valid until the next call.
+ */
+
+    if (set->lastPlant >= 0 && set->plants[set->lastPlant].plantId == plantId) {
+        return &set->plants[set->lastPlant];
+    }
+
+    for (int i = 0; i < set->plantCount; i++) {
+        if (set->plants[i].plantId == plantId) {
+            set->lastPlant = i;
+            return &set->plants[i];
+        }
+    }
+
+    if (set->plantCount >= set->plantSize) {
+        set->plantSize = set->plantSize ? set->plantSize * 2 : 16;
+        set->plants = realloc(set->plants, set->plantSize * sizeof(PlantReports));
+        if (!set->plants) {
+            perror("Memory reallocation error");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    PlantReports* plant = &set->plants[set->plantCount];
+    plant->plantId = plantId;
+    for (int i = 0; i < set->count; i++) {
+        plant->reports[i].filter = set->reports[i].filter;
+        plant->reports[i].filter.plantId = plantId;
+        plant->reports[i].keptLines = 0;
+        plant->reports[i].plantLines = 0;
+        memset(&plant->reports[i].stats, 0, sizeof(plant->reports[i].stats));
+        initStationMap(&plant->reports[i].stations, set->backend, set->candidates);
+    }
+
+    set->lastPlant = set->plantCount++;
+    return plant;
+}
+
+void mergeReportSet(ReportSet* set, ReportSet* other) {
+/**
+ * @brief Merges the reports of another set into the set, then frees the other set.
+ *
+ * Reports are merged pairwise with mergeStationMap(), so merging partial
+ * sets built from consecutive slices of the input in order gives the same
+ * result as a sequential run.
+ *
+ * @param set The set receiving the reports.
+ * @param other The set to merge, with the same reports; it is freed.
+ */
+
+    for (int i = 0; i < set->count; i++) {
+        set->reports[i].keptLines += other->reports[i].keptLines;
+        set->reports[i].plantLines += other->reports[i].plantLines;
+        set->reports[i].stats.ignoredLines += other->reports[i].stats.ignoredLines;
+        mergeStationMap(&set->reports[i].stations, &other->reports[i].stations);
+    }
+
+    for (int p = 0; p < other->plantCount; p++) {
+        PlantReports* plant = findPlantReports(set, other->plants[p].plantId);
+        for (int i = 0; i < set->count; i++) {
+            plant->reports[i].keptLines += other->plants[p].reports[i].keptLines;
+            plant->reports[i].plantLines += other->plants[p].reports[i].plantLines;
+            plant->reports[i].stats.ignoredLines += other->plants[p].reports[i].stats.ignoredLines;
+            mergeStationMap(&plant->reports[i].stations, &other->plants[p].reports[i].stations);
+        }
+    }
+
+    freeReportSet(other);
+}
+
+void recordMapStats(Report* report, int stationCount) {
+/**
+ * @brief Records the statistics of the station map of a report, before its stations are freed.
+ *
+ * @param report The report.
+ * @param stationCount The number of distinct stations of the report.
+ */
+
+    ReportStats* stats = &report->stats;
+    stats->distinctStations = stationCount;
+    stats->backend = backendName(report->stations.backend);
+    stats->treeHeight = getHeight(&report->stations.tree, report->stations.tree.root);
+    stats->rotations = report->stations.tree.rotations;
+    if (report->stations.backend == BACKEND_BTREE) {
+        stats->treeHeight = bptreeHeight(&report->stations.btree);
+        stats->nodeSplits = report->stations.btree.splits;
+    }
+    stats->droppedStations = report->stations.candidates.dropped;
+    stats->verified = report->stations.candidates.verified;
+}
+
+void freeReportSet(ReportSet* set) {
+/**
+ * @brief Frees the stations of every report of the set.
+ *
+ * @param set The set to free.
+ */
+
+    for (int i = 0; i < set->count; i++) {
+        freeStationMap(&set->reports[i].stations);
+    }
+
+    for (int p = 0; p < set->plantCount; p++) {
+        for (int i = 0; i < set->count; i++) {
+            freeStationMap(&set->plants[p].reports[i].stations);
+        }
+    }
+
+    free(set->plants);
+    set->plants = NULL;
+    set->plantCount = 0;
+    set->plantSize = 0;
+    set->lastPlant = -1;
+}
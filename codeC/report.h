@@ -0,0 +1,49 @@
+#ifndef REPORT_H
+#define REPORT_H
+
+#include "filter.h"
+#include "station.h"
+#include "stats.h"
+
+// Number of station/consumer reports produced by the batch mode
+#define MAX_REPORTS 5
+
+// One station/consumer query and the stations it aggregates
+typedef struct {
+    Filter filter;
+    StationMap stations;
+    int keptLines;
+    int plantLines;
+    ReportStats stats;
+} Report;
+
+// The reports of one plant when per-plant variants are requested
+typedef struct {
+    int plantId;
+    Report reports[MAX_REPORTS];
+} PlantReports;
+
+// Every report fed by one pass over the input
+typedef struct {
+    Report reports[MAX_REPORTS];
+    int count;
+    int perPlant;
+    BackendType backend;
+    int candidates;
+    PlantReports* plants;
+    int plantCount;
+    int plantSize;
+    int lastPlant;
+} ReportSet;
+
+// Report function prototypes
+void initReportSet(ReportSet* set, BackendType backend, int candidates, int perPlant);
+void addReport(ReportSet* set, const Filter* filter);
+void addBatchReports(ReportSet* set);
+void copyReportSet(ReportSet* copy, const ReportSet* set);
+PlantReports* findPlantReports(ReportSet* set, int plantId);
+void mergeReportSet(ReportSet* set, ReportSet* other);
+void recordMapStats(Report* report, int stationCount);
+void freeReportSet(ReportSet* set);
+
+#endif
@@ -0,0 +1,169 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "output.h"
+#include "result.h"
+
+static size_t keyColumnSize(size_t rows) {
+/**
+ * @brief Returns the bytes of the ID column, padded so that the next column is 8-byte aligned.
+ */
+
+    return (rows * sizeof(int32_t) + 7) & ~(size_t)7;
+}
+
+size_t resultSize(size_t rows) {
+/**
+ * @brief Returns the size of a binary result file holding a number of stations.
+ *
+ * @param rows The number of stations.
+ * @return The size of the file in bytes.
+ */
+
+    return sizeof(ResultHeader) + keyColumnSize(rows) + 3 * rows * sizeof(int64_t);
+}
+
+int writeResultFile(const char* path, const StationDiff* stations, int count, const char* stationType,
+                    const char* consumerType, int plantId) {
+/**
+ * @brief Writes the stations of a sorted file as a binary result file.
+ *
+ * The columns are written one after the other through the output buffer;
+ * the file is renamed into place once complete, so a reader mapping it
+ * never sees a partial file.
+ *
+ * @param path The path of the file.
+ * @param stations The stations, in the order of the sorted file.
+ * @param count The number of stations.
+ * @param stationType The station level of the report.
+ * @param consumerType The consumer category of the report.
+ * @param plantId The plant of the report, -1 for every plant.
+ * @return 0 on success, -1 on error (errno is set).
+ */
+
+    ResultHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, RESULT_MAGIC, sizeof(header.magic));
+    header.version = RESULT_VERSION;
+    header.headerSize = sizeof(ResultHeader);
+    header.rows = (uint64_t)count;
+    header.plantId = plantId;
+    strncpy(header.stationType, stationType, sizeof(header.stationType) - 1);
+    strncpy(header.consumerType, consumerType, sizeof(header.consumerType) - 1);
+
+    OutputFile output;
+    if (openOutputReplace(&output, path) != 0) return -1;
+    writeBytes(&output, &header, sizeof(header));
+
+    for (int i = 0; i < count; i++) {
+        int32_t key = stations[i].key;
+        writeBytes(&output, &key, sizeof(key));
+    }
+    static const char padding[8];
+    writeBytes(&output, padding, keyColumnSize((size_t)count) - (size_t)count * sizeof(int32_t));
+
+    for (int column = 0; column < 3; column++) {
+        for (int i = 0; i < count; i++) {
+            int64_t value = column == 0 ? stations[i].capacity
+                          : column == 1 ? stations[i].consumption
+                                        : stations[i].difference;
+            writeBytes(&output, &value, sizeof(value));
+        }
+    }
+
+    return closeOutput(&output);
+}
+
+int mapResultFile(ResultFile* result, const char* path) {
+/**
+ * @brief Maps a binary result file and checks its header against its size.
+ *
+ * @param result Receives the mapped file and its columns.
+ * @param path The path of the file.
+ * @return 0 on success, -1 if the file cannot be read (errno is set) or is not a valid result file (EINVAL).
+ */
+
+    memset(result, 0, sizeof(*result));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        return -1;
+    }
+    if ((size_t)info.st_size < sizeof(ResultHeader)) {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+
+    char* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int error = errno;
+    close(fd);
+    if (data == MAP_FAILED) {
+        errno = error;
+        return -1;
+    }
+
+    ResultHeader header;
+    memcpy(&header, data, sizeof(header));
+    int valid = memcmp(header.magic, RESULT_MAGIC, sizeof(header.magic)) == 0
+        && header.version == RESULT_VERSION
+        && header.headerSize == sizeof(ResultHeader)
+        && header.rows <= (uint64_t)info.st_size
+        && resultSize(header.rows) == (size_t)info.st_size;
+    if (!valid) {
+        munmap(data, (size_t)info.st_size);
+        errno = EINVAL;
+        return -1;
+    }
+
+    // The type names are kept terminated whatever the file holds
+    header.stationType[sizeof(header.stationType) - 1] = '\0';
+    header.consumerType[sizeof(header.consumerType) - 1] = '\0';
+
+    result->header = header;
+    result->rows = header.rows;
+    result->data = data;
+    result->size = (size_t)info.st_size;
+    result->key = (const int32_t*)(data + sizeof(ResultHeader));
+    result->capacity = (const int64_t*)(data + sizeof(ResultHeader) + keyColumnSize(result->rows));
+    result->consumption = result->capacity + result->rows;
+    result->difference = result->consumption + result->rows;
+    return 0;
+}
+
+void resultStation(const ResultFile* result, size_t row, StationDiff* station) {
+/**
+ * @brief Reads one station of a mapped result file.
+ *
+ * @param result The mapped file.
+ * @param row The position of the station, below result->rows.
+ * @param station Receives the station.
+ */
+
+    station->key = result->key[row];
+    station->capacity = result->capacity[row];
+    station->consumption = result->consumption[row];
+    station->difference = result->difference[row];
+}
+
+void unmapResultFile(ResultFile* result) {
+/**
+ * @brief Unmaps a result file and leaves it empty.
+ *
+ * @param result The mapped file.
+ */
+
+    if (result->data) munmap(result->data, result->size);
+    memset(result, 0, sizeof(*result));
+}
@@ -0,0 +1,49 @@
+#ifndef RESULT_H
+#define RESULT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "station.h"
+
+// Identifies a binary result file and the version of its layout
+#define RESULT_MAGIC "CWRESULT"
+#define RESULT_VERSION 1
+
+// Suffix of the binary result file written next to a sorted CSV file
+#define RESULT_SUFFIX ".cwr"
+
+// Header of a binary result file, in the byte order of the machine that wrote it
+// The columns follow it, one value per station in the order of the sorted file: the 32-bit IDs, padded to
+// 8 bytes, then the 64-bit capacities, consumptions and differences, so every column is aligned when mapped
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t rows;
+    int32_t plantId;
+    uint32_t reserved;
+    char stationType[8];
+    char consumerType[8];
+} ResultHeader;
+
+// A binary result file mapped in memory and its columns
+typedef struct {
+    ResultHeader header;
+    size_t rows;
+    const int32_t* key;
+    const int64_t* capacity;
+    const int64_t* consumption;
+    const int64_t* difference;
+    char* data;
+    size_t size;
+} ResultFile;
+
+// Binary result function prototypes
+size_t resultSize(size_t rows);
+int writeResultFile(const char* path, const StationDiff* stations, int count, const char* stationType,
+                    const char* consumerType, int plantId);
+int mapResultFile(ResultFile* result, const char* path);
+void resultStation(const ResultFile* result, size_t row, StationDiff* station);
+void unmapResultFile(ResultFile* result);
+
+#endif
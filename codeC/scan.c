@@ -0,0 +1,318 @@
+#include <string.h>
+#include "scan.h"
+#include "input.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCAN_X86 1
+#endif
+
+static const char* scanRecordScalar(Scanner* scanner, Record* record);
+
+// Record scanner of the selected kernel; the scalar one until selectScanKernel() is called
+static const char* (*scanRecordKernel)(Scanner* scanner, Record* record) = scanRecordScalar;
+static ScanKernel selectedKernel = SCAN_SCALAR;
+
+static const char* const kernelNames[] = {"auto", "scalar", "sse4", "avx2", "avx512"};
+
+int parseScanKernel(const char* name, ScanKernel* kernel) {
+/**
+ * @brief Parses the name of a scanning kernel given on the command line.
+ *
+ * @param name The kernel name: auto, scalar, sse4, avx2 or avx512.
+ * @param kernel Receives the kernel.
+ * @return 0 on success, -1 if the name is unknown.
+ */
+
+    for (int i = 0; i <= SCAN_AVX512; i++) {
+        if (strcmp(name, kernelNames[i]) == 0) {
+            *kernel = (ScanKernel)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char* scanKernelName(void) {
+/**
+ * @brief Returns the name of the kernel used by scanRecord().
+ */
+
+    return kernelNames[selectedKernel];
+}
+
+void initScanner(Scanner* scanner, const char* begin, const char* end) {
+/**
+ * @brief Positions a scanner on the first line of a block; no window is loaded yet.
+ *
+ * @param scanner The scanner to initialize.
+ * @param begin The first byte of the block.
+ * @param end The byte past the end of the block.
+ */
+
+    scanner->next = begin;
+    scanner->end = end;
+    scanner->base = begin;
+    scanner->limit = begin;
+    scanner->delimiters = 0;
+}
+
+const char* scanRecord(Scanner* scanner, Record* record) {
+/**
+ * @brief Parses the next line of a block, exactly as parseRecord() does.
+ *
+ * @param scanner The scanner, positioned on the line to parse.
+ * @param record The record receiving the parsed columns.
+ * @return The first byte of the next line.
+ */
+
+    return scanRecordKernel(scanner, record);
+}
+
+static const char* scanRecordScalar(Scanner* scanner, Record* record) {
+/**
+ * @brief Scalar kernel: parseRecord() itself, byte by byte, without delimiter windows.
+ */
+
+    scanner->next = parseRecord(scanner->next, scanner->end, record);
+    return scanner->next;
+}
+
+#ifdef SCAN_X86
+
+// Shuffle controls moving the first n bytes of a vector to its end, with zeros in front
+static unsigned char alignDigits[SCAN_MAX_DIGITS + 1][16];
+
+static uint64_t tailDelimiters(const char* base, const char* end) {
+/**
+ * @brief Returns the ';' and '\n' bits of a window shorter than SCAN_WINDOW at the end of a block.
+ */
+
+    uint64_t mask = 0;
+    for (const char* p = base; p < end; p++) {
+        if (*p == ';' || *p == '\n') mask |= (uint64_t)1 << (p - base);
+    }
+    return mask;
+}
+
+static inline __attribute__((always_inline)) const char* nextDelimiter(Scanner* scanner,
+                                                                      uint64_t (*window)(const char*)) {
+/**
+ * @brief Consumes the next ';' or '\n' of the block, loading the following window when the current one is used up.
+ *
+ * @param scanner The scanner.
+ * @param window The kernel returning the delimiter bits of SCAN_WINDOW bytes.
+ * @return The delimiter, or the end of the block if there is none left.
+ */
+
+    while (!scanner->delimiters) {
+        if (scanner->limit >= scanner->end) return scanner->end;
+        scanner->base = scanner->limit;
+        if (scanner->end - scanner->base >= SCAN_WINDOW) {
+            scanner->delimiters = window(scanner->base);
+            scanner->limit = scanner->base + SCAN_WINDOW;
+        } else {
+            scanner->delimiters = tailDelimiters(scanner->base, scanner->end);
+            scanner->limit = scanner->end;
+        }
+    }
+
+    const char* delimiter = scanner->base + __builtin_ctzll(scanner->delimiters);
+    scanner->delimiters &= scanner->delimiters - 1;
+    return delimiter;
+}
+
+static inline __attribute__((always_inline)) const char* scanLine(Scanner* scanner, Record* record,
+                                                                 uint64_t (*window)(const char*),
+                                                                 int (*digits)(const char*, size_t, long*)) {
+/**
+ * @brief Parses the next line from the delimiter bits of the windows; shared by the vector kernels.
+ *
+ * Columns made of 1 to SCAN_MAX_DIGITS digits only are converted by the
+ * digits kernel; any other column (dash, empty, text, carriage return,
+ * longer numbers) goes through parseColumn(), so the result is always the
+ * one of parseRecord().
+ *
+ * @param scanner The scanner, positioned on the line to parse.
+ * @param record The record receiving the parsed columns.
+ * @param window The kernel returning the delimiter bits of SCAN_WINDOW bytes.
+ * @param digits The kernel converting a column of digits, reading 16 bytes from its start.
+ * @return The first byte of the next line.
+ */
+
+    const char* start = scanner->next;
+    const char* stop;
+    int column = 0;
+    record->dash = 0;
+    record->empty = 0;
+    record->text = 0;
+
+    for (;;) {
+        stop = nextDelimiter(scanner, window);
+        size_t length = (size_t)(stop - start);
+        if (length == 1 && *start == '-') {
+            // Most columns of a line are absent
+            record->dash |= COLUMN_BIT(column);
+            record->value[column] = 0;
+        } else if (length == 0 || length > SCAN_MAX_DIGITS || scanner->end - start < 16 ||
+                   !digits(start, length, &record->value[column])) {
+            parseColumn(record, column, start, stop);
+        }
+        column++;
+
+        if (stop >= scanner->end || *stop == '\n') break;
+        if (column == COLUMN_COUNT) {
+            // Skip anything past the eighth column up to the end of the line
+            do {
+                stop = nextDelimiter(scanner, window);
+            } while (stop < scanner->end && *stop != '\n');
+            break;
+        }
+        start = stop + 1;
+    }
+
+    // Columns beyond the end of the line are missing
+    for (int i = column; i < COLUMN_COUNT; i++) {
+        record->value[i] = 0;
+        record->empty |= COLUMN_BIT(i);
+    }
+
+    scanner->next = stop < scanner->end ? stop + 1 : scanner->end;
+    return scanner->next;
+}
+
+__attribute__((target("sse4.1"))) static inline int digitsSse4(const char* start, size_t length, long* value) {
+/**
+ * @brief Converts a column of 1 to SCAN_MAX_DIGITS bytes if they are all digits, 16 digits at a time.
+ *
+ * The digits are right-aligned in a vector, then combined by multiply-adds:
+ * pairs (x10), groups of four (x100), groups of eight (x10000), and the two
+ * halves are joined in a 64-bit integer.
+ *
+ * @param start The first byte of the column; 16 bytes must be readable from it.
+ * @param length The length of the column.
+ * @param value Receives the number.
+ * @return 1 if the column was converted, 0 if it holds another byte than a digit.
+ */
+
+    __m128i bytes = _mm_sub_epi8(_mm_loadu_si128((const __m128i*)start), _mm_set1_epi8('0'));
+    __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(bytes, _mm_set1_epi8(9)), bytes);
+    unsigned needed = (1u << length) - 1;
+    if (((unsigned)_mm_movemask_epi8(isDigit) & needed) != needed) return 0;
+
+    __m128i digits = _mm_shuffle_epi8(bytes, _mm_loadu_si128((const __m128i*)alignDigits[length]));
+    __m128i pairs = _mm_maddubs_epi16(digits, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1));
+    __m128i quads = _mm_madd_epi16(pairs, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+    __m128i packed = _mm_packus_epi32(quads, quads);
+    __m128i octets = _mm_madd_epi16(packed, _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+
+    uint64_t high = (uint32_t)_mm_cvtsi128_si32(octets);
+    uint64_t low = (uint32_t)_mm_extract_epi32(octets, 1);
+    *value = (long)(high * 100000000 + low);
+    return 1;
+}
+
+__attribute__((target("sse4.1"))) static inline uint64_t windowSse4(const char* base) {
+/**
+ * @brief Returns the ';' and '\n' bits of SCAN_WINDOW bytes, 16 bytes at a time.
+ */
+
+    uint64_t mask = 0;
+    for (int i = 0; i < SCAN_WINDOW; i += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(base + i));
+        __m128i found = _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(';')), _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n')));
+        mask |= (uint64_t)(unsigned)_mm_movemask_epi8(found) << i;
+    }
+    return mask;
+}
+
+__attribute__((target("avx2"))) static inline uint64_t windowAvx2(const char* base) {
+/**
+ * @brief Returns the ';' and '\n' bits of SCAN_WINDOW bytes, 32 bytes at a time.
+ */
+
+    __m256i low = _mm256_loadu_si256((const __m256i*)base);
+    __m256i high = _mm256_loadu_si256((const __m256i*)(base + 32));
+    __m256i semicolon = _mm256_set1_epi8(';');
+    __m256i newline = _mm256_set1_epi8('\n');
+    uint32_t lowMask = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(low, semicolon),
+                                                                      _mm256_cmpeq_epi8(low, newline)));
+    uint32_t highMask = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(high, semicolon),
+                                                                       _mm256_cmpeq_epi8(high, newline)));
+    return (uint64_t)highMask << 32 | lowMask;
+}
+
+__attribute__((target("avx512bw"))) static inline uint64_t windowAvx512(const char* base) {
+/**
+ * @brief Returns the ';' and '\n' bits of SCAN_WINDOW bytes in one 64-byte comparison.
+ */
+
+    __m512i bytes = _mm512_loadu_si512((const void*)base);
+    return _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8(';')) | _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8('\n'));
+}
+
+__attribute__((target("sse4.1"))) static const char* scanRecordSse4(Scanner* scanner, Record* record) {
+/**
+ * @brief SSE4.1 kernel: 16-byte delimiter comparisons and vector digit conversion.
+ */
+
+    return scanLine(scanner, record, windowSse4, digitsSse4);
+}
+
+__attribute__((target("avx2"))) static const char* scanRecordAvx2(Scanner* scanner, Record* record) {
+/**
+ * @brief AVX2 kernel: 32-byte delimiter comparisons and vector digit conversion.
+ */
+
+    return scanLine(scanner, record, windowAvx2, digitsSse4);
+}
+
+__attribute__((target("avx512bw"))) static const char* scanRecordAvx512(Scanner* scanner, Record* record) {
+/**
+ * @brief AVX-512 kernel: 64-byte delimiter comparisons and vector digit conversion.
+ */
+
+    return scanLine(scanner, record, windowAvx512, digitsSse4);
+}
+
+#endif
+
+int selectScanKernel(ScanKernel kernel) {
+/**
+ * @brief Selects the kernel used by scanRecord(), checking what the processor supports.
+ *
+ * Called once at startup, before any thread scans. SCAN_AUTO picks AVX2,
+ * then SSE4.1, and falls back to the scalar kernel elsewhere.
+ *
+ * @param kernel The kernel to use, or SCAN_AUTO.
+ * @return 0 on success, -1 if the processor does not support the kernel.
+ */
+
+#ifdef SCAN_X86
+    for (int length = 0; length <= SCAN_MAX_DIGITS; length++) {
+        for (int i = 0; i < 16; i++) {
+            alignDigits[length][i] = i < 16 - length ? 0x80 : (unsigned char)(i - (16 - length));
+        }
+    }
+
+    __builtin_cpu_init();
+    int supported[] = {1, 1, __builtin_cpu_supports("sse4.1"), __builtin_cpu_supports("avx2"),
+                       __builtin_cpu_supports("avx512bw")};
+    const char* (*const kernels[])(Scanner*, Record*) = {NULL, scanRecordScalar, scanRecordSse4, scanRecordAvx2,
+                                                         scanRecordAvx512};
+
+    // AVX-512 is only used on request: the delimiter search is a small part of a line, and it was not faster
+    if (kernel == SCAN_AUTO) {
+        kernel = SCAN_AVX2;
+        while (!supported[kernel]) kernel--;
+    }
+    if (!supported[kernel]) return -1;
+    scanRecordKernel = kernels[kernel];
+#else
+    if (kernel == SCAN_AUTO) kernel = SCAN_SCALAR;
+    if (kernel != SCAN_SCALAR) return -1;
+#endif
+
+    selectedKernel = kernel;
+    return 0;
+}
@@ -0,0 +1,32 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <stdint.h>
+#include "filter.h"
+
+// Bytes whose delimiters are located by one call of a scanning kernel
+#define SCAN_WINDOW 64
+
+// Longest digit field converted by the vector kernels
+#define SCAN_MAX_DIGITS 16
+
+// Line scanning kernels; SCAN_AUTO picks AVX2 or SSE4.1 when the processor supports them
+typedef enum { SCAN_AUTO, SCAN_SCALAR, SCAN_SSE4, SCAN_AVX2, SCAN_AVX512 } ScanKernel;
+
+// Position in a block of lines, with the ';' and '\n' bits of the current window not consumed yet
+typedef struct {
+    const char* next;
+    const char* end;
+    const char* base;
+    const char* limit;
+    uint64_t delimiters;
+} Scanner;
+
+// Scanner function prototypes
+int parseScanKernel(const char* name, ScanKernel* kernel);
+int selectScanKernel(ScanKernel kernel);
+const char* scanKernelName(void);
+void initScanner(Scanner* scanner, const char* begin, const char* end);
+const char* scanRecord(Scanner* scanner, Record* record);
+
+#endif
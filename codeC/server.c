@@ -0,0 +1,403 @@
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "server.h"
+#include "output.h"
+#include "sort.h"
+
+// Kinds of answers, named like the files of a normal run
+typedef enum { ANSWER_SORTED, ANSWER_TOP, ANSWER_BOTTOM, ANSWER_MINMAX } AnswerType;
+
+// One parsed query line
+typedef struct {
+    AnswerType type;
+    int limit;
+    int plantId;
+    int report;
+} Query;
+
+static volatile sig_atomic_t serverStopped = 0;
+
+static void stopServing(int signalNumber) {
+/**
+ * @brief Signal handler ending the server after the current query.
+ */
+
+    (void)signalNumber;
+    serverStopped = 1;
+}
+
+static void catchStopSignals(void) {
+/**
+ * @brief Stops the server on SIGINT or SIGTERM, and turns a reader gone away into a write error.
+ *
+ * The handlers are installed without SA_RESTART, so a blocking accept() or
+ * read returns as soon as the server is asked to stop.
+ */
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stopServing;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+}
+
+static int comparePlants(const void* a, const void* b) {
+/**
+ * @brief qsort adapter ordering plants by ID.
+ */
+
+    int plantA = ((const PlantIndex*)a)->plantId;
+    int plantB = ((const PlantIndex*)b)->plantId;
+    return (plantA > plantB) - (plantA < plantB);
+}
+
+void initServer(Server* server, ReportSet* reports) {
+/**
+ * @brief Indexes the reports of a batch per-plant run by plant to answer queries.
+ *
+ * @param server The server to initialize.
+ * @param reports The aggregated reports; their stations are freed as they are prepared for queries.
+ */
+
+    server->reports = reports;
+    server->queries = 0;
+    server->plants = malloc((size_t)(reports->plantCount > 0 ? reports->plantCount : 1) * sizeof(PlantIndex));
+    server->served = calloc((size_t)(reports->plantCount + 1) * MAX_REPORTS, sizeof(ServedReport));
+    if (!server->plants || !server->served) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int p = 0; p < reports->plantCount; p++) {
+        server->plants[p].plantId = reports->plants[p].plantId;
+        server->plants[p].index = p;
+    }
+    qsort(server->plants, reports->plantCount, sizeof(PlantIndex), comparePlants);
+}
+
+static int parseQuery(const ReportSet* reports, char* line, Query* query, char* error, size_t errorSize) {
+/**
+ * @brief Parses a query line such as "sorted hva comp" or "lv all plant 3 top 10".
+ *
+ * The words may come in any order: a station type and a consumer type,
+ * optionally "plant <id>", and optionally the answer wanted: "sorted" (the
+ * default), "top [n]", "bottom [n]" or "minmax".
+ *
+ * @param reports The reports of the server.
+ * @param line The query; split in place.
+ * @param query Receives the parsed query.
+ * @param error Receives the reason of a rejected query.
+ * @param errorSize The size of error.
+ * @return 0 on success, -1 if the query is rejected.
+ */
+
+    const char* station = NULL;
+    const char* consumer = NULL;
+    query->type = ANSWER_SORTED;
+    query->limit = 0;
+    query->plantId = -1;
+
+    char* words[SERVER_MAX_QUERY / 2 + 1];
+    int count = 0;
+    char* save;
+    for (char* word = strtok_r(line, " \t\r\n", &save); word; word = strtok_r(NULL, " \t\r\n", &save)) {
+        words[count++] = word;
+    }
+
+    for (int i = 0; i < count; i++) {
+        char* end;
+        if (strcmp(words[i], "sorted") == 0) {
+            query->type = ANSWER_SORTED;
+        } else if (strcmp(words[i], "minmax") == 0) {
+            query->type = ANSWER_MINMAX;
+        } else if (strcmp(words[i], "top") == 0 || strcmp(words[i], "bottom") == 0) {
+            query->type = words[i][0] == 't' ? ANSWER_TOP : ANSWER_BOTTOM;
+            // The number of rows is optional
+            long limit = i + 1 < count ? strtol(words[i + 1], &end, 10) : 0;
+            if (limit > 0 && *end == '\0') {
+                query->limit = limit < 1000000000 ? (int)limit : 1000000000;
+                i++;
+            }
+        } else if (strcmp(words[i], "plant") == 0) {
+            long plantId = i + 1 < count ? strtol(words[i + 1], &end, 10) : 0;
+            if (i + 1 >= count || *end != '\0') {
+                snprintf(error, errorSize, "plant needs a plant ID");
+                return -1;
+            }
+            query->plantId = (int)plantId;
+            i++;
+        } else if (!station) {
+            station = words[i];
+        } else if (!consumer) {
+            consumer = words[i];
+        } else {
+            snprintf(error, errorSize, "unexpected word: %s", words[i]);
+            return -1;
+        }
+    }
+
+    Filter filter;
+    if (!station || !consumer || initFilter(&filter, station, consumer, "-1") != 0) {
+        snprintf(error, errorSize, "expected a station type (hvb, hva, lv) and a consumer type (comp, indiv, all)");
+        return -1;
+    }
+
+    for (int i = 0; i < reports->count; i++) {
+        if (reports->reports[i].filter.station == filter.station && reports->reports[i].filter.consumer == filter.consumer) {
+            query->report = i;
+            return 0;
+        }
+    }
+    snprintf(error, errorSize, "%s %s is not a valid query", station, consumer);
+    return -1;
+}
+
+static ServedReport* findServedReport(Server* server, const Query* query, char* error, size_t errorSize) {
+/**
+ * @brief Returns the stations of the report asked by a query, sorted by capacity.
+ *
+ * The first query on a report collects and sorts its stations once, then
+ * frees its aggregate; later queries reuse the sorted stations.
+ *
+ * @param server The server.
+ * @param query The parsed query.
+ * @param error Receives the reason if the report has no data.
+ * @param errorSize The size of error.
+ * @return The prepared report, or NULL if the plant or the data does not exist.
+ */
+
+    ReportSet* reports = server->reports;
+    Report* report = &reports->reports[query->report];
+    int slot = query->report;
+
+    if (query->plantId != -1) {
+        PlantIndex key = {query->plantId, 0};
+        PlantIndex* found = bsearch(&key, server->plants, reports->plantCount, sizeof(PlantIndex), comparePlants);
+        if (!found) {
+            snprintf(error, errorSize, "the plant ID %d does not exist in the file", query->plantId);
+            return NULL;
+        }
+        report = &reports->plants[found->index].reports[query->report];
+        slot = (found->index + 1) * MAX_REPORTS + query->report;
+    }
+
+    if (report->keptLines == 0) {
+        snprintf(error, errorSize, "no data found for the specified parameters");
+        return NULL;
+    }
+
+    ServedReport* served = &server->served[slot];
+    if (!served->ready) {
+        served->count = collectStations(&report->stations, &served->stations);
+        sortByCapacity(served->stations, served->count);
+        recordMapStats(report, served->count);
+        freeStationMap(&report->stations);
+        served->ready = 1;
+    }
+    return served;
+}
+
+static void answerQuery(Server* server, char* line, OutputFile* output) {
+/**
+ * @brief Answers one query: "OK <rows>" followed by the rows of the matching
+ *        output file, or "ERROR <reason>".
+ *
+ * @param server The server.
+ * @param line The query line; modified.
+ * @param output Receives the answer.
+ */
+
+    const ReportSet* reports = server->reports;
+    char error[SERVER_MAX_QUERY + 64];
+    Query query;
+    ServedReport* served = NULL;
+
+    if (strlen(line) > SERVER_MAX_QUERY) {
+        snprintf(error, sizeof(error), "query longer than %d bytes", SERVER_MAX_QUERY);
+    } else if (parseQuery(reports, line, &query, error, sizeof(error)) == 0) {
+        served = findServedReport(server, &query, error, sizeof(error));
+    }
+    server->queries++;
+
+    if (!served) {
+        writeText(output, "ERROR ");
+        writeText(output, error);
+        writeText(output, "\n");
+        return;
+    }
+
+    if (query.type == ANSWER_SORTED) {
+        writeText(output, "OK ");
+        writeInteger(output, served->count + 1);
+        writeText(output, "\n");
+        writeSortedHeader(output, stationName(reports->reports[query.report].filter.station));
+        writeSortedFile(served->stations, served->count, output);
+        return;
+    }
+
+    // Without a count, as many rows as the top/bottom 10 files of the report
+    int limit = rankingLimit(served->count);
+    if (query.type != ANSWER_MINMAX && query.limit > 0) limit = query.limit < served->count ? query.limit : served->count;
+
+    StationDiff* extremes = malloc((size_t)(limit > 0 ? 2 * limit : 1) * sizeof(StationDiff));
+    if (!extremes) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    int selected = selectExtremes(served->stations, served->count, limit, extremes, extremes + limit);
+
+    writeText(output, "OK ");
+    if (query.type == ANSWER_MINMAX) {
+        memmove(extremes + selected, extremes + limit, selected * sizeof(StationDiff));
+        writeInteger(output, 2 * selected);
+        writeText(output, "\n");
+        writeMinMaxFile(extremes, 2 * selected, output);
+    } else {
+        const StationDiff* rows = query.type == ANSWER_TOP ? extremes : extremes + limit;
+        writeInteger(output, selected);
+        writeText(output, "\n");
+        for (int i = 0; i < selected; i++) {
+            writeStation(output, &rows[i], 1);
+        }
+    }
+    free(extremes);
+}
+
+int serveStream(Server* server, int input, int output) {
+/**
+ * @brief Answers the queries read line by line from a descriptor until end of file,
+ *        "quit", or "shutdown", which also stops the server.
+ *
+ * Each answer is written out as soon as it is complete, so a client can
+ * send a query and wait for its answer. Blank lines are ignored.
+ *
+ * @param server The server.
+ * @param input The descriptor the queries are read from; closed on return.
+ * @param output The descriptor the answers are written to; closed on return.
+ * @return 0 when the client is done, -1 if an answer cannot be written (errno is set).
+ */
+
+    catchStopSignals();
+
+    FILE* queries = fdopen(input, "r");
+    if (!queries) {
+        close(input);
+        close(output);
+        return -1;
+    }
+
+    OutputFile answers;
+    attachOutput(&answers, output);
+
+    char* line = NULL;
+    size_t size = 0;
+    int status = 0;
+    while (!serverStopped && getline(&line, &size, queries) >= 0) {
+        char command[16];
+        if (sscanf(line, "%15s", command) != 1) continue;
+        if (strcmp(command, "quit") == 0) break;
+        if (strcmp(command, "shutdown") == 0) {
+            serverStopped = 1;
+            break;
+        }
+
+        answerQuery(server, line, &answers);
+        if (pushOutput(&answers) != 0) {
+            status = -1;
+            break;
+        }
+    }
+
+    int error = errno;
+    free(line);
+    fclose(queries);
+    if (closeOutput(&answers) != 0 && status == 0) {
+        status = -1;
+        error = errno;
+    }
+    errno = error;
+    return status;
+}
+
+int serveSocket(Server* server, const char* path) {
+/**
+ * @brief Answers queries on a Unix domain socket until SIGINT, SIGTERM or a "shutdown" query.
+ *
+ * Clients are served one at a time, each with serveStream(). A stale
+ * socket left at path by a previous server is replaced; any other file
+ * there is an error. The socket is removed when the server stops.
+ *
+ * @param server The server.
+ * @param path The path of the socket.
+ * @return 0 when the server is stopped, -1 if the socket cannot be created (errno is set).
+ */
+
+    struct sockaddr_un address;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    struct stat info;
+    if (lstat(path, &info) == 0 && S_ISSOCK(info.st_mode)) unlink(path);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) return -1;
+    if (bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(listener, SERVER_BACKLOG) != 0) {
+        int error = errno;
+        close(listener);
+        errno = error;
+        return -1;
+    }
+
+    catchStopSignals();
+    fprintf(stderr, "Serving queries on %s\n", path);
+
+    while (!serverStopped) {
+        int client = accept(listener, NULL, NULL);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            perror("Error accepting a connection");
+            break;
+        }
+
+        int answers = dup(client);
+        if (answers < 0) {
+            close(client);
+            continue;
+        }
+        // A client that leaves early only ends its own connection
+        serveStream(server, client, answers);
+    }
+
+    close(listener);
+    unlink(path);
+    return 0;
+}
+
+void freeServer(Server* server) {
+/**
+ * @brief Frees the sorted stations and the plant index of the server.
+ *
+ * @param server The server.
+ */
+
+    int slots = (server->reports->plantCount + 1) * MAX_REPORTS;
+    for (int i = 0; i < slots; i++) {
+        free(server->served[i].stations);
+    }
+    free(server->served);
+    free(server->plants);
+}
@@ -0,0 +1,39 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "report.h"
+
+// Pending connections of the query socket
+#define SERVER_BACKLOG 16
+
+// Longest query line accepted, in bytes
+#define SERVER_MAX_QUERY 256
+
+// The stations of one report sorted by capacity, prepared on the first query that needs them
+typedef struct {
+    StationDiff* stations;
+    int count;
+    int ready;
+} ServedReport;
+
+// Position of a plant in the report set, for a binary search by plant ID
+typedef struct {
+    int plantId;
+    int index;
+} PlantIndex;
+
+// Every report of a batch per-plant run, kept in memory to answer queries
+typedef struct {
+    ReportSet* reports;
+    PlantIndex* plants;
+    ServedReport* served;
+    long queries;
+} Server;
+
+// Server function prototypes
+void initServer(Server* server, ReportSet* reports);
+int serveStream(Server* server, int input, int output);
+int serveSocket(Server* server, const char* path);
+void freeServer(Server* server);
+
+#endif
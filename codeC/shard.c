@@ -0,0 +1,108 @@
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "cache.h"
+#include "shard.h"
+#include "snapshot.h"
+
+static void addShard(ShardList* list, const char* directory, const char* name) {
+/**
+ * @brief Appends a path to the list, joined to its directory if one is given.
+ */
+
+    if (list->count == list->size) {
+        list->size = list->size ? list->size * 2 : 16;
+        list->paths = realloc(list->paths, (size_t)list->size * sizeof(char*));
+        if (!list->paths) {
+            perror("Memory reallocation error");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    char* path;
+    if (directory ? asprintf(&path, "%s/%s", directory, name) < 0 : !(path = strdup(name))) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    list->paths[list->count++] = path;
+}
+
+static int hasSuffix(const char* name, const char* suffix) {
+/**
+ * @brief Tells whether a file name ends with a suffix.
+ */
+
+    size_t length = strlen(name);
+    size_t suffixLength = strlen(suffix);
+    return length >= suffixLength && strcmp(name + length - suffixLength, suffix) == 0;
+}
+
+static int isShardFile(const struct dirent* entry) {
+/**
+ * @brief scandir filter keeping the data files of a directory.
+ *
+ * Hidden files, and the column caches and snapshots this program writes
+ * next to its inputs, are not shards.
+ */
+
+    return entry->d_name[0] != '.' && !hasSuffix(entry->d_name, CACHE_SUFFIX) &&
+           !hasSuffix(entry->d_name, SNAPSHOT_SUFFIX);
+}
+
+int listShards(ShardList* list, char* const* paths, int count) {
+/**
+ * @brief Lists the input files of a run from the paths given on the command line.
+ *
+ * Files are kept in the order given. A directory is replaced by the regular
+ * files it holds, sorted by name, without descending into subdirectories.
+ * Reading the list in order gives the same aggregates as reading the
+ * concatenation of the files.
+ *
+ * @param list Receives the files; freed with freeShardList(), also on error.
+ * @param paths The paths given on the command line ("-" for the standard input).
+ * @param count The number of paths.
+ * @return 0 on success, -1 if a directory cannot be read (errno is set).
+ */
+
+    memset(list, 0, sizeof(*list));
+
+    for (int i = 0; i < count; i++) {
+        struct stat info;
+        if (strcmp(paths[i], "-") == 0 || stat(paths[i], &info) != 0 || !S_ISDIR(info.st_mode)) {
+            addShard(list, NULL, paths[i]);
+            continue;
+        }
+
+        struct dirent** entries;
+        int entryCount = scandir(paths[i], &entries, isShardFile, alphasort);
+        if (entryCount < 0) return -1;
+
+        for (int e = 0; e < entryCount; e++) {
+            char path[4096];
+            snprintf(path, sizeof(path), "%s/%s", paths[i], entries[e]->d_name);
+            if (stat(path, &info) == 0 && S_ISREG(info.st_mode)) addShard(list, paths[i], entries[e]->d_name);
+            free(entries[e]);
+        }
+        free(entries);
+    }
+
+    return 0;
+}
+
+void freeShardList(ShardList* list) {
+/**
+ * @brief Frees the paths of a list and leaves it empty.
+ *
+ * @param list The list to free.
+ */
+
+    for (int i = 0; i < list->count; i++) {
+        free(list->paths[i]);
+    }
+    free(list->paths);
+    memset(list, 0, sizeof(*list));
+}
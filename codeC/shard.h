@@ -0,0 +1,15 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+// Input files of a run, in the order they are read: the paths given, each directory replaced by its files
+typedef struct {
+    char** paths;
+    int count;
+    int size;
+} ShardList;
+
+// Shard function prototypes
+int listShards(ShardList* list, char* const* paths, int count);
+void freeShardList(ShardList* list);
+
+#endif
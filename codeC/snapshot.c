@@ -0,0 +1,290 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "cache.h"
+#include "snapshot.h"
+
+static uint64_t fingerprintPrefix(const InputFile* input, size_t offset) {
+/**
+ * @brief Hashes the first and last CACHE_FINGERPRINT_SIZE bytes of the first offset bytes of the input.
+ *
+ * @param input The mapped input.
+ * @param offset The size of the prefix.
+ * @return The fingerprint of the prefix.
+ */
+
+    size_t edge = offset < CACHE_FINGERPRINT_SIZE ? offset : CACHE_FINGERPRINT_SIZE;
+    uint64_t fingerprint = hashBytes(0xcbf29ce484222325ULL, input->data, edge);
+    return hashBytes(fingerprint, input->data + offset - edge, edge);
+}
+
+void snapshotPath(char* path, size_t size, const char* inputPath, const ReportSet* set) {
+/**
+ * @brief Builds the path of the snapshot of a query: the input path, the query and SNAPSHOT_SUFFIX.
+ *
+ * Each query has its own snapshot, e.g. "data.dat.lv_all_3.snap" or "data.dat.batch.snap".
+ *
+ * @param path Receives the path.
+ * @param size The size of path.
+ * @param inputPath The path of the input.
+ * @param set The reports of the query.
+ */
+
+    const Filter* filter = &set->reports[0].filter;
+
+    if (set->count > 1) {
+        snprintf(path, size, "%s.batch%s%s", inputPath, set->perPlant ? "_plants" : "", SNAPSHOT_SUFFIX);
+    } else if (filter->plantId != -1) {
+        snprintf(path, size, "%s.%s_%s_%d%s", inputPath, stationName(filter->station), consumerName(filter->consumer),
+                 filter->plantId, SNAPSHOT_SUFFIX);
+    } else {
+        snprintf(path, size, "%s.%s_%s%s", inputPath, stationName(filter->station), consumerName(filter->consumer),
+                 SNAPSHOT_SUFFIX);
+    }
+}
+
+static int checkReports(const ReportSet* set, const SnapshotHeader* header, const char* data, size_t size) {
+/**
+ * @brief Checks that the body of a snapshot is complete and holds the reports of the set.
+ *
+ * @param set The reports of the current query.
+ * @param header The header of the snapshot.
+ * @param data The body of the snapshot, after the header.
+ * @param size The size of the body.
+ * @return 0 if the body can be loaded into the set, -1 otherwise.
+ */
+
+    if (header->reportCount != (uint32_t)set->count || header->perPlant != (uint32_t)set->perPlant) return -1;
+
+    size_t position = 0;
+    uint64_t blocks = (header->plantCount + 1) * header->reportCount;
+
+    for (uint64_t b = 0; b < blocks; b++) {
+        SnapshotReport report;
+        if (size - position < sizeof(report)) return -1;
+        memcpy(&report, data + position, sizeof(report));
+        position += sizeof(report);
+
+        const Filter* filter = &set->reports[b % header->reportCount].filter;
+        if (report.station != (int32_t)filter->station || report.consumer != (int32_t)filter->consumer) return -1;
+        if (b < header->reportCount && report.plantId != filter->plantId) return -1;
+
+        if (report.stationCount > (size - position) / sizeof(SnapshotStation)) return -1;
+        position += report.stationCount * sizeof(SnapshotStation);
+    }
+
+    return position == size ? 0 : -1;
+}
+
+static void restoreReport(Report* report, const SnapshotReport* saved, const SnapshotStation* stations) {
+/**
+ * @brief Adds the counters and stations of a saved report to an empty report.
+ *
+ * @param report The report to restore.
+ * @param saved The saved counters.
+ * @param stations The saved stations, in key order.
+ */
+
+    report->keptLines = saved->keptLines;
+    report->plantLines = saved->plantLines;
+    report->stats.ignoredLines = saved->ignoredLines;
+
+    for (uint64_t i = 0; i < saved->stationCount; i++) {
+        SnapshotStation station;
+        memcpy(&station, &stations[i], sizeof(station));
+        addStation(&report->stations, station.key, station.capacity, station.consumption);
+    }
+}
+
+int loadSnapshot(ReportSet* set, const char* path, const InputFile* input, size_t* offset, int* lines) {
+/**
+ * @brief Restores the reports of a query from its snapshot if the input still starts with the saved prefix.
+ *
+ * The snapshot is rejected if its layout is unknown, if it was written for
+ * other reports, if the input is now shorter than the part it covers, or if
+ * the fingerprint of that part changed (the input was rewritten rather than
+ * appended to). Only the lines after the returned offset remain to be read.
+ *
+ * @param set The empty reports of the query.
+ * @param path The path of the snapshot file.
+ * @param input The mapped input.
+ * @param offset Receives the number of input bytes covered by the snapshot.
+ * @param lines Receives the number of input lines covered by the snapshot.
+ * @return 0 on success, -1 if there is no valid snapshot (the set is left empty).
+ */
+
+    if (!input->mapped) return -1;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(SnapshotHeader)) {
+        close(fd);
+        return -1;
+    }
+
+    size_t size = (size_t)info.st_size;
+    char* data = malloc(size);
+    if (!data) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+
+    size_t done = 0;
+    while (done < size) {
+        ssize_t count = read(fd, data + done, size - done);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) break;
+        done += (size_t)count;
+    }
+    close(fd);
+
+    SnapshotHeader header;
+    memcpy(&header, data, sizeof(header));
+    const char* body = data + sizeof(header);
+    size_t bodySize = size - sizeof(header);
+
+    int valid = done == size
+        && memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) == 0
+        && header.version == SNAPSHOT_VERSION
+        && header.headerSize == sizeof(SnapshotHeader)
+        && header.sourceOffset > 0
+        && header.sourceOffset <= input->size
+        && header.lines <= (uint64_t)INT32_MAX
+        && fingerprintPrefix(input, header.sourceOffset) == header.prefixFingerprint
+        && hashBytes(0xcbf29ce484222325ULL, body, bodySize) == header.checksum
+        && checkReports(set, &header, body, bodySize) == 0;
+
+    if (!valid) {
+        free(data);
+        return -1;
+    }
+
+    size_t position = 0;
+    for (uint64_t b = 0; b < (header.plantCount + 1) * header.reportCount; b++) {
+        SnapshotReport saved;
+        memcpy(&saved, body + position, sizeof(saved));
+        position += sizeof(saved);
+
+        int i = (int)(b % header.reportCount);
+        Report* report = &set->reports[i];
+        if (b >= header.reportCount) report = &findPlantReports(set, saved.plantId)->reports[i];
+
+        restoreReport(report, &saved, (const SnapshotStation*)(body + position));
+        position += saved.stationCount * sizeof(SnapshotStation);
+    }
+
+    free(data);
+    *offset = header.sourceOffset;
+    *lines = (int)header.lines;
+    return 0;
+}
+
+static void writeSavedReport(FILE* file, const Report* report, uint64_t* checksum) {
+/**
+ * @brief Writes the counters and stations of a report and extends the checksum with them.
+ *
+ * Every record is a multiple of 8 bytes, so hashing the records one by one
+ * gives the same checksum as hashing the whole body when it is loaded.
+ *
+ * @param file The snapshot file.
+ * @param report The report to write.
+ * @param checksum The checksum of the body so far.
+ */
+
+    StationDiff* stations;
+    int count = collectStations(&report->stations, &stations);
+
+    SnapshotReport saved;
+    memset(&saved, 0, sizeof(saved));
+    saved.station = report->filter.station;
+    saved.consumer = report->filter.consumer;
+    saved.plantId = report->filter.plantId;
+    saved.keptLines = report->keptLines;
+    saved.plantLines = report->plantLines;
+    saved.ignoredLines = report->stats.ignoredLines;
+    saved.stationCount = (uint64_t)count;
+    fwrite(&saved, sizeof(saved), 1, file);
+    *checksum = hashBytes(*checksum, (const char*)&saved, sizeof(saved));
+
+    for (int i = 0; i < count; i++) {
+        SnapshotStation station;
+        memset(&station, 0, sizeof(station));
+        station.key = stations[i].key;
+        station.capacity = stations[i].capacity;
+        station.consumption = stations[i].consumption;
+        fwrite(&station, sizeof(station), 1, file);
+        *checksum = hashBytes(*checksum, (const char*)&station, sizeof(station));
+    }
+
+    free(stations);
+}
+
+int saveSnapshot(const ReportSet* set, const char* path, const InputFile* input, int lines) {
+/**
+ * @brief Writes the aggregated reports of a query and the part of the input they cover.
+ *
+ * The snapshot covers the whole input, which must end with a complete line
+ * so that appended lines start a new one. The file is written under a
+ * temporary name and renamed into place.
+ *
+ * @param set The aggregated reports, before their stations are freed.
+ * @param path The path of the snapshot file.
+ * @param input The mapped input the reports were read from.
+ * @param lines The number of input lines read.
+ * @return 0 on success, -1 on error (errno is set; EINVAL if the input cannot be resumed).
+ */
+
+    if (!input->mapped || input->size == 0 || input->data[input->size - 1] != '\n') {
+        errno = EINVAL;
+        return -1;
+    }
+
+    char temporaryPath[4096];
+    if (snprintf(temporaryPath, sizeof(temporaryPath), "%s.%d.tmp", path, (int)getpid()) >= (int)sizeof(temporaryPath)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    FILE* file = fopen(temporaryPath, "wb");
+    if (!file) return -1;
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.headerSize = sizeof(SnapshotHeader);
+    header.sourceOffset = input->size;
+    header.prefixFingerprint = fingerprintPrefix(input, input->size);
+    header.lines = (uint64_t)lines;
+    header.reportCount = (uint32_t)set->count;
+    header.perPlant = (uint32_t)set->perPlant;
+    header.plantCount = (uint64_t)set->plantCount;
+    header.checksum = 0xcbf29ce484222325ULL;
+
+    // The header is written again once the checksum of the body is known
+    fwrite(&header, sizeof(header), 1, file);
+    for (int i = 0; i < set->count; i++) {
+        writeSavedReport(file, &set->reports[i], &header.checksum);
+    }
+    for (int p = 0; p < set->plantCount; p++) {
+        for (int i = 0; i < set->count; i++) {
+            writeSavedReport(file, &set->plants[p].reports[i], &header.checksum);
+        }
+    }
+
+    int failed = fseek(file, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, file) != 1 || ferror(file);
+    if (fclose(file) != 0 || failed || rename(temporaryPath, path) != 0) {
+        int error = errno;
+        unlink(temporaryPath);
+        errno = error;
+        return -1;
+    }
+    return 0;
+}
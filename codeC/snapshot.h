@@ -0,0 +1,55 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "input.h"
+#include "report.h"
+
+// Identifies an aggregate snapshot file and the version of its layout
+#define SNAPSHOT_MAGIC "CWSNAP\0\0"
+#define SNAPSHOT_VERSION 1
+
+// Suffix of the snapshot file, named after the input and the query
+#define SNAPSHOT_SUFFIX ".snap"
+
+// Header of a snapshot file; the reports and their stations follow it
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t sourceOffset;
+    uint64_t prefixFingerprint;
+    uint64_t lines;
+    uint32_t reportCount;
+    uint32_t perPlant;
+    uint64_t plantCount;
+    uint64_t checksum;
+} SnapshotHeader;
+
+// One report of a snapshot, followed by its stations in key order
+typedef struct {
+    int32_t station;
+    int32_t consumer;
+    int32_t plantId;
+    int32_t keptLines;
+    int32_t plantLines;
+    uint32_t reserved;
+    int64_t ignoredLines;
+    uint64_t stationCount;
+} SnapshotReport;
+
+// One aggregated station of a snapshot
+typedef struct {
+    int32_t key;
+    uint32_t reserved;
+    int64_t capacity;
+    int64_t consumption;
+} SnapshotStation;
+
+// Snapshot function prototypes
+void snapshotPath(char* path, size_t size, const char* inputPath, const ReportSet* set);
+int loadSnapshot(ReportSet* set, const char* path, const InputFile* input, size_t* offset, int* lines);
+int saveSnapshot(const ReportSet* set, const char* path, const InputFile* input, int lines);
+
+#endif
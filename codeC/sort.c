@@ -0,0 +1,132 @@
+#include <stdlib.h>
+#include <string.h>
+#include "sort.h"
+
+int compareByCapacity(const void* a, const void* b) {
+/**
+ * @brief Compares two StationDiff structures by their capacity values.
+ * 
+ * @param a Pointer to the first StationDiff structure.
+ * @param b Pointer to the second StationDiff structure.
+ * @return An integer less than, equal to, or greater than zero if the capacity
+ *         of the first structure is less than, equal to, or greater than that of the second.
+ *         Equal capacities are ordered by key, so the result does not depend on qsort stability.
+ */
+
+    const StationDiff* stationA = (const StationDiff*)a;
+    const StationDiff* stationB = (const StationDiff*)b;
+
+    if (stationA->capacity < stationB->capacity) return -1;
+    if (stationA->capacity > stationB->capacity) return 1;
+    return (stationA->key > stationB->key) - (stationA->key < stationB->key);
+}
+
+static int radixPass(const SortPair* source, SortPair* destination, int count, size_t* histogram, int shift,
+                     int onKey) {
+/**
+ * @brief Moves the pairs by one byte of their sort key, keeping the order of equal bytes.
+ *
+ * @param source The pairs to distribute.
+ * @param destination Receives the pairs ordered by the byte.
+ * @param count The number of pairs.
+ * @param histogram The 256 counts of the byte values; turned into offsets.
+ * @param shift The position of the byte, in bits.
+ * @param onKey 1 to read the byte from the station key, 0 from the capacity.
+ * @return 0 if every pair has the same byte (nothing was moved), 1 otherwise.
+ */
+
+    uint64_t first = onKey ? source[0].key : source[0].capacity;
+    if (histogram[(first >> shift) & 0xff] == (size_t)count) return 0;
+
+    size_t offset = 0;
+    for (int digit = 0; digit < 256; digit++) {
+        size_t digitCount = histogram[digit];
+        histogram[digit] = offset;
+        offset += digitCount;
+    }
+
+    for (int i = 0; i < count; i++) {
+        uint64_t value = onKey ? source[i].key : source[i].capacity;
+        destination[histogram[(value >> shift) & 0xff]++] = source[i];
+    }
+    return 1;
+}
+
+void sortByCapacity(StationDiff* stations, int count) {
+/**
+ * @brief Sorts stations by capacity, then by key, as qsort() with compareByCapacity() does.
+ *
+ * Large arrays are sorted with an LSD radix sort on 16-byte (capacity, key,
+ * index) pairs rather than on the 32-byte stations, which are moved once at
+ * the end. Signed values are biased so that their bytes sort as unsigned.
+ * Snapshots come out of collectStations() in key order, so the key passes
+ * are skipped when the keys are already ascending, and the stable capacity
+ * passes keep equal capacities in key order. Passes whose byte is the same
+ * for every station (the high bytes of small capacities) are skipped too.
+ *
+ * @param stations The stations to sort in place.
+ * @param count The number of stations.
+ */
+
+    if (count < RADIX_SORT_MIN) {
+        qsort(stations, count, sizeof(StationDiff), compareByCapacity);
+        return;
+    }
+
+    SortPair* pairs = malloc(2 * (size_t)count * sizeof(SortPair));
+    StationDiff* sorted = malloc((size_t)count * sizeof(StationDiff));
+    if (!pairs || !sorted) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+
+    // One pass fills the pairs and the byte histograms of every radix pass
+    size_t capacityHistograms[8][256] = {{0}};
+    size_t keyHistograms[4][256] = {{0}};
+    int keysAscending = 1;
+
+    for (int i = 0; i < count; i++) {
+        uint64_t capacity = (uint64_t)stations[i].capacity ^ 0x8000000000000000ULL;
+        uint32_t key = (uint32_t)stations[i].key ^ 0x80000000u;
+        pairs[i].capacity = capacity;
+        pairs[i].key = key;
+        pairs[i].index = (uint32_t)i;
+
+        for (int b = 0; b < 8; b++) {
+            capacityHistograms[b][(capacity >> (8 * b)) & 0xff]++;
+        }
+        for (int b = 0; b < 4; b++) {
+            keyHistograms[b][(key >> (8 * b)) & 0xff]++;
+        }
+        if (i > 0 && stations[i].key < stations[i - 1].key) keysAscending = 0;
+    }
+
+    SortPair* source = pairs;
+    SortPair* destination = pairs + count;
+
+    if (!keysAscending) {
+        for (int b = 0; b < 4; b++) {
+            if (radixPass(source, destination, count, keyHistograms[b], 8 * b, 1)) {
+                SortPair* swap = source;
+                source = destination;
+                destination = swap;
+            }
+        }
+    }
+
+    for (int b = 0; b < 8; b++) {
+        if (radixPass(source, destination, count, capacityHistograms[b], 8 * b, 0)) {
+            SortPair* swap = source;
+            source = destination;
+            destination = swap;
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        sorted[i] = stations[source[i].index];
+    }
+    memcpy(stations, sorted, (size_t)count * sizeof(StationDiff));
+
+    free(sorted);
+    free(pairs);
+}
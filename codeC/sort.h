@@ -0,0 +1,21 @@
+#ifndef SORT_H
+#define SORT_H
+
+#include <stdint.h>
+#include "station.h"
+
+// Below this many stations, sortByCapacity() uses qsort
+#define RADIX_SORT_MIN 2048
+
+// Sort key of a station and its position in the unsorted array
+typedef struct {
+    uint64_t capacity;
+    uint32_t key;
+    uint32_t index;
+} SortPair;
+
+// Sorting function prototypes
+int compareByCapacity(const void* a, const void* b);
+void sortByCapacity(StationDiff* stations, int count);
+
+#endif
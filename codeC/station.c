@@ -0,0 +1,621 @@
+#include <limits.h>
+#include <string.h>
+#include "station.h"
+
+void initStationMap(StationMap* map, BackendType backend, int candidates) {
+/**
+ * @brief Initializes an empty station map.
+ *
+ * @param map The map to initialize.
+ * @param backend The backend to use; BACKEND_AUTO picks the dense table while the keys are dense.
+ * @param candidates The number of stations kept by BACKEND_BOUNDED; unused by the other backends.
+ */
+
+    memset(map, 0, sizeof(*map));
+    initTree(&map->tree);
+    initBPTree(&map->btree);
+    if (backend == BACKEND_BOUNDED) initCandidates(&map->candidates, candidates);
+    map->automatic = backend == BACKEND_AUTO;
+    map->backend = backend == BACKEND_AUTO ? BACKEND_DENSE : backend;
+}
+
+static void insertSparse(StationMap* map, int key, long capacity, long consumption) {
+/**
+ * @brief Adds a line to the ordered map backend of a station map.
+ *
+ * @param map The map, whose backend is the AVL tree or the B+tree.
+ * @param key The station ID.
+ * @param capacity The capacity of the line.
+ * @param consumption The consumption of the line.
+ */
+
+    if (map->backend == BACKEND_BTREE) {
+        insertBPTree(&map->btree, key, capacity, consumption);
+    } else {
+        insertNode(&map->tree, key, capacity, consumption);
+    }
+}
+
+static void convertToTree(StationMap* map) {
+/**
+ * @brief Moves every station of the dense table into the ordered map backend.
+ *
+ * In automatic mode the backend is SPARSE_BACKEND; a map forced to the
+ * dense table falls back to it too for negative keys.
+ *
+ * @param map The map to convert.
+ */
+
+    map->backend = SPARSE_BACKEND;
+    for (int i = 0; i < map->slotCount; i++) {
+        if (map->slots[i].present) {
+            insertSparse(map, map->base + i, map->slots[i].capacity, map->slots[i].consumption);
+        }
+    }
+
+    free(map->slots);
+    map->slots = NULL;
+    map->slotCount = 0;
+}
+
+static int growDense(StationMap* map, int key) {
+/**
+ * @brief Extends the dense table so that it covers a key.
+ *
+ * The table at least doubles in the direction of the key. In automatic mode,
+ * the map is converted to the ordered map instead when the new range would
+ * hold too many empty slots per station.
+ *
+ * @param map The map to extend.
+ * @param key The key the table must cover.
+ * @return 1 if the table now covers the key, 0 if the map was converted to the ordered map.
+ */
+
+    long long low = map->base;
+    long long high = (long long)map->base + map->slotCount - 1;
+    if (map->slotCount == 0) low = high = key;
+
+    // Only the keys actually needed count for the density check
+    long long neededLow = key < low ? key : low;
+    long long neededHigh = key > high ? key : high;
+    long long needed = neededHigh - neededLow + 1;
+    if (map->automatic && needed > DENSE_MIN_SLOTS && needed > (long long)DENSE_MAX_SLOTS_PER_STATION * (map->count + 1)) {
+        convertToTree(map);
+        return 0;
+    }
+
+    if (map->slotCount > 0 && key < low) {
+        low = key < low - map->slotCount ? key : low - map->slotCount;
+        if (low < 0) low = 0;
+    } else if (map->slotCount > 0) {
+        high = key > high + map->slotCount ? key : high + map->slotCount;
+    }
+    if (high - low + 1 < 1024) high = low + 1023;
+    if (high > 0x7fffffff) high = 0x7fffffff;
+    long long size = high - low + 1;
+
+    DenseSlot* slots = calloc((size_t)size, sizeof(DenseSlot));
+    if (!slots) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    if (map->slotCount > 0) {
+        memcpy(slots + (map->base - low), map->slots, (size_t)map->slotCount * sizeof(DenseSlot));
+    }
+
+    free(map->slots);
+    map->slots = slots;
+    map->base = (int)low;
+    map->slotCount = (int)size;
+    return 1;
+}
+
+void addStation(StationMap* map, int key, long capacity, long consumption) {
+/**
+ * @brief Adds a line to the aggregate of its station.
+ *
+ * The first line of a station sets its capacity; every line adds its
+ * consumption, like insertNode() does for duplicate keys.
+ *
+ * @param map The map receiving the line.
+ * @param key The station ID.
+ * @param capacity The capacity of the line.
+ * @param consumption The consumption of the line.
+ */
+
+    if (map->backend == BACKEND_BOUNDED) {
+        addCandidate(&map->candidates, key, capacity, consumption);
+        return;
+    }
+
+    if (map->backend == BACKEND_DENSE) {
+        if (key < 0) {
+            convertToTree(map);
+        } else if ((key >= map->base && key - map->base < map->slotCount) || growDense(map, key)) {
+            DenseSlot* slot = &map->slots[key - map->base];
+            if (slot->present) {
+                slot->consumption += consumption;
+            } else {
+                slot->present = 1;
+                slot->capacity = capacity;
+                slot->consumption = consumption;
+                map->count++;
+            }
+            return;
+        }
+    }
+
+    insertSparse(map, key, capacity, consumption);
+}
+
+void mergeStationMap(StationMap* map, StationMap* other) {
+/**
+ * @brief Merges the stations of another map into the map, then frees the other map.
+ *
+ * Stations already present in map keep their capacity and add the
+ * consumption of the other map, so merging maps built from consecutive
+ * slices of the input in order gives the same result as a sequential run.
+ *
+ * @param map The map receiving the stations.
+ * @param other The map to merge; it is freed.
+ */
+
+    // An empty map simply takes over the other one
+    if (countStations(map) == 0) {
+        freeStationMap(map);
+        *map = *other;
+        memset(other, 0, sizeof(*other));
+        return;
+    }
+
+    if (map->backend == BACKEND_BOUNDED) {
+        mergeCandidates(&map->candidates, &other->candidates);
+    } else if (other->backend != BACKEND_DENSE) {
+        if (map->backend == BACKEND_AVL && other->backend == BACKEND_AVL) {
+            mergeTree(&map->tree, &other->tree);
+        } else if (map->backend == BACKEND_BTREE && other->backend == BACKEND_BTREE) {
+            mergeBPTree(&map->btree, &other->btree);
+        } else {
+            StationDiff* stations = NULL;
+            int count = collectStations(other, &stations);
+            for (int i = 0; i < count; i++) {
+                addStation(map, stations[i].key, stations[i].capacity, stations[i].consumption);
+            }
+            free(stations);
+        }
+    } else {
+        for (int i = 0; i < other->slotCount; i++) {
+            const DenseSlot* slot = &other->slots[i];
+            if (slot->present) {
+                addStation(map, other->base + i, slot->capacity, slot->consumption);
+            }
+        }
+    }
+
+    freeStationMap(other);
+}
+
+static void collectTree(const AVLTree* tree, StationDiff* stations) {
+/**
+ * @brief Copies the nodes of an AVL tree in key order into an array large enough to hold them.
+ *
+ * The in-order traversal uses an explicit stack of arena indices.
+ *
+ * @param tree The AVL tree.
+ * @param stations The array receiving the stations.
+ */
+
+    uint32_t stack[MAX_TREE_HEIGHT];
+    int depth = 0;
+    int count = 0;
+    uint32_t current = tree->root;
+
+    while (current != NIL_NODE || depth > 0) {
+        while (current != NIL_NODE) {
+            stack[depth++] = current;
+            current = tree->nodes[current].left;
+        }
+
+        const AVLNode* node = &tree->nodes[stack[--depth]];
+        stations[count].key = node->key;
+        stations[count].capacity = node->capacity;
+        stations[count].consumption = node->consumption;
+        stations[count].difference = node->capacity - node->consumption;
+        count++;
+
+        current = node->right;
+    }
+}
+
+static void collectLeaves(const BPTree* tree, StationDiff* stations) {
+/**
+ * @brief Copies the keys of a B+tree in key order into an array large enough to hold them.
+ *
+ * The leaves are linked in key order, so this is a sequential scan of the
+ * leaf chain that never touches the inner nodes.
+ *
+ * @param tree The B+tree.
+ * @param stations The array receiving the stations.
+ */
+
+    int count = 0;
+    for (uint32_t index = tree->first; index != NIL_BLOCK; index = tree->leaves[index].next) {
+        const BPLeaf* leaf = &tree->leaves[index];
+        for (int i = 0; i < leaf->count; i++) {
+            stations[count].key = leaf->keys[i];
+            stations[count].capacity = leaf->entries[i].capacity;
+            stations[count].consumption = leaf->entries[i].consumption;
+            stations[count].difference = leaf->entries[i].capacity - leaf->entries[i].consumption;
+            count++;
+        }
+    }
+}
+
+static int compareByKey(const void* a, const void* b) {
+/**
+ * @brief qsort adapter ordering stations by key.
+ */
+
+    const StationDiff* first = (const StationDiff*)a;
+    const StationDiff* second = (const StationDiff*)b;
+    return (first->key > second->key) - (first->key < second->key);
+}
+
+static void collectCandidates(const CandidateTable* table, StationDiff* stations) {
+/**
+ * @brief Copies the candidates of a bounded table in key order into an array large enough to hold them.
+ *
+ * @param table The candidate table.
+ * @param stations The array receiving the stations.
+ */
+
+    for (int i = 0; i < table->count; i++) {
+        const Candidate* candidate = &table->entries[i];
+        stations[i].key = candidate->key;
+        stations[i].capacity = candidate->capacity;
+        stations[i].consumption = candidate->consumption;
+        stations[i].difference = candidate->capacity - candidate->consumption;
+    }
+    qsort(stations, (size_t)table->count, sizeof(StationDiff), compareByKey);
+}
+
+int countStations(const StationMap* map) {
+/**
+ * @brief Returns the number of stations of a map.
+ *
+ * @param map The map.
+ * @return The number of distinct stations.
+ */
+
+    if (map->backend == BACKEND_DENSE) return map->count;
+    if (map->backend == BACKEND_BOUNDED) return map->candidates.count;
+    if (map->backend == BACKEND_BTREE) return (int)bptreeSize(&map->btree);
+    return (int)treeSize(&map->tree);
+}
+
+int findStation(const StationMap* map, int key, StationDiff* station) {
+/**
+ * @brief Looks up the aggregate of one station.
+ *
+ * @param map The map to search.
+ * @param key The station ID.
+ * @param station Receives the capacity, consumption and difference of the station.
+ * @return 1 if the station was found, 0 otherwise.
+ */
+
+    long capacity;
+    long consumption;
+
+    if (map->backend == BACKEND_DENSE) {
+        if (key < map->base || key - map->base >= map->slotCount || !map->slots[key - map->base].present) return 0;
+        capacity = map->slots[key - map->base].capacity;
+        consumption = map->slots[key - map->base].consumption;
+    } else if (map->backend == BACKEND_BTREE) {
+        const BPEntry* entry = findBPTree(&map->btree, key);
+        if (!entry) return 0;
+        capacity = entry->capacity;
+        consumption = entry->consumption;
+    } else if (map->backend == BACKEND_BOUNDED) {
+        const Candidate* candidate = findCandidate(&map->candidates, key);
+        if (!candidate) return 0;
+        capacity = candidate->capacity;
+        consumption = candidate->consumption;
+    } else {
+        const AVLNode* node = searchNode(&map->tree, key);
+        if (!node) return 0;
+        capacity = node->capacity;
+        consumption = node->consumption;
+    }
+
+    station->key = key;
+    station->capacity = capacity;
+    station->consumption = consumption;
+    station->difference = capacity - consumption;
+    return 1;
+}
+
+int collectStations(const StationMap* map, StationDiff** stations) {
+/**
+ * @brief Collects all stations of a map, in key order, into a newly allocated array.
+ *
+ * The dense table and the B+tree leaves are swept linearly; the AVL tree is
+ * traversed in order. A bounded map gives its candidates, with the aggregate
+ * of the lines it saw, sorted by key.
+ *
+ * @param map The map to collect.
+ * @param stations Receives the array of stations; the caller frees it.
+ * @return The number of stations collected.
+ */
+
+    int size = countStations(map);
+    *stations = malloc((size > 0 ? size : 1) * sizeof(StationDiff));
+    if (!*stations) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+
+    int count = 0;
+    if (map->backend == BACKEND_DENSE) {
+        for (int i = 0; i < map->slotCount; i++) {
+            const DenseSlot* slot = &map->slots[i];
+            if (!slot->present) continue;
+            (*stations)[count].key = map->base + i;
+            (*stations)[count].capacity = slot->capacity;
+            (*stations)[count].consumption = slot->consumption;
+            (*stations)[count].difference = slot->capacity - slot->consumption;
+            count++;
+        }
+    } else if (map->backend == BACKEND_BTREE) {
+        collectLeaves(&map->btree, *stations);
+        count = size;
+    } else if (map->backend == BACKEND_BOUNDED) {
+        collectCandidates(&map->candidates, *stations);
+        count = size;
+    } else {
+        collectTree(&map->tree, *stations);
+        count = size;
+    }
+
+    return count;
+}
+
+void freeStationMap(StationMap* map) {
+/**
+ * @brief Frees the memory held by a station map and leaves it empty.
+ *
+ * @param map The map to free.
+ */
+
+    free(map->slots);
+    freeTree(&map->tree);
+    freeBPTree(&map->btree);
+    freeCandidates(&map->candidates);
+    map->slots = NULL;
+    map->slotCount = 0;
+    map->count = 0;
+}
+
+int parseBackend(const char* name, BackendType* backend) {
+/**
+ * @brief Parses the name of an aggregation backend given on the command line.
+ *
+ * @param name The backend name: auto, dense, avl or btree.
+ * @param backend Receives the backend.
+ * @return 0 on success, -1 if the name is unknown.
+ */
+
+    if (strcmp(name, "auto") == 0) {
+        *backend = BACKEND_AUTO;
+    } else if (strcmp(name, "dense") == 0) {
+        *backend = BACKEND_DENSE;
+    } else if (strcmp(name, "avl") == 0) {
+        *backend = BACKEND_AVL;
+    } else if (strcmp(name, "btree") == 0) {
+        *backend = BACKEND_BTREE;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+const char* backendName(BackendType backend) {
+/**
+ * @brief Returns the name of a backend, as accepted by parseBackend().
+ *
+ * @param backend The backend.
+ * @return The name of the backend.
+ */
+
+    switch (backend) {
+        case BACKEND_DENSE: return "dense";
+        case BACKEND_AVL: return "avl";
+        case BACKEND_BTREE: return "btree";
+        case BACKEND_BOUNDED: return "bounded";
+        default: return "auto";
+    }
+}
+
+int compareByRank(const StationDiff* a, const StationDiff* b) {
+/**
+ * @brief Orders stations by difference, then by key, which gives a total order.
+ *
+ * @param a The first station.
+ * @param b The second station.
+ * @return A negative, zero or positive value if a ranks before, with or after b.
+ */
+
+    if (a->difference < b->difference) return -1;
+    if (a->difference > b->difference) return 1;
+    return (a->key > b->key) - (a->key < b->key);
+}
+
+static void siftDown(StationDiff* heap, int size, int index, int direction) {
+/**
+ * @brief Restores the heap property below an entry of a bounded heap.
+ *
+ * @param heap The heap entries.
+ * @param size The number of entries in the heap.
+ * @param index The entry to move down.
+ * @param direction 1 for a heap whose root ranks lowest, -1 for a heap whose root ranks highest.
+ */
+
+    for (;;) {
+        int child = 2 * index + 1;
+        if (child >= size) return;
+        if (child + 1 < size && direction * compareByRank(&heap[child + 1], &heap[child]) < 0) child++;
+        if (direction * compareByRank(&heap[child], &heap[index]) >= 0) return;
+
+        StationDiff swap = heap[index];
+        heap[index] = heap[child];
+        heap[child] = swap;
+        index = child;
+    }
+}
+
+static int compareRankAscending(const void* a, const void* b) {
+/**
+ * @brief qsort adapter ranking stations from the smallest difference up.
+ */
+
+    return compareByRank((const StationDiff*)a, (const StationDiff*)b);
+}
+
+static int compareRankDescending(const void* a, const void* b) {
+/**
+ * @brief qsort adapter ranking stations from the largest difference down.
+ */
+
+    return compareByRank((const StationDiff*)b, (const StationDiff*)a);
+}
+
+int selectExtremes(const StationDiff* stations, int count, int limit, StationDiff* top, StationDiff* bottom) {
+/**
+ * @brief Selects the stations with the largest and the smallest differences.
+ *
+ * Two bounded heaps of limit entries are filled in one pass over the
+ * stations, in O(count log limit), instead of sorting the whole array. Ties
+ * on the difference are broken by key, so the result matches a full stable
+ * sort of a key-ordered array and does not depend on the order of stations.
+ *
+ * @param stations The stations to rank, in any order.
+ * @param count The number of stations.
+ * @param limit The number of stations to select at each end.
+ * @param top Receives the largest differences, from the largest down.
+ * @param bottom Receives the smallest differences, from the smallest up.
+ * @return The number of stations written to each of top and bottom.
+ */
+
+    int size = 0;
+    if (limit <= 0) return 0;
+
+    for (int i = 0; i < count; i++) {
+        if (size < limit) {
+            top[size] = stations[i];
+            bottom[size] = stations[i];
+            size++;
+            if (size == limit) {
+                for (int j = size / 2 - 1; j >= 0; j--) {
+                    siftDown(top, size, j, 1);
+                    siftDown(bottom, size, j, -1);
+                }
+            }
+            continue;
+        }
+
+        if (compareByRank(&stations[i], &top[0]) > 0) {
+            top[0] = stations[i];
+            siftDown(top, size, 0, 1);
+        }
+        if (compareByRank(&stations[i], &bottom[0]) < 0) {
+            bottom[0] = stations[i];
+            siftDown(bottom, size, 0, -1);
+        }
+    }
+
+    qsort(top, size, sizeof(StationDiff), compareRankDescending);
+    qsort(bottom, size, sizeof(StationDiff), compareRankAscending);
+    return size;
+}
+
+int rankingLimit(int stationCount) {
+/**
+ * @brief Computes the number of stations in each of the top and bottom files.
+ * 
+ * The sorted file holds a header and one line per station; each file gets
+ * half of those lines, at most 10.
+ * 
+ * @param stationCount The number of stations.
+ * @return The number of stations in each file.
+ */
+
+    int lineCount = stationCount + 1;
+    return lineCount >= 20 ? 10 : lineCount / 2;
+}
+
+static int listed(const StationDiff* stations, int count, int key) {
+/**
+ * @brief Tells whether a key is among a few selected stations.
+ */
+
+    for (int i = 0; i < count; i++) {
+        if (stations[i].key == key) return 1;
+    }
+    return 0;
+}
+
+void boundRanking(const StationMap* map, const StationDiff* top, const StationDiff* bottom, int selected, RankBounds* bounds) {
+/**
+ * @brief Tells how far the top and bottom stations selected from a bounded map may be from the exact ones.
+ *
+ * The selected stations are exactly the top (bottom) ones when the smallest
+ * (largest) difference any of them can have still beats the largest
+ * (smallest) difference any other station can have: another candidate, or
+ * a station the table dropped. Equal differences are only decided when both
+ * are exact, since ties are broken by key. A map that never dropped a
+ * station is exact.
+ *
+ * @param map The bounded map the stations were selected from.
+ * @param top The selected stations with the largest estimated differences.
+ * @param bottom The selected stations with the smallest estimated differences.
+ * @param selected The number of stations in top and in bottom.
+ * @param bounds Receives the largest error of a selected difference and whether each end is exact.
+ */
+
+    const CandidateTable* table = &map->candidates;
+    long low;
+    long high;
+
+    // Worst case of each end: the lowest a top station can be, the highest a bottom station can be
+    long topLow = LONG_MAX;
+    long bottomHigh = LONG_MIN;
+    int topPoint = 1;
+    int bottomPoint = 1;
+    bounds->maxError = 0;
+    for (int i = 0; i < selected; i++) {
+        candidateBounds(findCandidate(table, top[i].key), &low, &high);
+        if (high - low > bounds->maxError) bounds->maxError = high - low;
+        if (low < topLow) topLow = low;
+        if (low != high) topPoint = 0;
+
+        candidateBounds(findCandidate(table, bottom[i].key), &low, &high);
+        if (high - low > bounds->maxError) bounds->maxError = high - low;
+        if (high > bottomHigh) bottomHigh = high;
+        if (low != high) bottomPoint = 0;
+    }
+
+    bounds->topExact = table->dropped == 0 || table->droppedHigh < topLow;
+    bounds->bottomExact = table->dropped == 0 || table->droppedLow > bottomHigh;
+    if (table->dropped == 0) return;
+
+    for (int i = 0; i < table->count; i++) {
+        const Candidate* candidate = &table->entries[i];
+        candidateBounds(candidate, &low, &high);
+        int point = low == high;
+        if (!listed(top, selected, candidate->key) && (high > topLow || (high == topLow && !(point && topPoint)))) {
+            bounds->topExact = 0;
+        }
+        if (!listed(bottom, selected, candidate->key) && (low < bottomHigh || (low == bottomHigh && !(point && bottomPoint)))) {
+            bounds->bottomExact = 0;
+        }
+    }
+}
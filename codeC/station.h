@@ -0,0 +1,70 @@
+#ifndef STATION_H
+#define STATION_H
+
+#include "bptree.h"
+#include "candidate.h"
+#include "tree.h"
+
+// Key ranges up to this many slots always stay in the dense table
+#define DENSE_MIN_SLOTS 65536
+// Above that, the dense table is kept while it has at most this many slots per station
+#define DENSE_MAX_SLOTS_PER_STATION 8
+
+// Aggregation backends; BACKEND_AUTO starts dense and falls back to SPARSE_BACKEND for sparse keys
+// BACKEND_BOUNDED only keeps a fixed number of candidate stations for the lv all ranking
+typedef enum { BACKEND_AUTO, BACKEND_DENSE, BACKEND_AVL, BACKEND_BTREE, BACKEND_BOUNDED } BackendType;
+
+// Ordered map taken by BACKEND_AUTO when the keys are too sparse for the dense table
+#define SPARSE_BACKEND BACKEND_BTREE
+
+// Structure to dynamically hold station data
+typedef struct {
+    int key;
+    long capacity;
+    long consumption;
+    long difference;
+} StationDiff;
+
+// One entry of the dense table, indexed by key - base
+typedef struct {
+    long capacity;
+    long consumption;
+    int present;
+} DenseSlot;
+
+// Aggregated stations, stored in a dense table, an AVL tree, a B+tree or a bounded candidate table
+typedef struct {
+    BackendType backend;
+    int automatic;
+    DenseSlot* slots;
+    int base;
+    int slotCount;
+    AVLTree tree;
+    BPTree btree;
+    CandidateTable candidates;
+    int count;
+} StationMap;
+
+// How far the top and bottom stations selected from a bounded map may be from the exact ones
+typedef struct {
+    long maxError;
+    int topExact;
+    int bottomExact;
+} RankBounds;
+
+// Station map function prototypes
+void initStationMap(StationMap* map, BackendType backend, int candidates);
+void addStation(StationMap* map, int key, long capacity, long consumption);
+void mergeStationMap(StationMap* map, StationMap* other);
+int countStations(const StationMap* map);
+int findStation(const StationMap* map, int key, StationDiff* station);
+int collectStations(const StationMap* map, StationDiff** stations);
+void freeStationMap(StationMap* map);
+int parseBackend(const char* name, BackendType* backend);
+const char* backendName(BackendType backend);
+int compareByRank(const StationDiff* a, const StationDiff* b);
+int selectExtremes(const StationDiff* stations, int count, int limit, StationDiff* top, StationDiff* bottom);
+int rankingLimit(int stationCount);
+void boundRanking(const StationMap* map, const StationDiff* top, const StationDiff* bottom, int selected, RankBounds* bounds);
+
+#endif
@@ -0,0 +1,74 @@
+#include <string.h>
+#include <time.h>
+#include "stats.h"
+
+double statsClock(void) {
+/**
+ * @brief Returns the time of a monotonic clock, for measuring phases.
+ *
+ * @return The time in seconds, from an arbitrary origin.
+ */
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+void addTimer(TimerList* list, const char* name, double seconds) {
+/**
+ * @brief Adds the time of a phase; phases that run several times are summed.
+ *
+ * @param list The timers receiving the time.
+ * @param name The name of the phase (a string literal).
+ * @param seconds The elapsed time.
+ */
+
+    for (int i = 0; i < list->count; i++) {
+        if (strcmp(list->timers[i].name, name) == 0) {
+            list->timers[i].seconds += seconds;
+            return;
+        }
+    }
+
+    if (list->count < MAX_TIMERS) {
+        list->timers[list->count].name = name;
+        list->timers[list->count].seconds = seconds;
+        list->count++;
+    }
+}
+
+void writeTimersJson(FILE* file, const TimerList* list) {
+/**
+ * @brief Writes timers as a JSON object of seconds per phase.
+ *
+ * @param file The file receiving the object.
+ * @param list The timers to write.
+ */
+
+    fprintf(file, "{");
+    for (int i = 0; i < list->count; i++) {
+        fprintf(file, "%s\"%s\": %.6f", i ? ", " : "", list->timers[i].name, list->timers[i].seconds);
+    }
+    fprintf(file, "}");
+}
+
+void writeJsonString(FILE* file, const char* text) {
+/**
+ * @brief Writes a string as a quoted JSON string, escaping quotes, backslashes and control characters.
+ *
+ * @param file The file receiving the string.
+ * @param text The string to write.
+ */
+
+    fputc('"', file);
+    for (const unsigned char* c = (const unsigned char*)text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(file, "\\%c", *c);
+        } else if (*c < 0x20) {
+            fprintf(file, "\\u%04x", *c);
+        } else {
+            fputc(*c, file);
+        }
+    }
+    fputc('"', file);
+}
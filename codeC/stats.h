@@ -0,0 +1,60 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+
+// Most phases timed for the run or for one report
+#define MAX_TIMERS 16
+
+// Elapsed time of a named phase
+typedef struct {
+    const char* name;
+    double seconds;
+} Timer;
+
+// Timed phases, in the order they first ran
+typedef struct {
+    Timer timers[MAX_TIMERS];
+    int count;
+} TimerList;
+
+// Counters and timers of the whole run
+typedef struct {
+    TimerList timers;
+    long linesRead;
+    long ignoredEmptyKey;
+    long ignoredEmptyCapacity;
+    long snapshotLines;
+    long rankPublishes;
+    long rankRebuilds;
+    long queries;
+    long readStalls;
+    const char* reader;
+    int cacheUsed;
+    int threads;
+    int shards;
+} RunStats;
+
+// Counters and timers of one report, taken before its stations are freed
+typedef struct {
+    TimerList timers;
+    long ignoredLines;
+    long distinctStations;
+    const char* backend;
+    int treeHeight;
+    unsigned long rotations;
+    unsigned long nodeSplits;
+    long droppedStations;
+    long rankError;
+    int topExact;
+    int bottomExact;
+    int verified;
+} ReportStats;
+
+// Statistics function prototypes
+double statsClock(void);
+void addTimer(TimerList* list, const char* name, double seconds);
+void writeTimersJson(FILE* file, const TimerList* list);
+void writeJsonString(FILE* file, const char* text);
+
+#endif
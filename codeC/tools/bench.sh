@@ -0,0 +1,84 @@
+#!/bin/bash
+
+# Benchmark of the C program on a generated c-wire file.
+# Usage: tools/bench.sh (run through "make bench" from codeC/)
+# Environment: BENCH_LINES (default 1000000), BENCH_PLANTS (default 5),
+#              BENCH_OPTIONS (extra options for main, e.g. "-j 4 --cache"),
+#              BENCH_COLD=1 to evict the input from the page cache before each run,
+#              BENCH_THREADS (thread counts of the scaling sweep, default 1 2 4 8 and on up to the CPU count)
+
+cd "$(dirname "$0")/../.." || exit 1
+
+lines="${BENCH_LINES:-1000000}"
+plants="${BENCH_PLANTS:-5}"
+data_dir="tmp/bench"
+data_file="$data_dir/c-wire_${lines}.dat"
+
+mkdir -p "$data_dir" output
+
+# Generate the dataset once per size; the generator is deterministic
+if [ ! -f "$data_file" ]; then
+    echo "Generating $data_file ($lines lines, $plants plants)..."
+    ./codeC/bin/gen -n "$lines" -p "$plants" -o "$data_file" || exit 1
+fi
+
+# Runs main once under runstat; sets elapsed, rss and code
+measure() {
+    # Dropping the cached pages of the input makes the run read it from the disk again
+    if [ -n "$BENCH_COLD" ]; then
+        dd if="$data_file" iflag=nocache count=0 status=none
+    fi
+    # runstat prints its measurements on stderr; the program's own output is discarded
+    local stats
+    stats=$(./codeC/bin/runstat ./codeC/bin/main "$data_file" "$@" 2>&1 >/dev/null | grep '^elapsed=')
+    elapsed=$(echo "$stats" | sed 's/.*elapsed=\([0-9.]*\).*/\1/')
+    rss=$(echo "$stats" | sed 's/.*maxrss_kb=\([0-9]*\).*/\1/')
+    code=$(echo "$stats" | sed 's/.*status=\([0-9]*\).*/\1/')
+}
+
+line_count=$(wc -l < "$data_file")
+size_mb=$(( $(wc -c < "$data_file") / 1048576 ))
+echo "Input: $data_file ($line_count lines, $size_mb MB), options: ${BENCH_OPTIONS:-none}${BENCH_COLD:+, cold cache}"
+printf "%-10s %10s %14s %12s\n" "mode" "time (s)" "lines/s" "peak RSS (MB)"
+
+status=0
+for mode in "hvb comp" "hva comp" "lv comp" "lv indiv" "lv all"; do
+    measure $mode -1 $BENCH_OPTIONS
+    if [ "$code" != "0" ]; then
+        echo "$mode: failed with status $code"
+        status=1
+        continue
+    fi
+    awk -v mode="$mode" -v t="$elapsed" -v n="$line_count" -v rss="$rss" \
+        'BEGIN { printf "%-10s %10.3f %14.0f %12.1f\n", mode, t, (t > 0 ? n / t : 0), rss / 1024 }'
+done
+
+# Thread scaling of lv all and of the batch mode; the last -j given to main wins over BENCH_OPTIONS
+cpus=$(nproc)
+threads="$BENCH_THREADS"
+if [ -z "$threads" ]; then
+    for ((j = 1; j <= 8 || j <= cpus; j *= 2)); do threads="$threads $j"; done
+    [[ " $threads " == *" $cpus "* ]] || threads="$threads $cpus"
+fi
+echo
+echo "Thread scaling (CPUs online: $cpus)"
+printf "%-8s %12s %8s %12s %8s\n" "threads" "lv all (s)" "speedup" "batch (s)" "speedup"
+
+for j in $threads; do
+    measure lv all -1 $BENCH_OPTIONS -j "$j"
+    lv_time="$elapsed"
+    lv_code="$code"
+    measure --batch $BENCH_OPTIONS -j "$j"
+    if [ "$lv_code" != "0" ] || [ "$code" != "0" ]; then
+        echo "-j $j: failed with status $lv_code/$code"
+        status=1
+        continue
+    fi
+    # Speedups are relative to the first thread count of the sweep
+    lv_base="${lv_base:-$lv_time}"
+    batch_base="${batch_base:-$elapsed}"
+    awk -v j="$j" -v t="$lv_time" -v t0="$lv_base" -v b="$elapsed" -v b0="$batch_base" \
+        'BEGIN { printf "%-8s %12.3f %8.2f %12.3f %8.2f\n", j, t, (t > 0 ? t0 / t : 0), b, (b > 0 ? b0 / b : 0) }'
+done
+
+exit $status
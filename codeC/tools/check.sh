@@ -0,0 +1,223 @@
+#!/bin/bash
+
+# Regression check of the C program against the golden results in Tests/.
+# Usage: tools/check.sh (run through "make check" from codeC/)
+# Environment: CHECK_OPTIONS (extra options for main, e.g. "-j 4 --cache" or "--binary")
+# Each Tests/Resultats_vNN directory is checked with input/c-wire_vNN.dat, then a few scenarios are
+# checked against plain runs of the same input in tmp/check.
+
+cd "$(dirname "$0")/../.." || exit 1
+mkdir -p output
+
+failures=0
+checked=0
+
+for golden in Tests/Resultats_v*; do
+    version="${golden##*Resultats_}"
+    input="input/c-wire_${version}.dat"
+    if [ ! -f "$input" ]; then
+        echo "SKIP $version: $input not found"
+        continue
+    fi
+
+    for mode_dir in "$golden"/*/; do
+        mode=$(basename "$mode_dir")
+        station="${mode%_*}"
+        consumer="${mode#*_}"
+
+        rm -f output/*
+        if ! ./codeC/bin/main "$input" "$station" "$consumer" -1 --gnuplot $CHECK_OPTIONS > output/.check.log 2>&1; then
+            echo "FAIL $version $station $consumer: the program failed"
+            cat output/.check.log
+            failures=$((failures + 1))
+            continue
+        fi
+
+        # The golden charts were drawn by gnuplot, so only text results (the script included) are compared
+        for expected in "$mode_dir"*.csv "$mode_dir"*.gp; do
+            [ -f "$expected" ] || continue
+            checked=$((checked + 1))
+            if ! cmp -s "$expected" "output/$(basename "$expected")"; then
+                echo "FAIL $version $station $consumer: $(basename "$expected") differs"
+                diff "$expected" "output/$(basename "$expected")" | head -5
+                failures=$((failures + 1))
+            fi
+        done
+
+        # With --binary, the binary result file must convert back to the sorted file it was written with
+        for result in output/sorted_*.cwr; do
+            [ -f "$result" ] || continue
+            checked=$((checked + 1))
+            if ! ./codeC/bin/cwresult csv "$result" | cmp -s - "${result%.cwr}.csv"; then
+                echo "FAIL $version $station $consumer: $(basename "$result") does not convert back to its CSV file"
+                failures=$((failures + 1))
+            fi
+        done
+    done
+done
+rm -f output/.check.log
+
+# Scenarios that the golden results do not cover, each compared with a plain run of the same input
+scenarios=tmp/check
+rm -rf "$scenarios"
+mkdir -p "$scenarios"
+
+# A plant query resumed from its snapshot over a column cache numbers the appended lines from the whole input
+if [ -f input/c-wire_v00.dat ]; then
+    cp input/c-wire_v00.dat "$scenarios/resume.dat"
+    ./codeC/bin/main "$scenarios/resume.dat" lv all 2 --cache --snapshot --chart none > /dev/null 2>&1
+    echo "2;-;-;;-;5;-;100" >> "$scenarios/resume.dat"
+    ./codeC/bin/main "$scenarios/resume.dat" lv all 2 --cache --snapshot --chart none > "$scenarios/resumed.log" 2>&1
+    cp output/sorted_lv_all.csv "$scenarios/resumed.csv"
+    ./codeC/bin/main "$scenarios/resume.dat" lv all 2 --chart none > "$scenarios/plain.log" 2>&1
+    checked=$((checked + 1))
+    if ! cmp -s output/sorted_lv_all.csv "$scenarios/resumed.csv" ||
+       [ "$(grep -E "^(Line 107 |File reading)" "$scenarios/resumed.log")" != \
+         "$(grep -E "^(Line 107 |File reading)" "$scenarios/plain.log")" ]; then
+        echo "FAIL resume: a plant query resumed with --cache --snapshot differs from a plain run"
+        diff "$scenarios/plain.log" "$scenarios/resumed.log" | head -5
+        failures=$((failures + 1))
+    fi
+fi
+
+# Lines appended while following end up in the same files as a full run over the longer input
+if [ -f input/c-wire_v00.dat ]; then
+    cp input/c-wire_v00.dat "$scenarios/follow.dat"
+    rm -f output/*
+    ./codeC/bin/main "$scenarios/follow.dat" lv all -1 --follow --chart none > "$scenarios/follow.log" 2>&1 &
+    follower=$!
+    for _ in $(seq 50); do
+        grep -q "^Following" "$scenarios/follow.log" && break
+        sleep 0.1
+    done
+    printf "1;-;-;1;-;90;-;5000000000\n1;-;-;30;-;-;999;-\n1;-;-;30;-;91;-;12\n" >> "$scenarios/follow.dat"
+    sleep 0.5
+    kill -TERM "$follower"
+    wait "$follower"
+    mkdir -p "$scenarios/followed"
+    cp output/*.csv "$scenarios/followed/"
+    ./codeC/bin/main "$scenarios/follow.dat" lv all -1 --chart none > /dev/null 2>&1
+    for result in sorted_lv_all.csv top10_lv_all.csv bottom10_lv_all.csv lv_all_minmax.csv; do
+        checked=$((checked + 1))
+        if ! cmp -s "output/$result" "$scenarios/followed/$result"; then
+            echo "FAIL follow: $result of a followed input differs from a full run"
+            diff "output/$result" "$scenarios/followed/$result" | head -5
+            failures=$((failures + 1))
+        fi
+    done
+fi
+
+# A server answers each query with the rows of the file a plain run of that query writes
+if [ -f input/c-wire_v00.dat ]; then
+    printf "%s\n" "sorted hvb comp" "sorted lv indiv" "sorted lv all plant 2" "lv all top" "lv all bottom" \
+        "lv all minmax" quit |
+        ./codeC/bin/main input/c-wire_v00.dat --serve 2> /dev/null > "$scenarios/answers.txt"
+    # Each answer is "OK <rows>" followed by its rows, stored as answer_1, answer_2...
+    awk -v dir="$scenarios" '
+        rows == 0 && $1 == "OK" { rows = $2; file = dir "/answer_" ++count; printf "" > file; next }
+        rows > 0 { print > file; rows-- }' "$scenarios/answers.txt"
+    ./codeC/bin/main input/c-wire_v00.dat hvb comp -1 > /dev/null 2>&1
+    cp output/sorted_hvb_comp.csv "$scenarios/expected_1"
+    ./codeC/bin/main input/c-wire_v00.dat lv indiv -1 > /dev/null 2>&1
+    cp output/sorted_lv_indiv.csv "$scenarios/expected_2"
+    ./codeC/bin/main input/c-wire_v00.dat lv all 2 --chart none > /dev/null 2>&1
+    cp output/sorted_lv_all.csv "$scenarios/expected_3"
+    ./codeC/bin/main input/c-wire_v00.dat lv all -1 --chart none > /dev/null 2>&1
+    cp output/top10_lv_all.csv "$scenarios/expected_4"
+    cp output/bottom10_lv_all.csv "$scenarios/expected_5"
+    cp output/lv_all_minmax.csv "$scenarios/expected_6"
+    for i in 1 2 3 4 5 6; do
+        checked=$((checked + 1))
+        if ! cmp -s "$scenarios/expected_$i" "$scenarios/answer_$i"; then
+            echo "FAIL serve: answer $i differs from the file of a plain run"
+            diff "$scenarios/expected_$i" "$scenarios/answer_$i" | head -5
+            failures=$((failures + 1))
+        fi
+    done
+fi
+
+# A directory of shards split from an input gives every file of a plain run over that input; the cache and
+# snapshot need a single file, so CHECK_OPTIONS are not passed
+if [ -f input/c-wire_v00.dat ]; then
+    mkdir -p "$scenarios/shards" "$scenarios/plain"
+    split -n l/4 input/c-wire_v00.dat "$scenarios/shards/part_"
+    for mode in "hvb comp" "lv all"; do
+        rm -f output/*
+        ./codeC/bin/main input/c-wire_v00.dat $mode -1 --chart none > /dev/null 2>&1
+        cp output/*.csv "$scenarios/plain/"
+        # One thread reads the shards in turn; several parse them at once and merge them file by file
+        for threads in 1 4; do
+            rm -f output/*
+            ./codeC/bin/main "$scenarios/shards" $mode -1 --chart none -j $threads > /dev/null 2>&1
+            for expected in "$scenarios"/plain/*.csv; do
+                checked=$((checked + 1))
+                if ! cmp -s "$expected" "output/$(basename "$expected")"; then
+                    echo "FAIL shards $mode -j $threads: $(basename "$expected") differs from a plain run"
+                    diff "$expected" "output/$(basename "$expected")" | head -5
+                    failures=$((failures + 1))
+                fi
+            done
+        done
+        rm -f "$scenarios"/plain/*
+    done
+fi
+
+# A malformed line is split like awk -F';': its empty capacity is reported and the line ignored, and the lines
+# are counted and numbered from the top of the input, header included
+printf "%s\n" "Power plant;HV-B Station;HV-A Station;LV Station;Company;Individual;Capacity;Load" \
+    "1;2;-;-;-;-;;-" "1;3;-;-;-;-;700;-" "1;3;-;-;4;-;-;250" > "$scenarios/malformed.dat"
+./codeC/bin/main "$scenarios/malformed.dat" hvb comp -1 > "$scenarios/malformed.log" 2>&1
+checked=$((checked + 1))
+if [ "$(cat output/sorted_hvb_comp.csv)" != "$(printf "IDhvb:Capacity:Consumption\n3:700:250.00")" ] ||
+   ! grep -q "^Line 2 ignored: empty or null capacity" "$scenarios/malformed.log" ||
+   ! grep -q "Total lines read: 4," "$scenarios/malformed.log"; then
+    echo "FAIL malformed: a line with an empty column is not read column for column"
+    cat "$scenarios/malformed.log" output/sorted_hvb_comp.csv
+    failures=$((failures + 1))
+fi
+
+# With --stats -, the standard output holds the JSON alone, the progress messages going to stderr
+if [ -f input/c-wire_v00.dat ]; then
+    ./codeC/bin/main input/c-wire_v00.dat lv all -1 --chart none --stats - > "$scenarios/stats.json" 2> /dev/null
+    checked=$((checked + 1))
+    if [ "$(head -c 1 "$scenarios/stats.json")" != "{" ] || [ "$(tail -n 1 "$scenarios/stats.json")" != "}" ] ||
+       [ -e ./- ]; then
+        echo "FAIL stats: --stats - does not write the JSON alone to the standard output"
+        head -3 "$scenarios/stats.json"
+        failures=$((failures + 1))
+    fi
+fi
+
+# A bounded ranking over stations listed after their consumers keeps every listed difference within its error
+awk 'BEGIN {
+    print "Station;HVB;HVA;LV;Company;Individual;Capacity;Load"
+    for (k = 1; k <= 400; k++) printf "1;-;-;%d;-;%d;-;%d\n", k, k, k * 37 % 1000 + 1
+    for (k = 1; k <= 400; k++) printf "1;-;-;%d;-;-;%d;-\n", k, k * 53 % 997 * 13
+}' > "$scenarios/consumers_first.dat"
+./codeC/bin/main "$scenarios/consumers_first.dat" lv all -1 --chart none > /dev/null 2>&1
+cp output/sorted_lv_all.csv "$scenarios/exact.csv"
+./codeC/bin/main "$scenarios/consumers_first.dat" lv all -1 --chart none --top-budget 64 > "$scenarios/bounded.log" 2>&1
+error=$(sed -n 's/.*listed differences within \([0-9]*\) of exact.*/\1/p' "$scenarios/bounded.log")
+checked=$((checked + 1))
+if [ -z "$error" ] ||
+   ! awk -F: -v error="$error" 'FNR == NR { if (FNR > 1) exact[$1] = $2 - $3; next }
+       { d = $4 - exact[$1]; if (d > error || -d > error) bad = 1 }
+       END { exit bad }' "$scenarios/exact.csv" output/top10_lv_all.csv output/bottom10_lv_all.csv; then
+    echo "FAIL bounded: a --top-budget ranking of stations listed after their consumers is wrong beyond its error"
+    grep "^Bounded" "$scenarios/bounded.log"
+    failures=$((failures + 1))
+fi
+
+# A budget beyond the largest table is rejected before anything is allocated
+checked=$((checked + 1))
+if timeout 10 ./codeC/bin/main "$scenarios/consumers_first.dat" lv all -1 --chart none --top-budget 2097153 \
+       > "$scenarios/budget.log" 2>&1 || ! grep -q "^Invalid candidate budget" "$scenarios/budget.log"; then
+    echo "FAIL budget: --top-budget above the largest table is not rejected"
+    failures=$((failures + 1))
+fi
+
+if [ "$failures" -ne 0 ]; then
+    echo "$failures of $checked result files differ"
+    exit 1
+fi
+echo "All $checked result files match the golden results"
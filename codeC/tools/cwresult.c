@@ -0,0 +1,109 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../output.h"
+#include "../result.h"
+
+static int openDestination(OutputFile* output, const char* path) {
+/**
+ * @brief Opens the file written by a command, or buffers the standard output when no path is given.
+ */
+
+    if (!path || strcmp(path, "-") == 0) {
+        attachOutput(output, STDOUT_FILENO);
+        return 0;
+    }
+    return openOutput(output, path);
+}
+
+static void printInfo(const ResultFile* result, const char* path) {
+/**
+ * @brief Prints the header of a result file and its first and last stations.
+ */
+
+    printf("%s: %s %s, plant %d, %zu stations, %zu bytes (%.1f bytes per station)\n", path,
+           result->header.stationType, result->header.consumerType, result->header.plantId, result->rows, result->size,
+           result->rows ? (double)result->size / (double)result->rows : 0.0);
+
+    for (size_t row = 0; row < result->rows; row += result->rows > 1 ? result->rows - 1 : 1) {
+        StationDiff station;
+        resultStation(result, row, &station);
+        printf("%s station: %d:%ld:%ld:%ld\n", row == 0 ? "First" : "Last", station.key, station.capacity,
+               station.consumption, station.difference);
+    }
+}
+
+static void writeRows(const ResultFile* result, size_t first, size_t count, int csv, OutputFile* output) {
+/**
+ * @brief Writes stations of a result file as text, in the CSV format of the sorted files or with their difference.
+ */
+
+    if (csv) writeSortedHeader(output, result->header.stationType);
+    for (size_t row = first; row < result->rows && row - first < count; row++) {
+        StationDiff station;
+        resultStation(result, row, &station);
+        writeStation(output, &station, !csv);
+    }
+}
+
+int main(int argc, char* argv[]) {
+/**
+ * @brief Reads a binary result file written with --binary.
+ *
+ * Usage: cwresult info file.cwr
+ *        cwresult show file.cwr [first [count]]
+ *        cwresult csv file.cwr [output.csv]
+ * "info" prints the header, "show" prints stations as
+ * "key:capacity:consumption:difference", and "csv" converts the file back
+ * to the sorted CSV file it was written with, byte for byte.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv The command, the result file and the arguments of the command.
+ * @return EXIT_SUCCESS, or EXIT_FAILURE if the file cannot be read or written.
+ */
+
+    if (argc < 3 || (strcmp(argv[1], "info") != 0 && strcmp(argv[1], "show") != 0 && strcmp(argv[1], "csv") != 0)) {
+        fprintf(stderr, "Usage: %s info file.cwr\n", argv[0]);
+        fprintf(stderr, "       %s show file.cwr [first [count]]\n", argv[0]);
+        fprintf(stderr, "       %s csv file.cwr [output.csv]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    ResultFile result;
+    if (mapResultFile(&result, argv[2]) != 0) {
+        if (errno == EINVAL) {
+            fprintf(stderr, "%s is not a binary result file\n", argv[2]);
+        } else {
+            perror("Error opening result file");
+        }
+        return EXIT_FAILURE;
+    }
+
+    if (strcmp(argv[1], "info") == 0) {
+        printInfo(&result, argv[2]);
+        unmapResultFile(&result);
+        return EXIT_SUCCESS;
+    }
+
+    int csv = strcmp(argv[1], "csv") == 0;
+    size_t first = !csv && argc > 3 ? strtoul(argv[3], NULL, 10) : 0;
+    size_t count = !csv && argc > 4 ? strtoul(argv[4], NULL, 10) : result.rows;
+
+    OutputFile output;
+    if (openDestination(&output, csv && argc > 3 ? argv[3] : NULL) != 0) {
+        perror("Error opening output file");
+        unmapResultFile(&result);
+        return EXIT_FAILURE;
+    }
+    writeRows(&result, first, count, csv, &output);
+    int status = EXIT_SUCCESS;
+    if (closeOutput(&output) != 0) {
+        perror("Error writing output file");
+        status = EXIT_FAILURE;
+    }
+
+    unmapResultFile(&result);
+    return status;
+}
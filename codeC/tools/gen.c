@@ -0,0 +1,279 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Largest number of consumers attached to one LV station
+#define MAX_LV_CONSUMERS 16
+
+// Generator state: random source, next free ID of each level and lines left to write
+typedef struct {
+    uint64_t seed;
+    long plant;
+    long hvb;
+    long hva;
+    long lv;
+    long company;
+    long individual;
+    long long linesLeft;
+    FILE* output;
+} Generator;
+
+static uint64_t nextRandom(Generator* generator) {
+/**
+ * @brief Returns the next value of a xorshift64* random sequence.
+ *
+ * @param generator The generator owning the sequence.
+ * @return A 64-bit pseudo-random value.
+ */
+
+    uint64_t x = generator->seed;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    generator->seed = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+static long randomBetween(Generator* generator, long low, long high) {
+/**
+ * @brief Returns a pseudo-random integer in [low, high].
+ *
+ * @param generator The random source.
+ * @param low The smallest value.
+ * @param high The largest value.
+ * @return The random value.
+ */
+
+    return low + (long)(nextRandom(generator) % (uint64_t)(high - low + 1));
+}
+
+static int writeLine(Generator* generator, long plant, const char* hvb, const char* hva, const char* lv,
+                     const char* company, const char* individual, const char* capacity, const char* load) {
+/**
+ * @brief Writes one c-wire line if the requested size is not reached yet.
+ *
+ * @param generator The generator; its line budget is decreased.
+ * @param plant The plant ID.
+ * @param hvb The HV-B station column ("-" when absent).
+ * @param hva The HV-A station column.
+ * @param lv The LV station column.
+ * @param company The company column.
+ * @param individual The individual column.
+ * @param capacity The capacity column.
+ * @param load The load column.
+ * @return 1 if the line was written, 0 if the line budget is exhausted.
+ */
+
+    if (generator->linesLeft <= 0) return 0;
+    generator->linesLeft--;
+    fprintf(generator->output, "%ld;%s;%s;%s;%s;%s;%s;%s\n", plant, hvb, hva, lv, company, individual, capacity, load);
+    return 1;
+}
+
+static int writeStation(Generator* generator, long plant, long hvb, long hva, long lv, long capacity) {
+/**
+ * @brief Writes a station line: the station's own column(s) and its capacity.
+ *
+ * @param generator The generator.
+ * @param plant The plant ID.
+ * @param hvb The HV-B ID, or 0 for '-'.
+ * @param hva The HV-A ID, or 0 for '-'.
+ * @param lv The LV ID, or 0 for '-'.
+ * @param capacity The capacity of the station.
+ * @return 1 if the line was written, 0 if the line budget is exhausted.
+ */
+
+    char columns[4][24];
+    long ids[3] = {hvb, hva, lv};
+    for (int i = 0; i < 3; i++) {
+        if (ids[i]) {
+            sprintf(columns[i], "%ld", ids[i]);
+        } else {
+            strcpy(columns[i], "-");
+        }
+    }
+    sprintf(columns[3], "%ld", capacity);
+    return writeLine(generator, plant, columns[0], columns[1], columns[2], "-", "-", columns[3], "-");
+}
+
+static int writeConsumer(Generator* generator, long plant, long hvb, long hva, long lv, int isCompany, long load) {
+/**
+ * @brief Writes a consumer line: its station column, its company or individual ID and its load.
+ *
+ * @param generator The generator; the consumer ID is taken from its counters.
+ * @param plant The plant ID.
+ * @param hvb The HV-B ID of the supplying station, or 0.
+ * @param hva The HV-A ID of the supplying station, or 0.
+ * @param lv The LV ID of the supplying station, or 0.
+ * @param isCompany 1 for a company, 0 for an individual.
+ * @param load The load of the consumer.
+ * @return 1 if the line was written, 0 if the line budget is exhausted.
+ */
+
+    char columns[5][24];
+    long ids[3] = {hvb, hva, lv};
+    for (int i = 0; i < 3; i++) {
+        if (ids[i]) {
+            sprintf(columns[i], "%ld", ids[i]);
+        } else {
+            strcpy(columns[i], "-");
+        }
+    }
+    sprintf(columns[3], "%ld", isCompany ? ++generator->company : ++generator->individual);
+    sprintf(columns[4], "%ld", load);
+    return writeLine(generator, plant, columns[0], columns[1], columns[2], isCompany ? columns[3] : "-",
+                     isCompany ? "-" : columns[3], "-", columns[4]);
+}
+
+static int writeLv(Generator* generator, long plant, long hva) {
+/**
+ * @brief Writes an LV station fed by an HV-A station, followed by its companies and individuals.
+ *
+ * The capacity is drawn around the total load, so some stations are
+ * overloaded and others underused.
+ *
+ * @param generator The generator.
+ * @param plant The plant ID.
+ * @param hva The HV-A station feeding the LV station.
+ * @return 1 while the line budget is not exhausted.
+ */
+
+    long loads[MAX_LV_CONSUMERS];
+    int companies = (int)randomBetween(generator, 0, 2);
+    int consumers = companies + (int)randomBetween(generator, 1, MAX_LV_CONSUMERS - 2);
+    long total = 0;
+
+    for (int i = 0; i < consumers; i++) {
+        loads[i] = i < companies ? randomBetween(generator, 50000000, 150000000)
+                                 : randomBetween(generator, 15000000, 35000000);
+        total += loads[i];
+    }
+
+    long lv = ++generator->lv;
+    if (!writeStation(generator, plant, 0, hva, lv, total / 100 * randomBetween(generator, 80, 125))) return 0;
+    for (int i = 0; i < consumers; i++) {
+        if (!writeConsumer(generator, plant, 0, 0, lv, i < companies, loads[i])) return 0;
+    }
+    return 1;
+}
+
+static int writeHva(Generator* generator, long plant, long hvb) {
+/**
+ * @brief Writes an HV-A station fed by an HV-B station, its companies and its LV stations.
+ *
+ * @param generator The generator.
+ * @param plant The plant ID.
+ * @param hvb The HV-B station feeding the HV-A station.
+ * @return 1 while the line budget is not exhausted.
+ */
+
+    long hva = ++generator->hva;
+    if (!writeStation(generator, plant, hvb, hva, 0, randomBetween(generator, 150000000, 900000000))) return 0;
+
+    int companies = (int)randomBetween(generator, 0, 2);
+    for (int i = 0; i < companies; i++) {
+        if (!writeConsumer(generator, plant, 0, hva, 0, 1, randomBetween(generator, 100000000, 250000000))) return 0;
+    }
+
+    int lvs = (int)randomBetween(generator, 1, 8);
+    for (int i = 0; i < lvs; i++) {
+        if (!writeLv(generator, plant, hva)) return 0;
+    }
+    return 1;
+}
+
+static int writeHvb(Generator* generator, long plant) {
+/**
+ * @brief Writes an HV-B station of a plant, its companies and its HV-A stations.
+ *
+ * @param generator The generator.
+ * @param plant The plant ID.
+ * @return 1 while the line budget is not exhausted.
+ */
+
+    long hvb = ++generator->hvb;
+    if (!writeStation(generator, plant, hvb, 0, 0, randomBetween(generator, 500000000, 2000000000))) return 0;
+
+    int companies = (int)randomBetween(generator, 0, 3);
+    for (int i = 0; i < companies; i++) {
+        if (!writeConsumer(generator, plant, hvb, 0, 0, 1, randomBetween(generator, 150000000, 300000000))) return 0;
+    }
+
+    int hvas = (int)randomBetween(generator, 1, 6);
+    for (int i = 0; i < hvas; i++) {
+        if (!writeHva(generator, plant, hvb)) return 0;
+    }
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+/**
+ * @brief Writes a synthetic c-wire file with the plant, HV-B, HV-A, LV and consumer hierarchy.
+ *
+ * Usage: gen [-n lines] [-p plants] [-s seed] [-o output]
+ * The lines (header included) are spread evenly over the plants. The same
+ * seed always produces the same file.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv The array of command-line arguments.
+ * @return EXIT_SUCCESS on success, or EXIT_FAILURE on error.
+ */
+
+    long long lines = 10000;
+    long plants = 5;
+    uint64_t seed = 1;
+    const char* outputPath = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            lines = (long long)strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            plants = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else {
+            fprintf(stderr, "Usage: %s [-n lines] [-p plants] [-s seed] [-o output]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (lines < 1 || plants < 1) {
+        fprintf(stderr, "The number of lines and plants must be positive.\n");
+        return EXIT_FAILURE;
+    }
+
+    Generator generator;
+    memset(&generator, 0, sizeof(generator));
+    generator.seed = seed ? seed : 1;
+    generator.output = outputPath ? fopen(outputPath, "w") : stdout;
+    if (!generator.output) {
+        perror("Error opening output file");
+        return EXIT_FAILURE;
+    }
+    setvbuf(generator.output, NULL, _IOFBF, 1 << 20);
+
+    fprintf(generator.output, "Power plant;HV-B Station;HV-A Station;LV Station;Company;Individual;Capacity;Load\n");
+    long long remaining = lines - 1;
+
+    for (long p = 0; p < plants && remaining > 0; p++) {
+        long long budget = remaining / (plants - p);
+        remaining -= budget;
+        generator.linesLeft = budget;
+
+        long plant = ++generator.plant;
+        char capacity[24];
+        sprintf(capacity, "%ld", randomBetween(&generator, 1000000000, 4000000000));
+        if (!writeLine(&generator, plant, "-", "-", "-", "-", "-", capacity, "-")) continue;
+        while (writeHvb(&generator, plant)) {
+        }
+    }
+
+    if (fclose(generator.output) != 0) {
+        perror("Error writing output file");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
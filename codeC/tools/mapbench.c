@@ -0,0 +1,174 @@
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../station.h"
+
+// Sizes measured when none are given on the command line
+static const long DEFAULT_SIZES[] = {100000, 1000000, 10000000};
+
+// Measurements of one backend at one size
+typedef struct {
+    double insertSeconds;
+    double lookupSeconds;
+    double scanSeconds;
+    size_t bytes;
+    long keys;
+    int height;
+    uint64_t checksum;
+    int ordered;
+} MapResult;
+
+static double nowSeconds(void) {
+/**
+ * @brief Returns a monotonic time in seconds.
+ */
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static int keyAt(long i, int ascending) {
+/**
+ * @brief Returns the i-th inserted key.
+ *
+ * Sparse keys are a 32-bit hash of i, spread over the positive range in no
+ * order (a few collide and become duplicates). Ascending keys are spaced
+ * by 7, as stations listed in order with gaps.
+ */
+
+    if (ascending) return (int)(i * 7);
+
+    uint32_t hash = (uint32_t)i;
+    hash = (hash ^ (hash >> 16)) * 0x85ebca6bu;
+    hash = (hash ^ (hash >> 13)) * 0xc2b2ae35u;
+    return (int)((hash ^ (hash >> 16)) & 0x7fffffff);
+}
+
+static MapResult runMap(BackendType backend, long size, int ascending) {
+/**
+ * @brief Inserts size keys into a station map, looks each of them up, then collects them.
+ *
+ * Every key is inserted twice, the second time as a duplicate that adds
+ * its consumption. Lookups visit the keys in reverse order. The checksum
+ * covers the collected stations and the lookups, so both backends must
+ * give the same one.
+ */
+
+    MapResult result;
+    memset(&result, 0, sizeof(result));
+    StationMap map;
+    initStationMap(&map, backend, 0);
+
+    double start = nowSeconds();
+    for (long i = 0; i < size; i++) {
+        int key = keyAt(i, ascending);
+        addStation(&map, key, key / 2, 1);
+    }
+    for (long i = 0; i < size; i++) {
+        addStation(&map, keyAt(i, ascending), 0, 2);
+    }
+    result.insertSeconds = nowSeconds() - start;
+
+    uint64_t checksum = 0xcbf29ce484222325ULL;
+    start = nowSeconds();
+    for (long i = size - 1; i >= 0; i--) {
+        StationDiff station;
+        if (!findStation(&map, keyAt(i, ascending), &station)) station.difference = -1;
+        checksum = (checksum ^ (uint64_t)station.difference) * 0x100000001b3ULL;
+    }
+    result.lookupSeconds = nowSeconds() - start;
+
+    StationDiff* stations = NULL;
+    start = nowSeconds();
+    int count = collectStations(&map, &stations);
+    result.scanSeconds = nowSeconds() - start;
+
+    result.ordered = 1;
+    result.keys = count;
+    for (int i = 0; i < count; i++) {
+        if (i > 0 && stations[i].key <= stations[i - 1].key) result.ordered = 0;
+        checksum = (checksum ^ (uint64_t)stations[i].key ^ (uint64_t)stations[i].consumption << 32) * 0x100000001b3ULL;
+    }
+    result.checksum = checksum;
+
+    if (backend == BACKEND_BTREE) {
+        result.bytes = bptreeMemory(&map.btree);
+        result.height = bptreeHeight(&map.btree);
+    } else {
+        result.bytes = (size_t)map.tree.count * sizeof(AVLNode);
+        result.height = getHeight(&map.tree, map.tree.root);
+    }
+
+    free(stations);
+    freeStationMap(&map);
+    return result;
+}
+
+static void printResult(const char* name, long size, MapResult result) {
+/**
+ * @brief Prints the throughput and memory of one backend.
+ */
+
+    printf("%-6s %11ld %12.2f %12.2f %10.1f %10.1f %7d  %016llx\n", name, size,
+           2 * size / result.insertSeconds / 1e6, size / result.lookupSeconds / 1e6, result.scanSeconds * 1000,
+           (double)result.bytes / result.keys, result.height, (unsigned long long)result.checksum);
+}
+
+int main(int argc, char* argv[]) {
+/**
+ * @brief Compares the AVL tree and the B+tree backends of the station map.
+ *
+ * Usage: mapbench [--ascending] [size...]
+ * For each size (default 10^5, 10^6 and 10^7 keys), both backends insert
+ * the same keys, look them up and collect them in key order, through the
+ * StationMap functions the program uses. Memory is the size of the nodes
+ * in use per distinct key. Both backends must give the same checksum and a
+ * sorted collection; otherwise the mismatch is reported and the tool fails.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv The array of command-line arguments.
+ * @return EXIT_SUCCESS if both backends agree at every size, EXIT_FAILURE otherwise.
+ */
+
+    int ascending = 0;
+    long sizes[32];
+    int sizeCount = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--ascending") == 0) {
+            ascending = 1;
+        } else if (argv[i][0] != '-' && atol(argv[i]) > 0 && sizeCount < 32) {
+            sizes[sizeCount++] = atol(argv[i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--ascending] [size...]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (sizeCount == 0) {
+        sizeCount = sizeof(DEFAULT_SIZES) / sizeof(DEFAULT_SIZES[0]);
+        memcpy(sizes, DEFAULT_SIZES, sizeof(DEFAULT_SIZES));
+    }
+
+    printf("Keys: %s, each inserted twice\n", ascending ? "ascending, step 7" : "sparse, random order");
+    printf("%-6s %11s %12s %12s %10s %10s %7s  %s\n", "map", "keys", "insert M/s", "lookup M/s", "scan (ms)",
+           "bytes/key", "height", "checksum");
+
+    int status = EXIT_SUCCESS;
+    for (int i = 0; i < sizeCount; i++) {
+        MapResult avl = runMap(BACKEND_AVL, sizes[i], ascending);
+        printResult("avl", sizes[i], avl);
+        MapResult btree = runMap(BACKEND_BTREE, sizes[i], ascending);
+        printResult("btree", sizes[i], btree);
+
+        if (!avl.ordered || !btree.ordered || avl.keys != btree.keys || avl.checksum != btree.checksum) {
+            printf("%-6s %11ld MISMATCH between the backends\n", "", sizes[i]);
+            status = EXIT_FAILURE;
+        }
+    }
+
+    return status;
+}
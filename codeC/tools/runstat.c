@@ -0,0 +1,54 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+int main(int argc, char* argv[]) {
+/**
+ * @brief Runs a command and prints its wall-clock time and peak resident memory.
+ *
+ * Usage: runstat command [arguments...]
+ * The command's own output is left untouched; the measurements are printed
+ * on stderr as "elapsed=<seconds> maxrss_kb=<kilobytes> status=<exit status>".
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv The command to run and its arguments.
+ * @return The exit status of the command, or EXIT_FAILURE if it cannot be run.
+ */
+
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s command [arguments...]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    struct timespec start;
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    pid_t child = fork();
+    if (child < 0) {
+        perror("Error creating process");
+        return EXIT_FAILURE;
+    }
+    if (child == 0) {
+        execvp(argv[1], argv + 1);
+        perror("Error running command");
+        _exit(127);
+    }
+
+    int status;
+    struct rusage usage;
+    if (wait4(child, &status, 0, &usage) < 0) {
+        perror("Error waiting for command");
+        return EXIT_FAILURE;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double elapsed = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    int exitStatus = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    fprintf(stderr, "elapsed=%.3f maxrss_kb=%ld status=%d\n", elapsed, usage.ru_maxrss, exitStatus);
+    return exitStatus;
+}
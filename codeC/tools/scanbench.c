@@ -0,0 +1,223 @@
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../input.h"
+#include "../scan.h"
+
+// Longest line copied by the strtok/atoi reference, as in the original reader
+#define REFERENCE_LINE_SIZE 1024
+
+// Result of one pass over the input: lines parsed and a checksum of every parsed field
+typedef struct {
+    long lines;
+    uint64_t checksum;
+    double seconds;
+} ScanResult;
+
+static double nowSeconds(void) {
+/**
+ * @brief Returns a monotonic time in seconds.
+ */
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static uint64_t mixRecord(uint64_t checksum, const Record* record) {
+/**
+ * @brief Adds the values and flags of a parsed line to a checksum.
+ */
+
+    for (int i = 0; i < COLUMN_COUNT; i++) {
+        checksum = (checksum ^ (uint64_t)record->value[i]) * 0x100000001b3ULL;
+    }
+    return (checksum ^ ((uint64_t)record->dash << 16 | (uint64_t)record->empty << 8 | record->text)) * 0x100000001b3ULL;
+}
+
+static ScanResult scanReference(const char* data, size_t size) {
+/**
+ * @brief Parses the input like the original reader: each line copied, split by strtok and converted by atol.
+ *
+ * strtok merges empty columns and atol does not flag '-' or text, so this
+ * checksum is not comparable with the others; it only serves as a time reference.
+ */
+
+    ScanResult result = {0, 0xcbf29ce484222325ULL, 0};
+    char line[REFERENCE_LINE_SIZE];
+    const char* p = data;
+    const char* end = data + size;
+    double start = nowSeconds();
+
+    while (p < end) {
+        const char* newline = memchr(p, '\n', (size_t)(end - p));
+        size_t length = (size_t)((newline ? newline : end) - p);
+        if (length >= sizeof(line)) length = sizeof(line) - 1;
+        memcpy(line, p, length);
+        line[length] = '\0';
+        p = newline ? newline + 1 : end;
+
+        Record record;
+        memset(&record, 0, sizeof(record));
+        int column = 0;
+        for (char* token = strtok(line, ";"); token && column < COLUMN_COUNT; token = strtok(NULL, ";")) {
+            record.value[column++] = atol(token);
+        }
+        result.checksum = mixRecord(result.checksum, &record);
+        result.lines++;
+    }
+
+    result.seconds = nowSeconds() - start;
+    return result;
+}
+
+static ScanResult scanParseRecord(const char* data, size_t size) {
+/**
+ * @brief Parses the input with parseRecord(), the byte-by-byte scanner.
+ */
+
+    ScanResult result = {0, 0xcbf29ce484222325ULL, 0};
+    const char* line = data;
+    const char* end = data + size;
+    double start = nowSeconds();
+
+    while (line < end) {
+        Record record;
+        line = parseRecord(line, end, &record);
+        result.checksum = mixRecord(result.checksum, &record);
+        result.lines++;
+    }
+
+    result.seconds = nowSeconds() - start;
+    return result;
+}
+
+static ScanResult scanKernel(const char* data, size_t size) {
+/**
+ * @brief Parses the input with scanRecord() and the selected kernel.
+ */
+
+    ScanResult result = {0, 0xcbf29ce484222325ULL, 0};
+    Scanner scanner;
+    initScanner(&scanner, data, data + size);
+    const char* line = data;
+    double start = nowSeconds();
+
+    while (line < data + size) {
+        Record record;
+        line = scanRecord(&scanner, &record);
+        result.checksum = mixRecord(result.checksum, &record);
+        result.lines++;
+    }
+
+    result.seconds = nowSeconds() - start;
+    return result;
+}
+
+static ScanResult bestOf(ScanResult (*scan)(const char*, size_t), const char* data, size_t size, int repeats) {
+/**
+ * @brief Runs a scan several times and keeps the fastest run.
+ */
+
+    ScanResult best = scan(data, size);
+    for (int i = 1; i < repeats; i++) {
+        ScanResult result = scan(data, size);
+        if (result.seconds < best.seconds) best = result;
+    }
+    return best;
+}
+
+static void printResult(const char* name, ScanResult result, size_t size, double baseline) {
+/**
+ * @brief Prints the throughput of a scan and its speedup over the strtok/atoi reference.
+ */
+
+    printf("%-12s %9.3f %10.0f %12.0f %8.2fx  %016llx\n", name, result.seconds * 1000,
+           (double)size / 1048576 / result.seconds, (double)result.lines / result.seconds, baseline / result.seconds,
+           (unsigned long long)result.checksum);
+}
+
+int main(int argc, char* argv[]) {
+/**
+ * @brief Compares the line scanning kernels with the byte-by-byte scanner and the original strtok/atoi reader.
+ *
+ * Usage: scanbench [-r repeats] file
+ * The file is read into memory, then each scanner parses it repeats times
+ * (default 5) and the fastest pass is reported. Only parsing is timed: no
+ * filtering or aggregation. Every kernel must produce the same checksum as
+ * parseRecord(); a mismatch is reported and makes the tool fail.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv The array of command-line arguments.
+ * @return EXIT_SUCCESS if every kernel agrees with parseRecord(), EXIT_FAILURE otherwise.
+ */
+
+    int repeats = 5;
+    const char* path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            repeats = atoi(argv[++i]);
+        } else if (!path && argv[i][0] != '-') {
+            path = argv[i];
+        } else {
+            path = NULL;
+            break;
+        }
+    }
+    if (!path || repeats < 1) {
+        fprintf(stderr, "Usage: %s [-r repeats] file\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        perror("Error opening input file");
+        return EXIT_FAILURE;
+    }
+    fseek(file, 0, SEEK_END);
+    size_t size = (size_t)ftell(file);
+    rewind(file);
+    char* data = malloc(size > 0 ? size : 1);
+    if (!data) {
+        perror("Memory allocation error");
+        return EXIT_FAILURE;
+    }
+    if (fread(data, 1, size, file) != size) {
+        perror("Error reading input file");
+        return EXIT_FAILURE;
+    }
+    fclose(file);
+
+    printf("Input: %s (%.1f MB), best of %d\n", path, (double)size / 1048576, repeats);
+    printf("%-12s %9s %10s %12s %9s  %s\n", "scanner", "time (ms)", "MB/s", "lines/s", "speedup", "checksum");
+
+    ScanResult reference = bestOf(scanReference, data, size, repeats);
+    printResult("strtok/atoi", reference, size, reference.seconds);
+    ScanResult expected = bestOf(scanParseRecord, data, size, repeats);
+    printResult("parseRecord", expected, size, reference.seconds);
+
+    static const char* const kernels[] = {"scalar", "sse4", "avx2", "avx512"};
+    int status = EXIT_SUCCESS;
+    for (int i = 0; i < 4; i++) {
+        ScanKernel kernel;
+        parseScanKernel(kernels[i], &kernel);
+        if (selectScanKernel(kernel) != 0) {
+            printf("%-12s not supported by this processor\n", kernels[i]);
+            continue;
+        }
+
+        ScanResult result = bestOf(scanKernel, data, size, repeats);
+        printResult(kernels[i], result, size, reference.seconds);
+        if (result.checksum != expected.checksum || result.lines != expected.lines) {
+            printf("%-12s MISMATCH with parseRecord\n", kernels[i]);
+            status = EXIT_FAILURE;
+        }
+    }
+
+    free(data);
+    return status;
+}
@@ -1,184 +1,292 @@
+#include <string.h>
 #include "tree.h"
 
-AVLNode* createNode(int key, long capacity, double consumption) {
+void initTree(AVLTree* tree) {
+/**
+ * @brief Initializes an empty AVL tree; the arena is allocated on the first insertion.
+ *
+ * @param tree The tree to initialize.
+ */
+
+    memset(tree, 0, sizeof(*tree));
+    tree->root = NIL_NODE;
+}
+
+uint32_t createNode(AVLTree* tree, int key, long capacity, long consumption) {
 /**
  * @brief Creates a new AVL tree node with the given key, capacity, and consumption.
- * 
+ *
+ * The node is taken from the end of the arena, which doubles when full.
+ * Pointers to nodes are invalidated when the arena grows; indices are not.
+ *
+ * @param tree The tree owning the arena.
  * @param key The key associated with the new node.
  * @param capacity The capacity value of the new node.
  * @param consumption The consumption value of the new node.
- * @return A pointer to the newly created AVL tree node.
+ * @return The index of the newly created AVL tree node.
  */
 
-    AVLNode* node = (AVLNode*)malloc(sizeof(AVLNode));
-    if (!node) {
-        fprintf(stderr, "Memory allocation error.\n");
-        exit(EXIT_FAILURE);
+    if (tree->count == tree->size) {
+        uint32_t size = tree->size ? tree->size * 2 : 1024;
+        AVLNode* nodes = realloc(tree->nodes, size * sizeof(AVLNode));
+        if (!nodes) {
+            fprintf(stderr, "Memory allocation error.\n");
+            exit(EXIT_FAILURE);
+        }
+        tree->nodes = nodes;
+        tree->size = size;
+
+        // Slot 0 is the empty-child sentinel
+        if (tree->count == 0) {
+            memset(&tree->nodes[0], 0, sizeof(AVLNode));
+            tree->count = 1;
+        }
     }
+
+    uint32_t index = tree->count++;
+    AVLNode* node = &tree->nodes[index];
     node->key = key;
     node->capacity = capacity;
     node->consumption = consumption;
-    node->left = node->right = NULL;
-    node->height = 1; 
-    return node;
+    node->left = node->right = NIL_NODE;
+    node->height = 1;
+    return index;
 }
 
 
-int getHeight(AVLNode* node) {
+int getHeight(const AVLTree* tree, uint32_t node) {
 /**
  * @brief Retrieves the height of a given AVL tree node.
- * 
- * @param node The AVL tree node whose height is to be determined.
- * @return The height of the node, or 0 if the node is NULL.
+ *
+ * @param tree The tree owning the node.
+ * @param node The index of the node whose height is to be determined.
+ * @return The height of the node, or 0 for NIL_NODE.
  */
 
-    return node ? node->height : 0;
+    return node == NIL_NODE ? 0 : tree->nodes[node].height;
 }
 
 
-int getBalance(AVLNode* node) {
+int getBalance(const AVLTree* tree, uint32_t node) {
 /**
  * @brief Calculates the balance factor of a given AVL tree node.
- * 
- * @param node The AVL tree node for which the balance factor is calculated.
- * @return The balance factor of the node, or 0 if the node is NULL.
+ *
+ * @param tree The tree owning the node.
+ * @param node The index of the node for which the balance factor is calculated.
+ * @return The balance factor of the node, or 0 for NIL_NODE.
+ */
+
+    if (node == NIL_NODE) return 0;
+    return getHeight(tree, tree->nodes[node].left) - getHeight(tree, tree->nodes[node].right);
+}
+
+
+static void updateHeight(AVLTree* tree, uint32_t node) {
+/**
+ * @brief Recomputes the height of a node from the heights of its children.
+ *
+ * @param tree The tree owning the node.
+ * @param node The index of the node to update.
  */
 
-    return node ? getHeight(node->left) - getHeight(node->right) : 0;
+    int left = getHeight(tree, tree->nodes[node].left);
+    int right = getHeight(tree, tree->nodes[node].right);
+    tree->nodes[node].height = (uint8_t)(1 + (left > right ? left : right));
 }
 
 
-AVLNode* rotateRight(AVLNode* y) {
+uint32_t rotateRight(AVLTree* tree, uint32_t y) {
 /**
  * @brief Performs a right rotation on a given AVL tree node.
- * 
- * @param y The root of the subtree to rotate right.
- * @return The new root of the rotated subtree.
+ *
+ * @param tree The tree owning the node.
+ * @param y The index of the root of the subtree to rotate right.
+ * @return The index of the new root of the rotated subtree.
  */
 
-    AVLNode* x = y->left;
-    AVLNode* T = x->right;
+    uint32_t x = tree->nodes[y].left;
+    uint32_t T = tree->nodes[x].right;
+    tree->rotations++;
 
-    x->right = y;
-    y->left = T;
+    tree->nodes[x].right = y;
+    tree->nodes[y].left = T;
 
-    y->height = 1 + ( (getHeight(y->left) > getHeight(y->right)) ? getHeight(y->left) : getHeight(y->right) );
-    x->height = 1 + ( (getHeight(x->left) > getHeight(x->right)) ? getHeight(x->left) : getHeight(x->right) );
+    updateHeight(tree, y);
+    updateHeight(tree, x);
 
     return x;
 }
 
 
-AVLNode* rotateLeft(AVLNode* x) {
+uint32_t rotateLeft(AVLTree* tree, uint32_t x) {
 /**
  * @brief Performs a left rotation on a given AVL tree node.
- * 
- * @param x The root of the subtree to rotate left.
- * @return The new root of the rotated subtree.
+ *
+ * @param tree The tree owning the node.
+ * @param x The index of the root of the subtree to rotate left.
+ * @return The index of the new root of the rotated subtree.
  */
 
-    AVLNode* y = x->right;
-    AVLNode* T = y->left;
+    uint32_t y = tree->nodes[x].right;
+    uint32_t T = tree->nodes[y].left;
+    tree->rotations++;
 
-    y->left = x;
-    x->right = T;
+    tree->nodes[y].left = x;
+    tree->nodes[x].right = T;
 
-    x->height = 1 + ( (getHeight(x->left) > getHeight(x->right)) ? getHeight(x->left) : getHeight(x->right) );
-    y->height = 1 + ( (getHeight(y->left) > getHeight(y->right)) ? getHeight(y->left) : getHeight(y->right) );
+    updateHeight(tree, x);
+    updateHeight(tree, y);
 
     return y;
 }
 
 
-AVLNode* insertNode(AVLNode* root, int key, long capacity, double consumption) {
+void insertNode(AVLTree* tree, int key, long capacity, long consumption) {
 /**
  * @brief Inserts a node with the specified key, capacity, and consumption into the AVL tree.
- * 
- * @param root The root of the AVL tree.
+ *
+ * The descent is iterative and remembers its path; after a new node is
+ * linked, the path is walked back up to update heights and rebalance, and
+ * stops as soon as a subtree height is unchanged.
+ *
+ * @param tree The tree receiving the node.
  * @param key The key of the node to be inserted.
  * @param capacity The capacity value of the node to be inserted.
  * @param consumption The consumption value of the node to be inserted.
- * @return The new root of the AVL tree after the insertion.
  */
 
-    if (!root) {
-        return createNode(key, capacity, consumption);
+    uint32_t path[MAX_TREE_HEIGHT];
+    int depth = 0;
+    uint32_t current = tree->root;
+
+    while (current != NIL_NODE) {
+        AVLNode* node = &tree->nodes[current];
+        if (key == node->key) {
+            // If the key already exists, just update the consumption
+            node->consumption += consumption;
+            return;
+        }
+        path[depth++] = current;
+        current = key < node->key ? node->left : node->right;
+    }
+
+    uint32_t created = createNode(tree, key, capacity, consumption);
+    if (depth == 0) {
+        tree->root = created;
+        return;
     }
 
-    if (key < root->key) {
-        root->left = insertNode(root->left, key, capacity, consumption);
-    } else if (key > root->key) {
-        root->right = insertNode(root->right, key, capacity, consumption);
+    uint32_t parent = path[depth - 1];
+    if (key < tree->nodes[parent].key) {
+        tree->nodes[parent].left = created;
     } else {
-        // If the key already exists, just update the capacity and consumption
-        //root->capacity += capacity;
-        root->consumption += consumption;
-        return root;
+        tree->nodes[parent].right = created;
     }
 
-    // Update height
-    root->height = 1 + ((getHeight(root->left) > getHeight(root->right)) ? getHeight(root->left) : getHeight(root->right));
+    while (depth > 0) {
+        uint32_t root = path[--depth];
+        int oldHeight = tree->nodes[root].height;
+        updateHeight(tree, root);
+
+        // Check balance and rotate if needed
+        int balance = getBalance(tree, root);
+        uint32_t newRoot = root;
+
+        if (balance > 1) {
+            // Left-right case first turns into left-left
+            if (key > tree->nodes[tree->nodes[root].left].key) {
+                tree->nodes[root].left = rotateLeft(tree, tree->nodes[root].left);
+            }
+            newRoot = rotateRight(tree, root);
+        } else if (balance < -1) {
+            // Right-left case first turns into right-right
+            if (key < tree->nodes[tree->nodes[root].right].key) {
+                tree->nodes[root].right = rotateRight(tree, tree->nodes[root].right);
+            }
+            newRoot = rotateLeft(tree, root);
+        }
+
+        if (newRoot != root) {
+            if (depth == 0) {
+                tree->root = newRoot;
+            } else if (tree->nodes[path[depth - 1]].left == root) {
+                tree->nodes[path[depth - 1]].left = newRoot;
+            } else {
+                tree->nodes[path[depth - 1]].right = newRoot;
+            }
+            return;
+        }
+
+        if (tree->nodes[root].height == oldHeight) return;
+    }
+}
 
-    // Check balance and rotate if needed
-    int balance = getBalance(root);
 
-    // Left-left case
-    if (balance > 1 && key < root->left->key) {
-        return rotateRight(root);
-    }
+AVLNode* searchNode(const AVLTree* tree, int key) {
+/**
+ * @brief Searches for a node with the specified key in the AVL tree.
+ *
+ * @param tree The tree to search.
+ * @param key The key of the node to search for.
+ * @return A pointer to the node with the specified key, or NULL if not found.
+ *         The pointer is valid until the next insertion.
+ */
 
-    // Right-right case
-    if (balance < -1 && key > root->right->key) {
-        return rotateLeft(root);
-    }
+    uint32_t current = tree->root;
 
-    // Left-right case
-    if (balance > 1 && key > root->left->key) {
-        root->left = rotateLeft(root->left);
-        return rotateRight(root);
+    while (current != NIL_NODE) {
+        AVLNode* node = &tree->nodes[current];
+        if (node->key == key) return node;
+        current = key < node->key ? node->left : node->right;
     }
 
-    // Right-left case
-    if (balance < -1 && key < root->right->key) {
-        root->right = rotateRight(root->right);
-        return rotateLeft(root);
-    }
+    return NULL;
+}
 
-    return root;
+
+void freeTree(AVLTree* tree) {
+/**
+ * @brief Frees the memory allocated for the AVL tree in one release of its arena.
+ *
+ * @param tree The tree to be freed; it is left empty.
+ */
+
+    free(tree->nodes);
+    initTree(tree);
 }
 
 
-AVLNode* searchNode(AVLNode* root, int key) {
+void mergeTree(AVLTree* tree, AVLTree* other) {
 /**
- * @brief Searches for a node with the specified key in the AVL tree.
- * 
- * @param root The root of the AVL tree.
- * @param key The key of the node to search for.
- * @return A pointer to the node with the specified key, or NULL if not found.
+ * @brief Merges every node of another AVL tree into the tree, then frees the other tree.
+ *
+ * Keys already present in tree keep their capacity and add the consumption of
+ * the other node, exactly as insertNode() does for a duplicate key, so merging
+ * partial trees built from consecutive slices of the input gives the same
+ * result as inserting all the lines into one tree. The other tree's arena is
+ * read in creation order, which is the order its keys first appeared.
+ *
+ * @param tree The AVL tree receiving the nodes.
+ * @param other The AVL tree to merge; it is freed.
  */
 
-    if (!root || root->key == key) {
-        return root;
+    for (uint32_t i = 1; i < other->count; i++) {
+        const AVLNode* node = &other->nodes[i];
+        insertNode(tree, node->key, node->capacity, node->consumption);
     }
 
-    if (key < root->key) {
-        return searchNode(root->left, key);
-    } else {
-        return searchNode(root->right, key);
-    }
+    tree->rotations += other->rotations;
+    freeTree(other);
 }
 
 
-void freeTree(AVLNode* root) {
+uint32_t treeSize(const AVLTree* tree) {
 /**
- * @brief Frees the memory allocated for the AVL tree.
- * 
- * @param root The root of the AVL tree to be freed.
+ * @brief Returns the number of nodes of the AVL tree.
+ *
+ * @param tree The tree to measure.
+ * @return The number of nodes, not counting the sentinel.
  */
 
-    if (root) {
-        freeTree(root->left);
-        freeTree(root->right);
-        free(root);
-    }
+    return tree->count ? tree->count - 1 : 0;
 }
@@ -1,28 +1,47 @@
 #ifndef TREE_H
 #define TREE_H
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
-// Definition of the AVL tree node structure
-typedef struct AVLNode {
+// Index of the empty child; slot 0 of the arena is a sentinel of height 0
+#define NIL_NODE 0u
+
+// Deepest path an AVL tree of 2^32 nodes can have
+#define MAX_TREE_HEIGHT 64
+
+// Definition of the AVL tree node structure (children are arena indices)
+typedef struct {
     int key;
+    uint32_t left;
+    uint32_t right;
+    uint8_t height;
     long capacity;
-    double consumption;
-    struct AVLNode* left;
-    struct AVLNode* right;
-    int height;
+    long consumption;
 } AVLNode;
 
+// AVL tree stored in one contiguous node arena
+typedef struct {
+    AVLNode* nodes;
+    uint32_t count;
+    uint32_t size;
+    uint32_t root;
+    unsigned long rotations;
+} AVLTree;
+
 // AVL tree function prototypes
-AVLNode* createNode(int key, long capacity, double consumption);
-int getHeight(AVLNode* node);
-int getBalance(AVLNode* node);
-AVLNode* rotateRight(AVLNode* y);
-AVLNode* rotateLeft(AVLNode* x);
-AVLNode* insertNode(AVLNode* root, int key, long capacity, double consumption);
-AVLNode* searchNode(AVLNode* root, int key);
-void freeTree(AVLNode* root);
+void initTree(AVLTree* tree);
+uint32_t createNode(AVLTree* tree, int key, long capacity, long consumption);
+int getHeight(const AVLTree* tree, uint32_t node);
+int getBalance(const AVLTree* tree, uint32_t node);
+uint32_t rotateRight(AVLTree* tree, uint32_t y);
+uint32_t rotateLeft(AVLTree* tree, uint32_t x);
+void insertNode(AVLTree* tree, int key, long capacity, long consumption);
+AVLNode* searchNode(const AVLTree* tree, int key);
+void freeTree(AVLTree* tree);
+void mergeTree(AVLTree* tree, AVLTree* other);
+uint32_t treeSize(const AVLTree* tree);
 
 // Gnuplot script generation prototype (declared here for convenience)
 void generateGnuplotScript(const char* scriptPath, const char* top10Path, const char* bottom10Path, const char* outputPath);